@@ -0,0 +1,305 @@
+#include "ArchiveJob.h"
+#include "OutputStaging.h"
+#include <QBuffer>
+#include <QDir>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+namespace {
+constexpr qint64 CopyChunkSize = 1024 * 1024;
+}
+
+ArchiveJob::ArchiveJob(Converter *converter, const QString &archivePath, Converter::FileFormat targetFormat,
+                       const Converter::ResizeOptions &resize, const QString &outputDirectory,
+                       int maxInFlight, qint64 memoryBudget, QObject *parent)
+    : QObject(parent), converter(converter), reader(archivePath), targetFormat(targetFormat),
+      resize(resize), outputDirectory(outputDirectory), maxInFlight(qMax(1, maxInFlight)), memoryBudget(memoryBudget),
+      nextEntry(0), completed(0), succeeded(0), bufferedBytes(0), admitting(false), done(false)
+{
+    connect(converter, &Converter::conversionFinished, this, &ArchiveJob::onConversionFinished);
+    connect(converter, &Converter::conversionError, this, &ArchiveJob::onConversionError);
+}
+
+ArchiveJob::~ArchiveJob()
+{
+    for (auto it = inFlight.begin(); it != inFlight.end(); ++it) {
+        releaseEntry(it.value());
+    }
+    if (outputFile.isOpen()) {
+        outputFile.close();
+    }
+    if (!stagingDirectory.isEmpty()) {
+        OutputStaging::removeStagingDirectory(stagingDirectory);
+    }
+}
+
+void ArchiveJob::start()
+{
+    QString error;
+    if (!reader.open(&error)) {
+        fail(error);
+        return;
+    }
+
+    const QList<ZipReader::Entry> &entries = reader.entries();
+    for (int i = 0; i < entries.size(); ++i) {
+        const ZipReader::Entry &entry = entries[i];
+        if (entry.isDirectory() || !entry.isSupported()) {
+            continue;
+        }
+        Converter::FileFormat sourceFormat = Converter::detectFormat(entry.name);
+        // A PDF rendered to images is one file per page; archives keep one output per entry
+        Converter::Backend backend = Converter::backendFor(sourceFormat, targetFormat);
+        if (sourceFormat == Converter::FileFormat::Unknown || sourceFormat == targetFormat
+            || backend == Converter::Backend::None || backend == Converter::Backend::PdfRaster) {
+            continue;
+        }
+        eligible << i;
+    }
+    if (eligible.isEmpty()) {
+        fail("Archive contains no files that can be converted to " + Converter::formatToString(targetFormat));
+        return;
+    }
+
+    QDir().mkpath(OutputStaging::scratchDirectory());
+    scratch.reset(new QTemporaryDir(OutputStaging::scratchDirectory() + "/archive-XXXXXX"));
+    stagingDirectory = OutputStaging::createStagingDirectory(outputDirectory);
+    if (!scratch->isValid() || stagingDirectory.isEmpty()) {
+        fail("Cannot create working directories for the archive");
+        return;
+    }
+    outputFile.setFileName(stagingDirectory + "/" + QFileInfo(reader.path()).completeBaseName() + ".zip");
+    if (!outputFile.open(QIODevice::WriteOnly)) {
+        fail("Cannot create output archive: " + outputFile.errorString());
+        return;
+    }
+    writer.reset(new ZipWriter(&outputFile));
+
+    admit();
+}
+
+void ArchiveJob::admit()
+{
+    // Entries that fail synchronously complete inside this loop; let the
+    // outermost call keep admitting instead of recursing once per entry
+    if (admitting) {
+        return;
+    }
+    admitting = true;
+
+    const QList<ZipReader::Entry> &entries = reader.entries();
+    while (!done && nextEntry < eligible.size() && inFlight.size() < maxInFlight) {
+        int index = eligible[nextEntry];
+        const ZipReader::Entry &entry = entries[index];
+        Converter::FileFormat sourceFormat = Converter::detectFormat(entry.name);
+        bool streamed = Converter::backendFor(sourceFormat, targetFormat) == Converter::Backend::ImageMagick;
+
+        // A streamed entry's output is held in memory until it is appended;
+        // budget it at the size of its input
+        if (streamed && !inFlight.isEmpty() && bufferedBytes + entry.uncompressedSize > memoryBudget) {
+            break;
+        }
+        nextEntry++;
+
+        InFlight item;
+        item.outputName = uniqueOutputName(entry.name);
+        item.input = nullptr;
+        item.output = nullptr;
+        item.size = 0;
+
+        if (streamed) {
+            QString id = reader.path() + "/" + entry.name;
+            item.input = new ZipEntryDevice(reader.path(), entry, this);
+            item.output = new QBuffer(this);
+            if (!item.input->open(QIODevice::ReadOnly)) {
+                emit entryError(id, "Cannot read archive entry: " + item.input->errorString());
+                releaseEntry(item);
+                completed++;
+                continue;
+            }
+            item.output->open(QIODevice::WriteOnly);
+            item.size = entry.uncompressedSize;
+            bufferedBytes += item.size;
+            inFlight[id] = item;
+            converter->convertStream(id, item.input, item.output, targetFormat, sourceFormat, resize);
+        } else {
+            // LibreOffice needs a real file
+            item.scratchDirectory = scratch->path() + "/" + QString::number(index);
+            QDir().mkpath(item.scratchDirectory + "/out");
+            QString inputPath = item.scratchDirectory + "/" + QFileInfo(entry.name).fileName();
+
+            ZipEntryDevice input(reader.path(), entry);
+            QFile unpacked(inputPath);
+            bool ok = input.open(QIODevice::ReadOnly) && unpacked.open(QIODevice::WriteOnly);
+            while (ok) {
+                QByteArray chunk = input.read(CopyChunkSize);
+                if (chunk.isEmpty()) {
+                    ok = input.pos() == input.size();   // Short on a damaged entry
+                    break;
+                }
+                ok = unpacked.write(chunk) == chunk.size();
+            }
+            unpacked.close();
+            if (!ok) {
+                emit entryError(reader.path() + "/" + entry.name, "Cannot unpack archive entry");
+                releaseEntry(item);
+                completed++;
+                continue;
+            }
+
+            inFlight[inputPath] = item;
+            Converter::OutputSpec output;
+            output.format = targetFormat;
+            output.resize = resize;
+            converter->submit(inputPath, QList<Converter::OutputSpec>() << output,
+                              item.scratchDirectory + "/out", false);
+            converter->startNextQueuedConversion();
+        }
+    }
+
+    admitting = false;
+    if (!done && inFlight.isEmpty() && nextEntry >= eligible.size()) {
+        finish();
+    }
+}
+
+void ArchiveJob::onConversionFinished(const QString &id, Converter::ConversionStatus status, const QString &outputPath)
+{
+    completeEntry(id, status == Converter::ConversionStatus::Success, outputPath);
+}
+
+void ArchiveJob::onConversionError(const QString &id, const QString &errorMessage)
+{
+    Q_UNUSED(errorMessage); // Already reported by the converter under the entry's id
+    completeEntry(id, false, QString());
+}
+
+void ArchiveJob::completeEntry(const QString &id, bool ok, const QString &outputPath)
+{
+    auto it = inFlight.find(id);
+    if (it == inFlight.end() || done) {
+        return;
+    }
+    InFlight item = it.value();
+    inFlight.erase(it);
+    completed++;
+    bufferedBytes -= item.size;
+
+    if (ok) {
+        QString error;
+        bool written = false;
+        if (item.output) {
+            item.output->close();
+            item.output->open(QIODevice::ReadOnly);
+            written = writer->addEntry(item.outputName, item.output, &error);
+        } else {
+            QFile output(outputPath);
+            if (output.open(QIODevice::ReadOnly)) {
+                written = writer->addEntry(item.outputName, &output, &error);
+            } else {
+                error = "Cannot read converted entry: " + output.errorString();
+            }
+        }
+        if (!written) {
+            releaseEntry(item);
+            fail(error);
+            return;
+        }
+        succeeded++;
+    }
+    releaseEntry(item);
+
+    emit progress(completed * 100 / eligible.size());
+    admit();
+}
+
+void ArchiveJob::cancel()
+{
+    if (done) {
+        return;
+    }
+    stop();
+    emit finished(Converter::ConversionStatus::Cancelled, QString(), QString());
+}
+
+void ArchiveJob::fail(const QString &errorMessage)
+{
+    if (done) {
+        return;
+    }
+    stop();
+    emit finished(Converter::ConversionStatus::Failed, QString(), errorMessage);
+}
+
+void ArchiveJob::stop()
+{
+    done = true;
+    converter->disconnect(this);
+    const QStringList ids = inFlight.keys();
+    for (const QString &id : ids) {
+        converter->cancelConversion(id);
+        releaseEntry(inFlight[id]);
+    }
+    inFlight.clear();
+    bufferedBytes = 0;
+}
+
+void ArchiveJob::finish()
+{
+    done = true;
+    converter->disconnect(this);
+    if (succeeded == 0) {
+        // Entry errors were reported individually
+        emit finished(Converter::ConversionStatus::Failed, QString(), "No entries could be converted");
+        return;
+    }
+
+    QString error;
+    bool ok = writer->finish(&error);
+    outputFile.close();
+    QString outputPath;
+    if (ok) {
+        outputPath = OutputStaging::publish(outputFile.fileName(), outputDirectory,
+                                            QFileInfo(reader.path()).completeBaseName() + "-"
+                                                + Converter::formatToExtension(targetFormat),
+                                            "zip", &error);
+    }
+    if (outputPath.isEmpty()) {
+        emit finished(Converter::ConversionStatus::Failed, QString(), error);
+        return;
+    }
+    emit finished(Converter::ConversionStatus::Success, outputPath, QString());
+}
+
+QString ArchiveJob::uniqueOutputName(const QString &entryName)
+{
+    QString directory = entryName.left(entryName.lastIndexOf('/') + 1);
+    QString baseName = QFileInfo(entryName).completeBaseName();
+    QString extension = Converter::formatToExtension(targetFormat);
+
+    // a.png and a.webp both become a.jpg
+    QString name = directory + baseName + "." + extension;
+    for (int n = 1; outputNames.contains(name); ++n) {
+        name = directory + QString("%1 (%2).%3").arg(baseName).arg(n).arg(extension);
+    }
+    outputNames.insert(name);
+    return name;
+}
+
+void ArchiveJob::releaseEntry(InFlight &entry)
+{
+    // The pipe job lets go of the devices before reporting, but deleting
+    // them from inside its signal is still too early
+    if (entry.input) {
+        entry.input->deleteLater();
+        entry.input = nullptr;
+    }
+    if (entry.output) {
+        entry.output->deleteLater();
+        entry.output = nullptr;
+    }
+    if (!entry.scratchDirectory.isEmpty()) {
+        QDir(entry.scratchDirectory).removeRecursively();
+        entry.scratchDirectory.clear();
+    }
+}
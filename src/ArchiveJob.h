@@ -0,0 +1,85 @@
+#ifndef ARCHIVEJOB_H
+#define ARCHIVEJOB_H
+
+#include <QObject>
+#include <QFile>
+#include <QMap>
+#include <QSet>
+#include <QScopedPointer>
+#include "Converter.h"
+#include "ZipArchive.h"
+
+class QBuffer;
+class QTemporaryDir;
+
+// Converts the entries of a ZIP archive into a new ZIP. Image entries are
+// streamed from the archive through the tool and into memory; documents are
+// unpacked to scratch because LibreOffice needs a file. Outputs are appended
+// to the result in completion order. The number of entries in flight and the
+// bytes buffered for them are bounded.
+class ArchiveJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    ArchiveJob(Converter *converter, const QString &archivePath, Converter::FileFormat targetFormat,
+               const Converter::ResizeOptions &resize, const QString &outputDirectory,
+               int maxInFlight, qint64 memoryBudget, QObject *parent = nullptr);
+    ~ArchiveJob();
+
+    void start();
+    void cancel();
+
+signals:
+    void progress(int percent);
+    // An entry could not be read from the archive
+    void entryError(const QString &id, const QString &errorMessage);
+    // errorMessage is set when status is Failed
+    void finished(Converter::ConversionStatus status, const QString &outputPath, const QString &errorMessage);
+
+private slots:
+    void onConversionFinished(const QString &id, Converter::ConversionStatus status, const QString &outputPath);
+    void onConversionError(const QString &id, const QString &errorMessage);
+
+private:
+    struct InFlight {
+        QString outputName;
+        ZipEntryDevice *input;      // Stream entries
+        QBuffer *output;
+        QString scratchDirectory;   // Document entries
+        qint64 size;
+    };
+
+    void admit();
+    void completeEntry(const QString &id, bool ok, const QString &outputPath);
+    void fail(const QString &errorMessage);
+    void stop();
+    void finish();
+    QString uniqueOutputName(const QString &entryName);
+    void releaseEntry(InFlight &entry);
+
+    Converter *converter;
+    ZipReader reader;
+    Converter::FileFormat targetFormat;
+    Converter::ResizeOptions resize;
+    QString outputDirectory;
+    int maxInFlight;
+    qint64 memoryBudget;
+
+    QList<int> eligible;            // Indexes of convertible entries
+    int nextEntry;
+    int completed;
+    int succeeded;
+    qint64 bufferedBytes;
+    QMap<QString, InFlight> inFlight;
+    QSet<QString> outputNames;
+    bool admitting;
+
+    QScopedPointer<QTemporaryDir> scratch;
+    QString stagingDirectory;
+    QFile outputFile;
+    QScopedPointer<ZipWriter> writer;
+    bool done;
+};
+
+#endif // ARCHIVEJOB_H
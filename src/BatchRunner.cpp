@@ -0,0 +1,314 @@
+#include "BatchRunner.h"
+#include "ManifestReader.h"
+#include <QCollator>
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QTextStream>
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+QTextStream &err()
+{
+    static QTextStream stream(stderr);
+    return stream;
+}
+}
+
+BatchRunner::BatchRunner(Converter *converter, QObject *parent)
+    : QObject(parent), converter(converter), verbose(false), manifest(nullptr),
+      manifestTarget(Converter::FileFormat::Unknown), feedScheduled(false),
+      succeeded(0), upToDate(0), failed(0), skipped(0)
+{
+    connect(converter, &Converter::conversionRouted, this, &BatchRunner::onConversionRouted);
+    connect(converter, &Converter::conversionFinished, this, &BatchRunner::onConversionFinished);
+    connect(converter, &Converter::conversionError, this, &BatchRunner::onConversionError);
+    connect(converter, &Converter::allConversionsFinished, this, &BatchRunner::onAllConversionsFinished);
+}
+
+BatchRunner::~BatchRunner()
+{
+    delete manifest;
+}
+
+void BatchRunner::setVerbose(bool enabled)
+{
+    verbose = enabled;
+}
+
+void BatchRunner::setResize(const Converter::ResizeOptions &options)
+{
+    resize = options;
+}
+
+void BatchRunner::setExtraOutputs(const QList<Converter::OutputSpec> &outputs)
+{
+    extraOutputs = outputs;
+}
+
+QStringList BatchRunner::collectInputs(const QStringList &paths)
+{
+    QStringList files;
+    for (const QString &path : paths) {
+        QFileInfo info(path);
+        if (!info.isDir()) {
+            files << path;
+            continue;
+        }
+        QStringList found;
+        QDirIterator it(path, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            QString file = it.next();
+            // Skip our own staging areas inside output trees
+            if (file.contains("/.fileconverter-staging/")) {
+                continue;
+            }
+            // Archives are only converted when named explicitly
+            Converter::FileFormat format = Converter::detectFormat(file);
+            if (format != Converter::FileFormat::Unknown && format != Converter::FileFormat::ZIP) {
+                found << file;
+            }
+        }
+        // Directory order is arbitrary; "scan2" before "scan10" keeps merged pages in order
+        QCollator collator;
+        collator.setNumericMode(true);
+        std::sort(found.begin(), found.end(), collator);
+        files << found;
+    }
+    return files;
+}
+
+void BatchRunner::run(const QStringList &inputs, Converter::FileFormat targetFormat)
+{
+    if (inputs.isEmpty()) {
+        err() << "No input files\n";
+        err().flush();
+        QMetaObject::invokeMethod(qApp, [] { QCoreApplication::exit(2); }, Qt::QueuedConnection);
+        return;
+    }
+
+    QList<Converter::Submission> batch;
+    for (const QString &input : inputs) {
+        // Same-format pairs are not conversions; report them instead of failing
+        Converter::FileFormat sourceFormat = Converter::detectFormat(input);
+        if (sourceFormat == targetFormat) {
+            skipped++;
+            continue;
+        }
+        
+        Converter::Submission submission;
+        submission.inputPath = input;
+        submission.outputs = outputsFor(sourceFormat, targetFormat);
+        batch << submission;
+    }
+    converter->postBatch(batch);
+
+    if (!converter->isConverting()) {
+        // Every input was skipped; make sure we still exit
+        QMetaObject::invokeMethod(this, &BatchRunner::onAllConversionsFinished, Qt::QueuedConnection);
+    }
+}
+
+void BatchRunner::runManifest(const QString &manifestPath, Converter::FileFormat targetFormat)
+{
+    manifest = new ManifestReader(manifestPath);
+    manifestTarget = targetFormat;
+    QString errorMessage;
+    if (!manifest->open(&errorMessage)) {
+        err() << errorMessage << "\n";
+        err().flush();
+        QMetaObject::invokeMethod(qApp, [] { QCoreApplication::exit(2); }, Qt::QueuedConnection);
+        return;
+    }
+    
+    feedManifest();
+    if (!converter->isConverting()) {
+        QMetaObject::invokeMethod(this, &BatchRunner::onAllConversionsFinished, Qt::QueuedConnection);
+    }
+}
+
+void BatchRunner::scheduleFeed()
+{
+    // Signals arrive from inside the converter's own loops; submit from the
+    // event loop instead
+    if (!manifest || manifest->atEnd() || feedScheduled) {
+        return;
+    }
+    feedScheduled = true;
+    QMetaObject::invokeMethod(this, &BatchRunner::feedManifest, Qt::QueuedConnection);
+}
+
+void BatchRunner::feedManifest()
+{
+    feedScheduled = false;
+    if (!manifest) {
+        return;
+    }
+    ManifestReader::Entry entry;
+    while (converter->wantsMoreJobs() && manifest->next(&entry)) {
+        Converter::FileFormat targetFormat = manifestTarget;
+        Converter::ResizeOptions entryResize = resize;
+        if (!entry.target.isEmpty()) {
+            bool ok = false;
+            Converter::OutputSpec spec = Converter::OutputSpec::fromString(entry.target, &ok);
+            if (!ok) {
+                failed++;
+                err() << "ERROR   " << entry.path << ": unknown target \"" << entry.target
+                      << "\" on manifest line " << entry.line << "\n";
+                continue;
+            }
+            targetFormat = spec.format;
+            entryResize = spec.resize.isNull() ? resize : spec.resize;
+        }
+        Converter::FileFormat sourceFormat = Converter::detectFormat(entry.path);
+        if (sourceFormat == targetFormat) {
+            skipped++;
+            continue;
+        }
+        QList<Converter::OutputSpec> outputs = outputsFor(sourceFormat, targetFormat);
+        outputs.first().resize = entryResize;
+        converter->post(entry.path, outputs);
+    }
+}
+
+int BatchRunner::plan(const QStringList &inputs, Converter::FileFormat targetFormat)
+{
+    QTextStream out(stdout);
+    auto seconds = [](qint64 ms) {
+        return QString::number(ms / 1000.0, 'f', 1) + "s";
+    };
+    
+    QList<qint64> estimates;
+    qint64 totalMs = 0;
+    int unplanned = 0;
+    for (const QString &input : inputs) {
+        Converter::FileFormat sourceFormat = Converter::detectFormat(input);
+        qint64 estimate = sourceFormat == targetFormat
+                          ? -1 : converter->estimateMs(input, outputsFor(sourceFormat, targetFormat));
+        if (estimate < 0) {
+            // Same format, unsupported, or an archive (no estimate of its own)
+            unplanned++;
+            if (verbose) {
+                out << "-       " << input << "\n";
+            }
+            continue;
+        }
+        estimates << estimate;
+        totalMs += estimate;
+        if (verbose) {
+            out << seconds(estimate).rightJustified(7) << " " << input << "\n";
+        }
+    }
+    // Wall time on the -j slots, then the sum of every job's run time
+    out << QString("%1 jobs, about %2 (%3 of conversion), %4 not planned\n")
+           .arg(estimates.size()).arg(seconds(converter->planMs(estimates)), seconds(totalMs))
+           .arg(unplanned);
+    return estimates.isEmpty() && unplanned > 0 ? 1 : 0;
+}
+
+QList<Converter::OutputSpec> BatchRunner::outputsFor(Converter::FileFormat sourceFormat,
+                                                    Converter::FileFormat targetFormat) const
+{
+    Converter::OutputSpec primary;
+    primary.format = targetFormat;
+    primary.resize = resize;
+    QList<Converter::OutputSpec> outputs;
+    outputs << primary;
+    // Images take further image outputs, documents further exports
+    bool image = sourceFormat == Converter::FileFormat::JPG || sourceFormat == Converter::FileFormat::PNG
+                 || sourceFormat == Converter::FileFormat::WEBP || sourceFormat == Converter::FileFormat::HEIC;
+    bool document = sourceFormat == Converter::FileFormat::DOCX || sourceFormat == Converter::FileFormat::PPTX;
+    for (const Converter::OutputSpec &extra : extraOutputs) {
+        bool imageOutput = extra.format == Converter::FileFormat::JPG || extra.format == Converter::FileFormat::PNG
+                           || extra.format == Converter::FileFormat::WEBP;
+        bool exportOutput = extra.format == Converter::FileFormat::PDF || extra.format == Converter::FileFormat::PDFA
+                            || extra.format == Converter::FileFormat::PNG;
+        if (image && imageOutput && (extra.format != sourceFormat || !extra.resize.isNull())) {
+            outputs << extra;
+        } else if (document && exportOutput && extra.resize.isNull()) {
+            outputs << extra;
+        }
+    }
+    return outputs;
+}
+
+void BatchRunner::runMerge(const QStringList &inputs, const QString &outputPath)
+{
+    converter->assemblePdf(inputs, outputPath);
+    if (!converter->isConverting()) {
+        QMetaObject::invokeMethod(this, &BatchRunner::onAllConversionsFinished, Qt::QueuedConnection);
+    }
+}
+
+void BatchRunner::runStream(QIODevice *input, QIODevice *output, Converter::FileFormat targetFormat)
+{
+    converter->convertStream("stdin", input, output, targetFormat, Converter::FileFormat::Unknown, resize);
+    if (!converter->isConverting()) {
+        QMetaObject::invokeMethod(this, &BatchRunner::onAllConversionsFinished, Qt::QueuedConnection);
+    }
+}
+
+void BatchRunner::onConversionRouted(const QString &filePath, const QString &backend, int attempt)
+{
+    // Only printed, so only kept when verbose
+    if (!verbose) {
+        return;
+    }
+    if (backends.contains(filePath)) {
+        err() << "RETRY   " << filePath << " with " << backend << " (attempt " << attempt << ")\n";
+    }
+    backends[filePath] = backend;
+}
+
+void BatchRunner::onConversionFinished(const QString &filePath, Converter::ConversionStatus status, const QString &outputPath)
+{
+    switch (status) {
+        case Converter::ConversionStatus::Success:
+            succeeded++;
+            if (verbose) {
+                err() << "OK      " << filePath << " -> " << outputPath;
+                if (backends.contains(filePath)) {
+                    err() << " [" << backends.value(filePath) << "]";
+                }
+                err() << "\n";
+            }
+            break;
+        case Converter::ConversionStatus::UpToDate:
+            upToDate++;
+            if (verbose) {
+                err() << "CURRENT " << filePath << "\n";
+            }
+            break;
+        case Converter::ConversionStatus::Unsupported:
+            skipped++;
+            err() << "SKIPPED " << filePath << " (unsupported conversion)\n";
+            break;
+        case Converter::ConversionStatus::Failed:
+        case Converter::ConversionStatus::Cancelled:
+            failed++;
+            err() << "FAILED  " << filePath << "\n";
+            break;
+    }
+    scheduleFeed();
+}
+
+void BatchRunner::onConversionError(const QString &filePath, const QString &errorMessage)
+{
+    failed++;
+    err() << "ERROR   " << filePath << ": " << errorMessage << "\n";
+    backends.remove(filePath);
+    scheduleFeed();
+}
+
+void BatchRunner::onAllConversionsFinished()
+{
+    feedManifest();
+    if (converter->isConverting()) {
+        return;
+    }
+    err() << QString("%1 converted, %2 up to date, %3 skipped, %4 failed\n")
+                 .arg(succeeded).arg(upToDate).arg(skipped).arg(failed);
+    err().flush();
+    QCoreApplication::exit(failed > 0 ? 1 : 0);
+}
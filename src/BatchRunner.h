@@ -0,0 +1,65 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <QObject>
+#include <QStringList>
+#include "Converter.h"
+
+class ManifestReader;
+
+// Headless batch conversion driven from the command line (-c/--convert)
+class BatchRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BatchRunner(Converter *converter, QObject *parent = nullptr);
+    ~BatchRunner();
+
+    // Expands directories recursively to the supported files they contain,
+    // in natural name order
+    static QStringList collectInputs(const QStringList &paths);
+
+    void setVerbose(bool enabled);
+    // Applied to every image output
+    void setResize(const Converter::ResizeOptions &options);
+    // Written next to the main output for image and DOCX/PPTX inputs
+    void setExtraOutputs(const QList<Converter::OutputSpec> &outputs);
+    void run(const QStringList &inputs, Converter::FileFormat targetFormat);
+    // Dry run: prints the expected run time of every input and of the whole
+    // batch on the converter's slots, converts nothing; returns the exit code
+    int plan(const QStringList &inputs, Converter::FileFormat targetFormat);
+    // Inputs listed in a manifest file (see ManifestReader), submitted only
+    // as the converter has room, so memory does not grow with the list
+    void runManifest(const QString &manifestPath, Converter::FileFormat targetFormat);
+    // Every input as a page of one PDF, in order
+    void runMerge(const QStringList &inputs, const QString &outputPath);
+    // Single streamed conversion, e.g. stdin to stdout
+    void runStream(QIODevice *input, QIODevice *output, Converter::FileFormat targetFormat);
+
+private slots:
+    void onConversionRouted(const QString &filePath, const QString &backend, int attempt);
+    void onConversionFinished(const QString &filePath, Converter::ConversionStatus status, const QString &outputPath);
+    void onConversionError(const QString &filePath, const QString &errorMessage);
+    void onAllConversionsFinished();
+    void feedManifest();
+
+private:
+    QList<Converter::OutputSpec> outputsFor(Converter::FileFormat sourceFormat, Converter::FileFormat targetFormat) const;
+    void scheduleFeed();
+
+    Converter *converter;
+    bool verbose;
+    Converter::ResizeOptions resize;
+    QList<Converter::OutputSpec> extraOutputs;
+    QMap<QString, QString> backends;    // Backend each input was last handed to (verbose only)
+    ManifestReader *manifest;
+    Converter::FileFormat manifestTarget;
+    bool feedScheduled;
+    int succeeded;
+    int upToDate;
+    int failed;
+    int skipped;
+};
+
+#endif // BATCHRUNNER_H
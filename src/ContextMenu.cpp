@@ -18,7 +18,8 @@ ContextMenu::ContextMenu() {}
 
 QStringList ContextMenu::supportedExtensions()
 {
-    return QStringList() << ".docx" << ".pptx" << ".pdf" << ".jpg" << ".jpeg" << ".png" << ".webp" << ".heic" << ".heif";
+    return QStringList() << ".docx" << ".pptx" << ".pdf" << ".jpg" << ".jpeg" << ".png" << ".webp" << ".heic" << ".heif"
+                         << ".xlsx" << ".csv";
 }
 
 QString ContextMenu::getExecutablePath()
@@ -67,6 +68,8 @@ bool ContextMenu::registerShellExtension()
         else if (ext == ".png") formatName = "PNG Image";
         else if (ext == ".webp") formatName = "WebP Image";
         else if (ext == ".heic" || ext == ".heif") formatName = "HEIC Image";
+        else if (ext == ".xlsx") formatName = "Excel Workbook";
+        else if (ext == ".csv") formatName = "CSV File";
         
         if (!registerForExtension(ext, formatName)) {
             allSuccess = false;
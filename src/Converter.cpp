@@ -1,20 +1,148 @@
 #include "Converter.h"
+#include <QFile>
 #include <QFileInfo>
 #include <QDir>
 #include <QStandardPaths>
 #include <QDebug>
 #include <QTimer>
+#include <QThread>
+#include "OutputStaging.h"
+#include "OutputPublisher.h"
+#include "JobJournal.h"
+#include "WorkerPool.h"
+#include "RemoteJob.h"
+#include "PipeJob.h"
+#include "ArchiveJob.h"
+#include "HeifDecoder.h"
+#include "DocumentExport.h"
+#include "PdfRasterJob.h"
+#include "PdfAssembler.h"
+#include "SpreadsheetConverter.h"
+#include "Preflight.h"
+#include "OutputVerifier.h"
+#include "ThroughputStats.h"
+#include "TraceRecorder.h"
+#include <QDateTime>
+#include <QCoreApplication>
+#include <QUrl>
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+namespace {
+// Wait before the first retry of a crashed run; doubled for each further one
+constexpr int RetryBackoffMs = 500;
+
+// Jobs a fed batch keeps queued per local or remote slot, and at least
+constexpr int LookAheadPerSlot = 4;
+constexpr int MinLookAhead = 64;
+
+// Cost model seed for a remote worker on top of the local run: a request
+// round trip, and the input and output over a ~100 MB/s link
+constexpr double RemoteStartupMs = 50;
+constexpr double RemoteMsPerMB = 20;
+
+// Names a target where the extension is ambiguous (PDF/A is written as .pdf):
+// journal records, incremental index keys and remote requests
+QString targetName(Converter::FileFormat format)
+{
+    return format == Converter::FileFormat::PDFA ? "pdfa" : Converter::formatToExtension(format);
+}
+
+// Outputs of a fan-out job that are resized carry the size in their name, so
+// "photo.png" and "photo-800.png" can sit next to each other; PDF/A next to
+// PDF becomes "report-pdfa.pdf"
+QString outputBaseName(const QFileInfo &inputInfo, Converter::FileFormat format,
+                       const Converter::ResizeOptions &resize, bool fanOut)
+{
+    QString name = inputInfo.completeBaseName();
+    if (fanOut && format == Converter::FileFormat::PDFA) {
+        name += "-pdfa";
+    }
+    if (!fanOut || resize.isNull()) {
+        return name;
+    }
+    const QSize &box = resize.box;
+    name += "-" + (box.width() == box.height() ? QString::number(box.width())
+                                               : QString("%1x%2").arg(box.width()).arg(box.height()));
+    if (resize.mode == Converter::ResizeOptions::Mode::Fill) {
+        name += "-fill";
+    }
+    return name;
+}
+
+QStringList resizeArguments(const Converter::ResizeOptions &resize)
+{
+    if (resize.isNull()) {
+        return QStringList();
+    }
+    QString geometry = QString("%1x%2").arg(resize.box.width()).arg(resize.box.height());
+    if (resize.mode == Converter::ResizeOptions::Mode::Fill) {
+        // Cover the box, then crop the overhang evenly from both sides
+        return {"-resize", geometry + "^", "-gravity", "center", "-extent", geometry};
+    }
+    // ">" only ever shrinks
+    return {"-resize", geometry + ">"};
+}
+}
 
 Converter::Converter(QObject *parent)
-    : QObject(parent), maxParallelConversions(1)  // Use 1 to avoid LibreOffice conflicts
+    : QObject(parent), rasterDpi(150), archiveMemoryBudget(256 * 1024 * 1024), queueSequence(0), postedJobs(0),
+      writeBehindMode(WriteBehindMode::Auto), journal(nullptr), heifDecoder(nullptr), pdfAssembler(nullptr),
+      spreadsheetConverter(nullptr), preflight(nullptr), workerPool(nullptr), trace(nullptr),
+      incremental(false), incrementalIndex(nullptr), finalizeScheduled(false),
+      maxParallelConversions(1),  // Use 1 to avoid LibreOffice conflicts
+      localityOrdering(true)
 {
+    publisher = new OutputPublisher(this);
+    connect(publisher, &OutputPublisher::published, this, &Converter::onOutputPublished);
+    connect(publisher, &OutputPublisher::publishFailed, this, &Converter::onPublishFailed);
+    
+    heifDecoder = new HeifDecoder(this);
+    connect(heifDecoder, &HeifDecoder::converted, this, &Converter::onHeifConverted);
+    
+    pdfAssembler = new PdfAssembler(this);
+    connect(pdfAssembler, &PdfAssembler::assembled, this, &Converter::onInProcessFinished);
+    spreadsheetConverter = new SpreadsheetConverter(this);
+    connect(spreadsheetConverter, &SpreadsheetConverter::converted, this, &Converter::onInProcessFinished);
+    
+    preflight = new Preflight(this);
+    connect(preflight, &Preflight::checked, this, &Converter::onPreflightChecked);
+    
+    // In memory only until a path is set
+    throughputStats = new ThroughputStats();
+    
+    workerPool = new WorkerPool(this);
+    connect(workerPool, &WorkerPool::workerAvailable, this, &Converter::startNextQueuedConversion);
+    
+    // Every terminal outcome completes the job in the journal
+    connect(this, &Converter::conversionFinished, this, &Converter::onJobFinished);
+    connect(this, &Converter::conversionError, this, &Converter::onJobCompleted);
+    
     libreOfficePath = findLibreOffice();
     imageMagickPath = findImageMagick();
+    pdfRendererPath = findPdfRenderer();
 }
 
 Converter::~Converter()
 {
     cancelAll();
+    // The profiles are per process, so no later run could reuse them
+    for (int slot = 0; slot < profileSlotsInUse.size(); ++slot) {
+        QDir(profileDirectory(slot)).removeRecursively();
+    }
+    if (incrementalIndex) {
+        incrementalIndex->save();
+        delete incrementalIndex;
+    }
+    throughputStats->save();
+    delete throughputStats;
+    if (trace) {
+        // Its copier threads may still be recording
+        delete publisher;
+        writeTrace();
+        delete trace;
+    }
 }
 
 void Converter::setLibreOfficePath(const QString &path)
@@ -37,14 +165,249 @@ void Converter::setOutputDirectory(const QString &path)
     outputDirectory = path;
 }
 
+void Converter::setArchiveMemoryBudget(qint64 bytes)
+{
+    archiveMemoryBudget = bytes;
+}
+
+void Converter::setPrefetchDepth(int depth)
+{
+    prefetcher.setDepth(depth);
+}
+
+void Converter::setPrefetchMemoryBudget(qint64 bytes)
+{
+    prefetcher.setMemoryBudget(bytes);
+}
+
+void Converter::setLocalityOrdering(bool enabled)
+{
+    localityOrdering = enabled;
+}
+
+void Converter::setWriteBehindMode(WriteBehindMode mode)
+{
+    writeBehindMode = mode;
+}
+
+void Converter::setPublishThreads(int count)
+{
+    publisher->setMaxThreads(count);
+}
+
+void Converter::setRasterDpi(int dpi)
+{
+    rasterDpi = qBound(36, dpi, 1200);
+}
+
+void Converter::setRasterPages(const QString &pageRanges)
+{
+    rasterPages = pageRanges;
+}
+
+void Converter::setJournalPath(const QString &path)
+{
+    delete journal;
+    journal = path.isEmpty() ? nullptr : new JobJournal(path, this);
+}
+
+QStringList Converter::resumeFromJournal()
+{
+    QStringList resumed;
+    if (!journal) {
+        return resumed;
+    }
+    
+    const QList<JobJournal::Entry> entries = journal->replay();
+    for (const JobJournal::Entry &entry : entries) {
+        QFileInfo inputInfo(entry.inputPath);
+        if (!inputInfo.exists()) {
+            journal->recordCompleted(entry.inputPath);
+            continue;
+        }
+        
+        OutputSpec primary;
+        primary.format = detectFormat("resume." + entry.targetExtension);
+        primary.resize = ResizeOptions::fromString(entry.resize);
+        
+        // Published after the submission but before its completion record
+        // reached the disk: already done
+        QString outDir = entry.outputDirectory.isEmpty() ? inputInfo.absolutePath() : entry.outputDirectory;
+        QFileInfo published(outDir + "/" + inputInfo.completeBaseName() + "." + formatToExtension(primary.format));
+        if (published.exists() && published.lastModified().toMSecsSinceEpoch() >= entry.submittedMs) {
+            journal->recordCompleted(entry.inputPath);
+            continue;
+        }
+
+        QList<OutputSpec> outputs;
+        outputs << primary;
+        const QStringList extras = entry.extraOutputs.split(',', Qt::SkipEmptyParts);
+        for (const QString &extra : extras) {
+            outputs << OutputSpec::fromString(extra);
+        }
+        submit(entry.inputPath, outputs, entry.outputDirectory);
+        resumed << entry.inputPath;
+    }
+    
+    // Start from the event loop so the caller can list the jobs first
+    QMetaObject::invokeMethod(this, [this]() { startNextQueuedConversion(); }, Qt::QueuedConnection);
+    return resumed;
+}
+
+void Converter::discardJournal()
+{
+    if (journal) {
+        journal->reset();
+    }
+}
+
+void Converter::setIncremental(bool enabled)
+{
+    incremental = enabled;
+}
+
+void Converter::setIncrementalIndexPath(const QString &path)
+{
+    if (incrementalIndex) {
+        incrementalIndex->save();
+        delete incrementalIndex;
+        incrementalIndex = nullptr;
+    }
+    if (!path.isEmpty()) {
+        incrementalIndex = new IncrementalIndex(path);
+        incrementalIndex->load();
+    }
+}
+
+void Converter::setThroughputStatsPath(const QString &path)
+{
+    throughputStats->save();
+    delete throughputStats;
+    throughputStats = new ThroughputStats(path);
+    throughputStats->load();
+}
+
+void Converter::setTracePath(const QString &path)
+{
+    tracePath = path;
+    // Threads may hold on to the recorder, so it lives as long as the converter
+    if (!path.isEmpty() && !trace) {
+        trace = new TraceRecorder();
+        publisher->setTraceRecorder(trace);
+    }
+}
+
+void Converter::writeTrace()
+{
+    if (!trace || tracePath.isEmpty()) {
+        return;
+    }
+    QString errorMessage;
+    if (!trace->write(tracePath, &errorMessage)) {
+        qWarning() << errorMessage;
+    }
+}
+
+qint64 Converter::estimateMs(const QString &inputPath, const QList<OutputSpec> &outputs) const
+{
+    QList<FileFormat> formats;
+    for (const OutputSpec &output : outputs) {
+        formats << output.format;
+    }
+    double ms = 0;
+    if (formats.isEmpty() || cheapestCapability(detectFormat(inputPath), formats, QFileInfo(inputPath).size(),
+                                                QList<Backend>(), Backend::None, &ms) == -1) {
+        return -1;
+    }
+    return qRound64(ms);
+}
+
+qint64 Converter::remainingMs() const
+{
+    // Merges and archives have no estimate and are left out
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QList<double> slotFreeMs;
+    double remoteLeftMs = 0;
+    for (auto it = activeJobs.constBegin(); it != activeJobs.constEnd(); ++it) {
+        const ConversionJob &job = it.value();
+        if (job.capability < 0) {
+            continue;
+        }
+        if (job.remote) {
+            remoteLeftMs = qMax(remoteLeftMs, expectedLeftMs(job, now));
+        } else {
+            slotFreeMs << expectedLeftMs(job, now);
+        }
+    }
+    while (slotFreeMs.size() < maxParallelConversions) {
+        slotFreeMs << 0;
+    }
+    
+    // Queued jobs are all placed on local slots; with workers this errs long
+    QList<double> durationsMs;
+    auto add = [&](const QueuedJob &job) {
+        double ms = 0;
+        if (cheapestCapability(detectFormat(job.inputPath), targetFormats(job), job.size,
+                               job.failedBackends, job.backend, &ms) != -1) {
+            durationsMs << ms;
+        }
+    };
+    for (const QueuedJob &job : conversionQueue) {
+        add(job);
+    }
+    for (const QueuedJob &job : delayedRetries) {
+        add(job);
+    }
+    return qMax(scheduleMs(slotFreeMs, durationsMs), qRound64(remoteLeftMs));
+}
+
+qint64 Converter::planMs(const QList<qint64> &estimatesMs) const
+{
+    QList<double> durationsMs;
+    for (qint64 ms : estimatesMs) {
+        durationsMs << ms;
+    }
+    return scheduleMs(QList<double>(maxParallelConversions, 0), durationsMs);
+}
+
+qint64 Converter::scheduleMs(QList<double> slotFreeMs, const QList<double> &durationsMs)
+{
+    if (slotFreeMs.isEmpty()) {
+        return 0;
+    }
+    // Min-heap of the times each slot frees up
+    std::make_heap(slotFreeMs.begin(), slotFreeMs.end(), std::greater<double>());
+    for (double ms : durationsMs) {
+        std::pop_heap(slotFreeMs.begin(), slotFreeMs.end(), std::greater<double>());
+        slotFreeMs.last() += ms;
+        std::push_heap(slotFreeMs.begin(), slotFreeMs.end(), std::greater<double>());
+    }
+    return qRound64(*std::max_element(slotFreeMs.constBegin(), slotFreeMs.constEnd()));
+}
+
+void Converter::setWorkerEndpoints(const QList<WorkerEndpoint> &endpoints)
+{
+    workerPool->setEndpoints(endpoints);
+}
+
 bool Converter::isConverting() const
 {
-    return !activeJobs.isEmpty() || !conversionQueue.isEmpty();
+    return !activeJobs.isEmpty() || !streamJobs.isEmpty() || !archiveJobs.isEmpty()
+           || !conversionQueue.isEmpty() || !delayedRetries.isEmpty() || publisher->pendingCount() > 0
+           || postedJobs.load(std::memory_order_acquire) > 0;
 }
 
 int Converter::activeConversions() const
 {
-    return activeJobs.size();
+    return activeJobs.size() + streamJobs.size();
+}
+
+bool Converter::wantsMoreJobs() const
+{
+    int window = qMax(MinLookAhead, LookAheadPerSlot * (maxParallelConversions + workerPool->capacity())
+                                    + prefetcher.depth());
+    return conversionQueue.size() + delayedRetries.size() + activeJobs.size()
+           + postedJobs.load(std::memory_order_acquire) < window;
 }
 
 Converter::FileFormat Converter::detectFormat(const QString &filePath)
@@ -53,10 +416,30 @@ Converter::FileFormat Converter::detectFormat(const QString &filePath)
     if (suffix == "docx") return FileFormat::DOCX;
     if (suffix == "pptx") return FileFormat::PPTX;
     if (suffix == "pdf") return FileFormat::PDF;
+    if (suffix == "pdfa") return FileFormat::PDFA;      // Target name only (-c pdfa)
     if (suffix == "jpg" || suffix == "jpeg") return FileFormat::JPG;
     if (suffix == "png") return FileFormat::PNG;
     if (suffix == "webp") return FileFormat::WEBP;
     if (suffix == "heic" || suffix == "heif") return FileFormat::HEIC;
+    if (suffix == "xlsx") return FileFormat::XLSX;
+    if (suffix == "csv") return FileFormat::CSV;
+    if (suffix == "zip") return FileFormat::ZIP;
+    return FileFormat::Unknown;
+}
+
+Converter::FileFormat Converter::sniffFormat(QIODevice *device)
+{
+    // peek() leaves the bytes in the device for the actual conversion
+    QByteArray head = device->peek(16);
+    if (head.startsWith("%PDF")) return FileFormat::PDF;
+    if (head.startsWith("\x89PNG")) return FileFormat::PNG;
+    if (head.startsWith("\xFF\xD8\xFF")) return FileFormat::JPG;
+    if (head.startsWith("RIFF") && head.mid(8, 4) == "WEBP") return FileFormat::WEBP;
+    if (head.mid(4, 4) == "ftyp") {
+        static const QList<QByteArray> brands = {"heic", "heix", "hevc", "hevx", "heim", "heis", "mif1", "msf1"};
+        if (brands.contains(head.mid(8, 4))) return FileFormat::HEIC;
+    }
+    // DOCX and PPTX are both plain ZIPs at this depth
     return FileFormat::Unknown;
 }
 
@@ -66,10 +449,14 @@ QString Converter::formatToString(FileFormat format)
         case FileFormat::DOCX: return "DOCX";
         case FileFormat::PPTX: return "PPTX";
         case FileFormat::PDF: return "PDF";
+        case FileFormat::PDFA: return "PDF/A";
         case FileFormat::JPG: return "JPG";
         case FileFormat::PNG: return "PNG";
         case FileFormat::WEBP: return "WEBP";
         case FileFormat::HEIC: return "HEIC";
+        case FileFormat::XLSX: return "XLSX";
+        case FileFormat::CSV: return "CSV";
+        case FileFormat::ZIP: return "ZIP";
         default: return "Unknown";
     }
 }
@@ -80,143 +467,1393 @@ QString Converter::formatToExtension(FileFormat format)
         case FileFormat::DOCX: return "docx";
         case FileFormat::PPTX: return "pptx";
         case FileFormat::PDF: return "pdf";
+        case FileFormat::PDFA: return "pdf";
         case FileFormat::JPG: return "jpg";
         case FileFormat::PNG: return "png";
         case FileFormat::WEBP: return "webp";
         case FileFormat::HEIC: return "heic";
+        case FileFormat::XLSX: return "xlsx";
+        case FileFormat::CSV: return "csv";
+        case FileFormat::ZIP: return "zip";
         default: return "";
     }
 }
 
-void Converter::convertFile(const QString &inputPath, FileFormat targetFormat)
+QSize Converter::ResizeOptions::scaledSize(const QSize &source) const
+{
+    if (isNull() || source.isEmpty()) {
+        return source;
+    }
+    if (mode == Mode::Fill) {
+        return source.scaled(box, Qt::KeepAspectRatioByExpanding);
+    }
+    if (source.width() <= box.width() && source.height() <= box.height()) {
+        return source;
+    }
+    return source.scaled(box, Qt::KeepAspectRatio);
+}
+
+QString Converter::ResizeOptions::toString() const
+{
+    if (isNull()) {
+        return QString();
+    }
+    QString text = box.width() == box.height() ? QString::number(box.width())
+                                               : QString("%1x%2").arg(box.width()).arg(box.height());
+    return mode == Mode::Fill ? text + "^" : text;
+}
+
+Converter::ResizeOptions Converter::ResizeOptions::fromString(const QString &text, bool *ok)
+{
+    ResizeOptions resize;
+    QString spec = text.trimmed();
+    if (spec.isEmpty()) {
+        if (ok) {
+            *ok = true;
+        }
+        return resize;
+    }
+    if (spec.endsWith('^')) {
+        resize.mode = Mode::Fill;
+        spec.chop(1);
+    }
+    
+    QStringList sides = spec.split('x');
+    bool widthOk = false;
+    bool heightOk = true;
+    int width = sides.value(0).toInt(&widthOk);
+    int height = width;
+    if (sides.size() == 2) {
+        height = sides[1].toInt(&heightOk);
+    }
+    
+    bool valid = sides.size() <= 2 && widthOk && heightOk && width > 0 && height > 0;
+    if (valid) {
+        resize.box = QSize(width, height);
+    } else {
+        resize.mode = Mode::Fit;
+    }
+    if (ok) {
+        *ok = valid;
+    }
+    return resize;
+}
+
+QString Converter::OutputSpec::toString() const
+{
+    QString text = targetName(format);
+    return resize.isNull() ? text : text + "@" + resize.toString();
+}
+
+Converter::OutputSpec Converter::OutputSpec::fromString(const QString &text, bool *ok)
+{
+    OutputSpec spec;
+    QString formatText = text.section('@', 0, 0).trimmed();
+    spec.format = detectFormat("output." + formatText);
+    bool resizeOk = true;
+    if (text.contains('@')) {
+        spec.resize = ResizeOptions::fromString(text.section('@', 1), &resizeOk);
+        resizeOk = resizeOk && !spec.resize.isNull();
+    }
+    if (ok) {
+        *ok = spec.format != FileFormat::Unknown && resizeOk;
+    }
+    return spec;
+}
+
+void Converter::convertFile(const QString &inputPath, FileFormat targetFormat, const ResizeOptions &resize)
+{
+    OutputSpec output;
+    output.format = targetFormat;
+    output.resize = resize;
+    convertFile(inputPath, QList<OutputSpec>() << output);
+}
+
+void Converter::convertFile(const QString &inputPath, const QList<OutputSpec> &requested)
+{
+    convertFile(inputPath, requested, outputDirectory);
+}
+
+void Converter::convertFile(const QString &inputPath, const QList<OutputSpec> &requested, const QString &outputDir)
+{
+    QFileInfo inputInfo(inputPath);
+    if (!inputInfo.exists()) {
+        emit conversionError(inputPath, "File does not exist");
+        return;
+    }
+
+    FileFormat sourceFormat = detectFormat(inputPath);
+    if (sourceFormat == FileFormat::Unknown) {
+        emit conversionError(inputPath, "Unsupported file format");
+        return;
+    }
+
+    // Check if already converting this file
+    if (activeJobs.contains(inputPath) || archiveJobs.contains(inputPath) || delayedRetries.contains(inputPath)) {
+        emit conversionError(inputPath, "File is already being converted");
+        return;
+    }
+
+    // The same format and size asked for twice is produced once
+    QList<OutputSpec> outputs;
+    QStringList seen;
+    for (const OutputSpec &output : requested) {
+        if (!seen.contains(output.toString())) {
+            seen << output.toString();
+            outputs << output;
+        }
+    }
+    if (outputs.isEmpty()) {
+        emit conversionError(inputPath, "No output format given");
+        return;
+    }
+    
+    // Only ImageMagick (and the in-process HEIC path) can share one decode,
+    // and only LibreOffice exports can share one document load
+    if (outputs.size() > 1) {
+        Backend shared = backendFor(sourceFormat, outputs.first().format);
+        for (const OutputSpec &output : outputs) {
+            Backend backend = backendFor(sourceFormat, output.format);
+            if (backend != shared || (backend != Backend::ImageMagick && backend != Backend::LibreOfficeExport)) {
+                emit conversionError(inputPath, QString("Cannot convert %1 to several formats including %2")
+                                                .arg(formatToString(sourceFormat), formatToString(output.format)));
+                return;
+            }
+        }
+    }
+    FileFormat targetFormat = outputs.first().format;
+
+    // Several outputs are always rebuilt together, and so are the pages of a PDF
+    if (incremental && sourceFormat != FileFormat::ZIP && outputs.size() == 1
+        && backendFor(sourceFormat, targetFormat) != Backend::PdfRaster) {
+        QString existingOutput;
+        if (isUpToDate(inputInfo, targetFormat, outputDir, &existingOutput)) {
+            emit conversionFinished(inputPath, ConversionStatus::UpToDate, existingOutput);
+            scheduleFinalize();
+            return;
+        }
+        IncrementalStamp stamp;
+        stamp.extension = targetName(targetFormat);
+        stamp.inputSize = inputInfo.size();
+        stamp.inputModifiedMs = inputInfo.lastModified().toMSecsSinceEpoch();
+        incrementalStamps[inputPath] = stamp;
+    }
+
+    submit(inputPath, outputs, outputDir);
+    
+    // Start conversion if we have capacity
+    startNextQueuedConversion();
+}
+
+void Converter::post(const QString &inputPath, const QList<OutputSpec> &outputs)
+{
+    Submission submission;
+    submission.inputPath = inputPath;
+    submission.outputs = outputs;
+    // Counted first, so the converter never looks idle with a job in flight
+    postedJobs.fetch_add(1, std::memory_order_acq_rel);
+    if (submissions.push(submission)) {
+        QMetaObject::invokeMethod(this, &Converter::drainSubmissions, Qt::QueuedConnection);
+    }
+}
+
+void Converter::postBatch(const QList<Submission> &batch)
+{
+    if (batch.isEmpty()) {
+        return;
+    }
+    postedJobs.fetch_add(batch.size(), std::memory_order_acq_rel);
+    if (submissions.pushBatch(batch.begin(), batch.end())) {
+        QMetaObject::invokeMethod(this, &Converter::drainSubmissions, Qt::QueuedConnection);
+    }
+}
+
+void Converter::drainSubmissions()
+{
+    // Armed again before looking, so whatever is posted from here on wakes
+    // this once more
+    submissions.rearm();
+    Submission submission;
+    while (submissions.pop(&submission)) {
+        postedJobs.fetch_sub(1, std::memory_order_acq_rel);
+        convertFile(submission.inputPath, submission.outputs);
+    }
+    // Rejected and up-to-date jobs finish here; the batch still ends
+    scheduleFinalize();
+}
+
+void Converter::assemblePdf(const QStringList &inputPaths, const QString &outputPath)
+{
+    if (activeJobs.contains(outputPath)) {
+        emit conversionError(outputPath, "File is already being converted");
+        return;
+    }
+    if (inputPaths.isEmpty()) {
+        emit conversionError(outputPath, "No images given");
+        return;
+    }
+    for (const QString &inputPath : inputPaths) {
+        if (backendFor(detectFormat(inputPath), FileFormat::PDF) != Backend::PdfAssembly
+            || !QFileInfo::exists(inputPath)) {
+            emit conversionError(outputPath, "Cannot add " + inputPath + " to a PDF");
+            return;
+        }
+    }
+    
+    QFileInfo outputInfo(outputPath);
+    QString outDir = outputInfo.absolutePath();
+    stagingParents.insert(outDir);
+    QString stagingDir = OutputStaging::createStagingDirectory(outDir);
+    if (stagingDir.isEmpty()) {
+        emit conversionError(outputPath, "Could not create staging directory in " + outDir);
+        return;
+    }
+    StagedOutput output;
+    output.format = FileFormat::PDF;
+    output.outputPath = stagingDir + "/" + outputInfo.completeBaseName() + ".pdf";
+    output.stagingDirectory = stagingDir;
+    
+    // Like a stream it starts at once, and holds a local slot while it runs
+    emit conversionStarted(outputPath);
+    convertImagesToPdf(outputPath, inputPaths, output);
+    ConversionJob &job = activeJobs[outputPath];
+    job.outputDirectory = outDir;
+    job.stagingDirectory = stagingDir;
+    job.targetFormat = FileFormat::PDF;
+}
+
+bool Converter::isUpToDate(const QFileInfo &inputInfo, FileFormat targetFormat,
+                           const QString &outputDir, QString *outputPath)
+{
+    QString extension = targetName(targetFormat);
+    QString outDir = outputDir.isEmpty() ? inputInfo.absolutePath() : outputDir;
+    QString expected = outDir + "/" + inputInfo.completeBaseName() + "." + formatToExtension(targetFormat);
+    qint64 inputModifiedMs = inputInfo.lastModified().toMSecsSinceEpoch();
+    
+    // Index hit: only the input is stat'ed, the output volume is not touched
+    IncrementalIndex::Record record;
+    if (incrementalIndex && incrementalIndex->lookup(inputInfo.filePath(), extension, &record)
+        && record.outputPath == expected) {
+        if (record.inputSize == inputInfo.size() && record.inputModifiedMs == inputModifiedMs) {
+            *outputPath = record.outputPath;
+            return true;
+        }
+        return false;
+    }
+    
+    QFileInfo outputInfo(expected);
+    if (!outputInfo.exists() || outputInfo.size() == 0
+        || outputInfo.lastModified().toMSecsSinceEpoch() < inputModifiedMs) {
+        return false;
+    }
+    
+    if (incrementalIndex) {
+        record.inputSize = inputInfo.size();
+        record.inputModifiedMs = inputModifiedMs;
+        record.outputPath = expected;
+        incrementalIndex->update(inputInfo.filePath(), extension, record);
+    }
+    *outputPath = expected;
+    return true;
+}
+
+void Converter::scheduleFinalize()
+{
+    // Jobs that complete without a process still need allConversionsFinished,
+    // but only after the caller has finished submitting the batch
+    if (finalizeScheduled) {
+        return;
+    }
+    finalizeScheduled = true;
+    QMetaObject::invokeMethod(this, [this]() {
+        finalizeScheduled = false;
+        finalizeConversion();
+    }, Qt::QueuedConnection);
+}
+
+void Converter::convertStream(const QString &streamId, QIODevice *input, QIODevice *output,
+                              FileFormat targetFormat, FileFormat sourceFormat, const ResizeOptions &resize)
+{
+    if (activeJobs.contains(streamId) || streamJobs.contains(streamId)) {
+        emit conversionError(streamId, "Stream is already being converted");
+        return;
+    }
+    if (sourceFormat == FileFormat::Unknown) {
+        sourceFormat = sniffFormat(input);
+    }
+    
+    emit conversionStarted(streamId);
+    
+    // Only ImageMagick reads and writes pipes; LibreOffice needs real files
+    if (sourceFormat == FileFormat::Unknown || backendFor(sourceFormat, targetFormat) != Backend::ImageMagick) {
+        emit conversionFinished(streamId, ConversionStatus::Unsupported, "");
+        scheduleFinalize();
+        return;
+    }
+    if (imageMagickPath.isEmpty()) {
+        emit conversionError(streamId, "ImageMagick not found. Please install ImageMagick.");
+        scheduleFinalize();
+        return;
+    }
+    
+    // "-" with an explicit coder prefix reads stdin / writes stdout
+    StagedOutput pipeOutput;
+    pipeOutput.format = targetFormat;
+    pipeOutput.resize = resize;
+    pipeOutput.outputPath = formatToExtension(targetFormat) + ":-";
+    QStringList args = imageMagickArguments(formatToExtension(sourceFormat) + ":-", sourceFormat,
+                                            QList<StagedOutput>() << pipeOutput);
+    
+    PipeJob *stream = new PipeJob(imageMagickPath, args, input, output, this);
+    streamJobs[streamId] = stream;
+    connect(stream, &PipeJob::finished, this, &Converter::onStreamFinished);
+    stream->start();
+}
+
+void Converter::onStreamFinished(bool ok, const QString &errorMessage)
+{
+    PipeJob *stream = qobject_cast<PipeJob*>(sender());
+    QString streamId = streamJobs.key(stream);
+    if (!stream || streamId.isEmpty()) {
+        return;
+    }
+    streamJobs.remove(streamId);
+    stream->deleteLater();
+    
+    if (ok) {
+        emit conversionFinished(streamId, ConversionStatus::Success, "");
+    } else {
+        emit conversionError(streamId, "Conversion failed: " + errorMessage);
+    }
+    finalizeConversion();
+}
+
+void Converter::submit(const QString &inputPath, const QList<OutputSpec> &outputs, const QString &outputDir,
+                       bool journaled)
+{
+    FileFormat targetFormat = outputs.first().format;
+    ResizeOptions resize = outputs.first().resize;
+    
+    QFileInfo fileInfo(inputPath);
+    QueuedJob job;
+    job.inputPath = inputPath;
+    job.targetFormat = targetFormat;
+    job.resize = resize;
+    job.extraOutputs = outputs.mid(1);
+    job.outputDirectory = outputDir;
+    job.directory = fileInfo.absolutePath();
+    job.fileId = localityOrdering ? InputPrefetcher::fileId(inputPath) : 0;
+    job.size = fileInfo.size();
+    job.checked = false;
+    job.backend = Backend::None;
+    job.attempts = 0;
+    job.queuedUs = trace ? trace->nowUs() : 0;
+    
+    if (journaled && journal && !journal->isPending(inputPath)) {
+        JobJournal::Entry entry;
+        entry.inputPath = inputPath;
+        entry.targetExtension = targetName(targetFormat);
+        entry.outputDirectory = outputDir;
+        entry.resize = resize.toString();
+        QStringList extras;
+        for (const OutputSpec &extra : job.extraOutputs) {
+            extras << extra.toString();
+        }
+        entry.extraOutputs = extras.join(',');
+        entry.submittedMs = QDateTime::currentMSecsSinceEpoch();
+        journal->recordSubmitted(entry);
+    }
+    
+    if (detectFormat(inputPath) == FileFormat::ZIP) {
+        startArchive(inputPath, targetFormat, outputDir, resize);
+        return;
+    }
+    // The check runs while the job waits in the queue
+    enqueue(job);
+    preflight->check(inputPath, detectFormat(inputPath), targetFormat);
+}
+
+void Converter::onPreflightChecked(const QString &inputPath, const QString &reason)
+{
+    // Cancelled jobs are gone from the queue; their result is dropped
+    for (auto it = conversionQueue.begin(); it != conversionQueue.end(); ++it) {
+        if (it.value().inputPath != inputPath || it.value().checked) {
+            continue;
+        }
+        if (reason.isEmpty()) {
+            it.value().checked = true;
+            startNextQueuedConversion();
+        } else {
+            conversionQueue.erase(it);
+            prefetcher.release(inputPath);
+            emit conversionError(inputPath, reason);
+            scheduleFinalize();
+        }
+        return;
+    }
+}
+
+void Converter::startArchive(const QString &inputPath, FileFormat targetFormat, const QString &outputDir,
+                             const ResizeOptions &resize)
+{
+    QString outDir = outputDir.isEmpty() ? QFileInfo(inputPath).absolutePath() : outputDir;
+    stagingParents.insert(outDir);
+    ArchiveJob *archive = new ArchiveJob(this, inputPath, targetFormat, resize, outDir,
+                                         maxParallelConversions, archiveMemoryBudget, this);
+    archiveJobs[inputPath] = archive;
+    
+    connect(archive, &ArchiveJob::progress, this, [this, inputPath](int percent) {
+        emit conversionProgress(inputPath, percent);
+    });
+    connect(archive, &ArchiveJob::entryError, this, &Converter::conversionError);
+    connect(archive, &ArchiveJob::finished, this, &Converter::onArchiveFinished);
+    
+    // Entries are queued from the event loop so the caller can finish submitting first
+    QMetaObject::invokeMethod(archive, [this, archive, inputPath]() {
+        emit conversionStarted(inputPath);
+        archive->start();
+    }, Qt::QueuedConnection);
+}
+
+void Converter::onArchiveFinished(ConversionStatus status, const QString &outputPath, const QString &errorMessage)
+{
+    ArchiveJob *archive = qobject_cast<ArchiveJob*>(sender());
+    QString inputPath = archiveJobs.key(archive);
+    if (!archive || inputPath.isEmpty()) {
+        return;
+    }
+    archiveJobs.remove(inputPath);
+    archive->deleteLater();
+    
+    if (status == ConversionStatus::Failed && !errorMessage.isEmpty()) {
+        emit conversionError(inputPath, errorMessage);
+    } else {
+        emit conversionFinished(inputPath, status, outputPath);
+    }
+    // May be reached from inside cancelConversion()
+    scheduleFinalize();
+}
+
+void Converter::enqueue(const QueuedJob &job)
+{
+    // With locality ordering, sorted by directory, then inode, so consecutive
+    // jobs read neighbouring blocks. Equal keys keep their drop order.
+    QueueKey key;
+    key.band = 1;
+    key.fileId = 0;
+    if (localityOrdering) {
+        key.directory = job.directory;
+        key.fileId = job.fileId;
+    }
+    key.sequence = ++queueSequence;
+    conversionQueue.insert(key, job);
+}
+
+void Converter::enqueueAtHead(const QueuedJob &job)
+{
+    QueueKey key;
+    key.band = 0;
+    key.fileId = 0;
+    key.sequence = -++queueSequence;
+    conversionQueue.insert(key, job);
+}
+
+void Converter::prefetchQueueHead()
+{
+    auto it = conversionQueue.cbegin();
+    for (int i = 0; i < prefetcher.depth() && it != conversionQueue.cend(); ++i, ++it) {
+        const QueuedJob &job = it.value();
+        // Empty files and files larger than the whole budget are never read
+        // ahead; the jobs behind them still are
+        if (job.size <= 0 || job.size > prefetcher.memoryBudget()) {
+            continue;
+        }
+        if (!prefetcher.prefetch(job.inputPath, job.size)) {
+            break; // Budget exhausted; retry once running jobs drain the queue head
+        }
+    }
+}
+
+const QList<Converter::Capability> &Converter::capabilities()
+{
+    static const QList<Capability> table = []() {
+        const QList<FileFormat> images = {FileFormat::JPG, FileFormat::PNG, FileFormat::WEBP};
+        QList<FileFormat> heifTargets;
+        for (FileFormat format : images) {
+            if (HeifDecoder::canConvertTo(format)) {
+                heifTargets << format;
+            }
+        }
+        // The router picks by expected run time; the first row for a pair is
+        // the one backendFor() names. Seeds are rough figures for a current
+        // desktop; soffice pays for loading the office suite on every start.
+        QList<Capability> rows;
+        rows << Capability{Backend::LibreOfficeExport, {FileFormat::DOCX, FileFormat::PPTX},
+                           {FileFormat::PDF, FileFormat::PDFA, FileFormat::PNG}, true, 3000, 400};
+        rows << Capability{Backend::LibreOfficeImport, {FileFormat::PDF},
+                           {FileFormat::DOCX, FileFormat::PPTX}, true, 4000, 1500};
+        rows << Capability{Backend::ImageMagick, images + QList<FileFormat>{FileFormat::HEIC}, images, true, 150, 80};
+        rows << Capability{Backend::Libheif, {FileFormat::HEIC}, heifTargets, true, 20, 60};
+        // JPEG data is copied as it is; ImageMagick decodes and re-encodes,
+        // but reads images the assembler cannot
+        rows << Capability{Backend::PdfAssembly, images, {FileFormat::PDF}, true, 5, 10};
+        rows << Capability{Backend::ImageMagick, images, {FileFormat::PDF}, true, 200, 120};
+        // Writes many files, which only a local slot can publish
+        rows << Capability{Backend::PdfRaster, {FileFormat::PDF}, images, false, 100, 300};
+        rows << Capability{Backend::Spreadsheet, {FileFormat::XLSX}, {FileFormat::CSV}, true, 5, 150};
+        rows << Capability{Backend::Spreadsheet, {FileFormat::CSV}, {FileFormat::XLSX}, true, 5, 150};
+        return rows;
+    }();
+    return table;
+}
+
+QList<int> Converter::capabilitiesFor(FileFormat sourceFormat, const QList<FileFormat> &targetFormats,
+                                      const QList<Backend> &excluded)
+{
+    const QList<Capability> &table = capabilities();
+    QList<int> rows;
+    for (int row = 0; row < table.size(); ++row) {
+        const Capability &capability = table[row];
+        bool covers = capability.sources.contains(sourceFormat) && !excluded.contains(capability.backend);
+        for (FileFormat format : targetFormats) {
+            covers = covers && capability.targets.contains(format);
+        }
+        if (covers) {
+            rows << row;
+        }
+    }
+    return rows;
+}
+
+Converter::Backend Converter::backendFor(FileFormat sourceFormat, FileFormat targetFormat)
+{
+    QList<int> rows = capabilitiesFor(sourceFormat, QList<FileFormat>() << targetFormat);
+    return rows.isEmpty() ? Backend::None : capabilities()[rows.first()].backend;
+}
+
+bool Converter::canConvert(FileFormat sourceFormat, FileFormat targetFormat)
+{
+    return backendFor(sourceFormat, targetFormat) != Backend::None;
+}
+
+QList<Converter::FileFormat> Converter::targetFormats(const QueuedJob &job)
+{
+    QList<FileFormat> formats = QList<FileFormat>() << job.targetFormat;
+    for (const OutputSpec &extra : job.extraOutputs) {
+        formats << extra.format;
+    }
+    return formats;
+}
+
+QList<Converter::FileFormat> Converter::targetFormats(const ConversionJob &job)
+{
+    QList<FileFormat> formats = QList<FileFormat>() << job.targetFormat;
+    for (const StagedOutput &extra : job.extraOutputs) {
+        formats << extra.format;
+    }
+    return formats;
+}
+
+QString Converter::costKey(int capability, FileFormat sourceFormat, const QList<FileFormat> &targetFormats,
+                           bool remote)
+{
+    // "local/ImageMagick/heic>jpg,webp"
+    QStringList targets;
+    for (FileFormat format : targetFormats) {
+        targets << targetName(format);
+    }
+    return QString("%1/%2/%3>%4").arg(remote ? "remote" : "local", backendName(capabilities()[capability].backend),
+                                      formatToExtension(sourceFormat), targets.join(','));
+}
+
+CostModel Converter::costSeed(int capability, bool remote)
+{
+    // A worker also pays for sending the input and fetching the output
+    const Capability &row = capabilities()[capability];
+    return remote ? CostModel(row.startupMs + RemoteStartupMs, row.msPerMB + RemoteMsPerMB)
+                  : CostModel(row.startupMs, row.msPerMB);
+}
+
+CostModel Converter::costModel(int capability, FileFormat sourceFormat, const QList<FileFormat> &targetFormats,
+                               bool remote) const
+{
+    return throughputStats->model(costKey(capability, sourceFormat, targetFormats, remote),
+                                  costSeed(capability, remote));
+}
+
+int Converter::cheapestCapability(FileFormat sourceFormat, const QList<FileFormat> &targetFormats, qint64 size,
+                                  const QList<Backend> &excluded, Backend pinned, double *estimateMs) const
+{
+    int cheapest = -1;
+    const QList<int> rows = capabilitiesFor(sourceFormat, targetFormats, excluded);
+    for (int row : rows) {
+        if (pinned != Backend::None && capabilities()[row].backend != pinned) {
+            continue;
+        }
+        double ms = costModel(row, sourceFormat, targetFormats, false).estimateMs(size);
+        if (cheapest == -1 || ms < *estimateMs) {
+            cheapest = row;
+            *estimateMs = ms;
+        }
+    }
+    return cheapest;
+}
+
+double Converter::localWaitMs() const
+{
+    if (localConversions() < maxParallelConversions) {
+        return 0;
+    }
+    // The first running job expected to end frees its slot; streams and
+    // merges have no estimate, so a worker beats waiting for them
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    double wait = std::numeric_limits<double>::infinity();
+    for (auto it = activeJobs.constBegin(); it != activeJobs.constEnd(); ++it) {
+        const ConversionJob &job = it.value();
+        if (!job.remote && job.capability >= 0) {
+            wait = qMin(wait, expectedLeftMs(job, now));
+        }
+    }
+    return wait;
+}
+
+double Converter::expectedLeftMs(const ConversionJob &job, qint64 now) const
+{
+    // One that ran past its estimate is taken to need half as long again
+    double elapsedMs = now - job.startedMs;
+    double expectedMs = costModel(job.capability, detectFormat(job.inputPath), targetFormats(job), job.remote != nullptr)
+                        .estimateMs(job.inputSize);
+    return qMax(expectedMs - elapsedMs, elapsedMs / 2);
+}
+
+void Converter::recordCost(const ConversionJob &job)
+{
+    if (job.capability < 0) {
+        return;
+    }
+    bool remote = job.remote != nullptr;
+    throughputStats->record(costKey(job.capability, detectFormat(job.inputPath), targetFormats(job), remote),
+                            costSeed(job.capability, remote), job.inputSize,
+                            QDateTime::currentMSecsSinceEpoch() - job.startedMs);
+}
+
+int Converter::backendAttempts(Backend backend)
+{
+    switch (backend) {
+        // soffice crashes on load now and then, and rarely twice in a row
+        case Backend::LibreOfficeExport:
+        case Backend::LibreOfficeImport:
+            return 3;
+        case Backend::ImageMagick:
+            return 2;
+        default:
+            // In process the same code fails the same way on the same bytes;
+            // rendered pages are already published and cannot be redone
+            return 1;
+    }
+}
+
+QString Converter::backendName(Backend backend)
+{
+    switch (backend) {
+        case Backend::LibreOfficeExport:
+        case Backend::LibreOfficeImport:
+            return "LibreOffice";
+        case Backend::ImageMagick:
+            return "ImageMagick";
+        case Backend::PdfRaster:
+            return "pdftoppm";
+        case Backend::PdfAssembly:
+            return "PDF assembler";
+        case Backend::Spreadsheet:
+            return "spreadsheet converter";
+        case Backend::Libheif:
+            return "libheif";
+        case Backend::Remote:
+            return "remote worker";
+        default:
+            return "none";
+    }
+}
+
+int Converter::localConversions() const
+{
+    int count = streamJobs.size();
+    for (auto it = activeJobs.constBegin(); it != activeJobs.constEnd(); ++it) {
+        if (!it.value().remote) {
+            count++;
+        }
+    }
+    return count;
+}
+
+int Converter::threadsInUse() const
+{
+    int count = streamJobs.size();
+    for (auto it = activeJobs.constBegin(); it != activeJobs.constEnd(); ++it) {
+        count += it.value().threads;
+    }
+    return count;
+}
+
+int Converter::threadGrant() const
+{
+    // Idle cores are shared between the slots still free, so one job can use
+    // the whole machine while others still get a fair share later
+    int cores = qMax(maxParallelConversions, QThread::idealThreadCount());
+    int freeSlots = qMax(1, maxParallelConversions - localConversions());
+    return qMax(1, (cores - threadsInUse()) / freeSlots);
+}
+
+void Converter::startNextQueuedConversion()
+{
+    while (!conversionQueue.isEmpty()) {
+        const QueuedJob &head = conversionQueue.first();
+        if (!head.checked) {
+            break;  // Its check reports back in a moment and restarts the queue
+        }
+        // The backend expected to finish first. A local slot may first have
+        // to free up; a worker slot is free or not offered at all.
+        FileFormat sourceFormat = detectFormat(head.inputPath);
+        QList<FileFormat> formats = targetFormats(head);
+        double runMs = 0;
+        int capability = cheapestCapability(sourceFormat, formats, head.size, head.failedBackends, head.backend, &runMs);
+        double localFinishMs = localWaitMs() + runMs;
+        Backend backend = capability == -1 ? Backend::None : capabilities()[capability].backend;
+        
+        int worker = -1;
+        if (backend != Backend::None) {
+            // Fan-out jobs share one decode or load, and page rendering writes
+            // many files; only a local slot can do either
+            if (head.extraOutputs.isEmpty() && capabilities()[capability].remote && head.backend == Backend::None
+                && !head.failedBackends.contains(Backend::Remote)
+                && costModel(capability, sourceFormat, formats, true).estimateMs(head.size) < localFinishMs) {
+                worker = workerPool->acquire(head.triedWorkers);
+            }
+            if (worker == -1 && localConversions() >= maxParallelConversions) {
+                if (trace) {
+                    trace->instant("slots full", "scheduler", TraceRecorder::SchedulerLane,
+                                   QString("%1 queued").arg(conversionQueue.size()));
+                }
+                break;
+            }
+        }
+        
+        QueuedJob job = conversionQueue.first();
+        conversionQueue.erase(conversionQueue.begin());
+        QString inputPath = job.inputPath;
+        FileFormat targetFormat = job.targetFormat;
+        prefetcher.release(inputPath);
+        qint64 dequeuedUs = 0;
+        if (trace) {
+            dequeuedUs = trace->nowUs();
+            trace->asyncSpan("queue", "job", job.queuedUs, dequeuedUs, QFileInfo(inputPath).fileName());
+        }
+        
+        if (backend == Backend::None) {
+            emit conversionStarted(inputPath);
+            emit conversionFinished(inputPath, ConversionStatus::Unsupported, "");
+            scheduleFinalize();
+            continue;
+        }
+        
+        QFileInfo fileInfo(inputPath);
+        
+        // Use outputDirectory if set, otherwise use same directory as input
+        QString outDir = job.outputDirectory.isEmpty() ? fileInfo.absolutePath() : job.outputDirectory;
+        
+        // Tools write into a private staging directory; the result is renamed
+        // into outDir once the tool has exited. Slow volumes stage in local
+        // scratch instead and are copied by the publisher.
+        bool writeBehind = useWriteBehind(outDir);
+        QString stagingParent = writeBehind ? OutputStaging::scratchDirectory() : outDir;
+        stagingParents.insert(stagingParent);
+        QString stagingDir = OutputStaging::createStagingDirectory(stagingParent);
+        if (stagingDir.isEmpty()) {
+            workerPool->release(worker, false);
+            emit conversionError(inputPath, "Could not create staging directory in " + stagingParent);
+            continue;
+        }
+        bool fanOut = !job.extraOutputs.isEmpty();
+        StagedOutput primary;
+        primary.format = targetFormat;
+        primary.resize = job.resize;
+        primary.outputPath = stagingDir + "/" + outputBaseName(fileInfo, targetFormat, job.resize, fanOut)
+                             + "." + formatToExtension(targetFormat);
+        primary.stagingDirectory = stagingDir;
+        QString outputPath = primary.outputPath;
+        
+        // Every further output gets a staging directory of its own, so each
+        // one is published (and can fail) independently
+        QList<StagedOutput> extras;
+        bool staged = true;
+        for (const OutputSpec &spec : job.extraOutputs) {
+            StagedOutput extra;
+            extra.format = spec.format;
+            extra.resize = spec.resize;
+            extra.stagingDirectory = OutputStaging::createStagingDirectory(stagingParent);
+            if (extra.stagingDirectory.isEmpty()) {
+                staged = false;
+                break;
+            }
+            extra.outputPath = extra.stagingDirectory + "/" + outputBaseName(fileInfo, spec.format, spec.resize, fanOut)
+                               + "." + formatToExtension(spec.format);
+            extras << extra;
+        }
+        if (!staged) {
+            for (const StagedOutput &extra : extras) {
+                OutputStaging::removeStagingDirectory(extra.stagingDirectory);
+            }
+            OutputStaging::removeStagingDirectory(stagingDir);
+            emit conversionError(inputPath, "Could not create staging directory in " + stagingParent);
+            continue;
+        }
+        QList<StagedOutput> outputs = QList<StagedOutput>() << primary << extras;
+
+        emit conversionStarted(inputPath);
+
+        if (worker != -1) {
+            startRemote(job, worker, outputPath);
+        } else {
+            switch (backend) {
+                case Backend::LibreOfficeExport:
+                    convertDocument(inputPath, outputs);
+                    break;
+                case Backend::LibreOfficeImport:
+                    convertPDFtoDocument(inputPath, outputPath, targetFormat);
+                    break;
+                case Backend::ImageMagick:
+                    convertImage(inputPath, outputs);
+                    break;
+                case Backend::Libheif:
+                    convertHeifInProcess(inputPath, outputs);
+                    break;
+                case Backend::PdfRaster:
+                    convertPdfToImages(inputPath, primary);
+                    break;
+                case Backend::PdfAssembly:
+                    convertImagesToPdf(inputPath, QStringList() << inputPath, primary);
+                    break;
+                case Backend::Spreadsheet:
+                    convertSpreadsheet(inputPath, primary);
+                    break;
+                case Backend::Remote:
+                case Backend::None:
+                    break;
+            }
+        }
+        
+        if (activeJobs.contains(inputPath)) {
+            ConversionJob &active = activeJobs[inputPath];
+            active.outputDirectory = outDir;
+            active.stagingDirectory = stagingDir;
+            active.writeBehind = writeBehind;
+            active.targetFormat = targetFormat;
+            active.resize = job.resize;
+            active.extraOutputs = extras;
+            active.triedWorkers = job.triedWorkers;
+            active.backend = worker != -1 ? Backend::Remote : backend;
+            active.capability = capability;
+            active.failedBackends = job.failedBackends;
+            active.attempts = job.attempts;
+            active.inputSize = job.size;
+            active.startedMs = QDateTime::currentMSecsSinceEpoch();
+            if (trace) {
+                active.lane = acquireTraceLane();
+                active.dequeuedUs = dequeuedUs;
+                // A tool process is running once it reports started
+                if (!active.process) {
+                    active.runningUs = trace->nowUs();
+                }
+                trace->instant("route", "scheduler", TraceRecorder::SchedulerLane,
+                               QString("%1 to %2 on slot %3: expected %4 ms, local wait %5 ms")
+                                   .arg(fileInfo.fileName(), backendName(active.backend))
+                                   .arg(active.lane).arg(qRound64(runMs))
+                                   .arg(qRound64(localFinishMs - runMs)));
+            }
+            emit conversionRouted(inputPath, backendName(active.backend), job.attempts + 1);
+        } else {
+            for (const StagedOutput &output : outputs) {
+                OutputStaging::removeStagingDirectory(output.stagingDirectory);
+            }
+        }
+    }
+    
+    prefetchQueueHead();
+}
+
+void Converter::cancelConversion(const QString &inputPath)
+{
+    if (ArchiveJob *archive = archiveJobs.value(inputPath)) {
+        archive->cancel();
+        return;
+    }
+    
+    if (PipeJob *stream = streamJobs.take(inputPath)) {
+        stream->disconnect(this);
+        stream->abort();
+        stream->deleteLater();
+        emit conversionFinished(inputPath, ConversionStatus::Cancelled, "");
+        scheduleFinalize();
+        return;
+    }
+    
+    // Check queue first
+    for (auto it = conversionQueue.begin(); it != conversionQueue.end(); ++it) {
+        if (it.value().inputPath == inputPath) {
+            conversionQueue.erase(it);
+            prefetcher.release(inputPath);
+            emit conversionFinished(inputPath, ConversionStatus::Cancelled, "");
+            return;
+        }
+    }
+    if (delayedRetries.remove(inputPath)) {
+        emit conversionFinished(inputPath, ConversionStatus::Cancelled, "");
+        scheduleFinalize();
+        return;
+    }
+    
+    // Check active jobs
+    if (activeJobs.contains(inputPath)) {
+        ConversionJob &job = activeJobs[inputPath];
+        job.cancelled = true;
+        if (job.process) {
+            job.process->kill();
+        }
+        if (job.remote) {
+            QMetaObject::invokeMethod(job.remote, &RemoteJob::abort, Qt::QueuedConnection);
+        }
+        if (job.raster) {
+            QMetaObject::invokeMethod(job.raster, &PdfRasterJob::abort, Qt::QueuedConnection);
+        }
+    }
+}
+
+void Converter::cancelAll()
+{
+    // Archives first, so they do not queue more entries as theirs are cancelled
+    const QStringList archives = archiveJobs.keys();
+    for (const QString &archivePath : archives) {
+        cancelConversion(archivePath);
+    }
+    
+    // Clear queue
+    QList<QueuedJob> queueCopy = conversionQueue.values();
+    conversionQueue.clear();
+    prefetcher.releaseAll();
+    
+    for (const auto &job : queueCopy) {
+        emit conversionFinished(job.inputPath, ConversionStatus::Cancelled, "");
+    }
+    const QStringList retries = delayedRetries.keys();
+    delayedRetries.clear();
+    for (const QString &inputPath : retries) {
+        emit conversionFinished(inputPath, ConversionStatus::Cancelled, "");
+    }
+    // Posted jobs not yet taken; any posted from now on still run
+    Submission submission;
+    while (submissions.pop(&submission)) {
+        postedJobs.fetch_sub(1, std::memory_order_acq_rel);
+        emit conversionFinished(submission.inputPath, ConversionStatus::Cancelled, "");
+    }
+
+    const QStringList streamIds = streamJobs.keys();
+    for (const QString &streamId : streamIds) {
+        cancelConversion(streamId);
+    }
+    
+    // Kill active processes
+    for (auto it = activeJobs.begin(); it != activeJobs.end(); ++it) {
+        it.value().cancelled = true;
+        if (it.value().process) {
+            it.value().process->kill();
+        }
+        if (it.value().remote) {
+            // Queued: abort() reports back synchronously and would modify activeJobs
+            QMetaObject::invokeMethod(it.value().remote, &RemoteJob::abort, Qt::QueuedConnection);
+        }
+        if (it.value().raster) {
+            QMetaObject::invokeMethod(it.value().raster, &PdfRasterJob::abort, Qt::QueuedConnection);
+        }
+    }
+}
+
+int Converter::acquireProfileSlot()
+{
+    int slot = profileSlotsInUse.indexOf(false);
+    if (slot == -1) {
+        slot = profileSlotsInUse.size();
+        profileSlotsInUse.append(true);
+    } else {
+        profileSlotsInUse[slot] = true;
+    }
+    return slot;
+}
+
+void Converter::releaseProfileSlot(int slot)
+{
+    if (slot >= 0 && slot < profileSlotsInUse.size()) {
+        profileSlotsInUse[slot] = false;
+    }
+}
+
+int Converter::acquireTraceLane()
+{
+    int slot = traceLanesInUse.indexOf(false);
+    if (slot == -1) {
+        slot = traceLanesInUse.size();
+        traceLanesInUse.append(true);
+    } else {
+        traceLanesInUse[slot] = true;
+    }
+    return TraceRecorder::slotLane(slot);
+}
+
+void Converter::releaseTraceLane(int lane)
+{
+    int slot = lane - TraceRecorder::slotLane(0);
+    if (slot >= 0 && slot < traceLanesInUse.size()) {
+        traceLanesInUse[slot] = false;
+    }
+}
+
+void Converter::traceRun(const ConversionJob &job)
+{
+    if (!trace || job.lane == -1) {
+        return;
+    }
+    // The lane stays the job's until the next start, so the output spans
+    // recorded after this still land on it
+    qint64 now = trace->nowUs();
+    QString name = QFileInfo(job.inputPath).fileName();
+    if (job.runningUs == 0) {
+        trace->span("spawn", "job", job.lane, job.dequeuedUs, now, name + " (never started)");
+    } else {
+        trace->span("spawn", "job", job.lane, job.dequeuedUs, job.runningUs, name);
+        trace->span("run", "job", job.lane, job.runningUs, now, backendName(job.backend) + ": " + name);
+    }
+    releaseTraceLane(job.lane);
+}
+
+QString Converter::profileDirectory(int slot)
+{
+    // Profiles are reused across jobs so only the first job per slot pays for
+    // profile creation; the process id keeps separate FileConverter processes
+    // (e.g. several workers on one machine) apart. The destructor removes them.
+    return QStandardPaths::writableLocation(QStandardPaths::TempLocation)
+           + QString("/FileConverter/lo-profile-%1-%2").arg(QCoreApplication::applicationPid()).arg(slot);
+}
+
+QString Converter::profileArgument(int slot)
+{
+    return "-env:UserInstallation=" + QUrl::fromLocalFile(profileDirectory(slot)).toString();
+}
+
+void Converter::startProcess(const QString &inputPath, const QString &outputPath,
+                             const QString &program, const QStringList &args, int profileSlot,
+                             const QProcessEnvironment &environment)
+{
+    QProcess *process = new QProcess(this);
+    if (!environment.isEmpty()) {
+        process->setProcessEnvironment(environment);
+    }
+    
+    ConversionJob job;
+    job.process = process;
+    job.profileSlot = profileSlot;
+    job.inputPath = inputPath;
+    job.outputPath = outputPath;
+    activeJobs[inputPath] = job;
+    
+    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, &Converter::onProcessFinished);
+    connect(process, &QProcess::errorOccurred, this, &Converter::onProcessError);
+    if (trace) {
+        connect(process, &QProcess::started, this, [this, inputPath, process]() {
+            auto it = activeJobs.find(inputPath);
+            if (it != activeJobs.end() && it.value().process == process) {
+                it.value().runningUs = trace->nowUs();
+            }
+        });
+    }
+
+    process->start(program, args);
+}
+
+void Converter::startRemote(const QueuedJob &job, int workerIndex, const QString &outputPath)
+{
+    RemoteJob *remote = new RemoteJob(workerPool->endpoint(workerIndex), job.inputPath,
+                                      targetName(job.targetFormat), job.resize.toString(),
+                                      outputPath, this);
+    
+    ConversionJob active;
+    active.remote = remote;
+    active.workerIndex = workerIndex;
+    active.threads = 0;
+    active.inputPath = job.inputPath;
+    active.outputPath = outputPath;
+    activeJobs[job.inputPath] = active;
+    
+    connect(remote, &RemoteJob::finished, this, &Converter::onRemoteFinished);
+    remote->start();
+}
+
+void Converter::convertHeifInProcess(const QString &inputPath, const QList<StagedOutput> &outputs)
+{
+    int threads = threadGrant();
+    
+    ConversionJob job;
+    job.threads = threads;
+    job.inProcess = true;
+    job.inputPath = inputPath;
+    job.outputPath = outputs.first().outputPath;
+    activeJobs[inputPath] = job;
+    
+    QList<HeifDecoder::Target> targets;
+    for (const StagedOutput &output : outputs) {
+        HeifDecoder::Target target;
+        target.outputPath = output.outputPath;
+        target.format = output.format;
+        target.resize = output.resize;
+        targets << target;
+    }
+    heifDecoder->convert(inputPath, targets, threads);
+}
+
+void Converter::onHeifConverted(const QString &inputPath, const QStringList &errorMessages)
+{
+    auto it = activeJobs.find(inputPath);
+    if (it == activeJobs.end() || !it.value().inProcess) {
+        return;
+    }
+    ConversionJob job = it.value();
+    activeJobs.erase(it);
+    traceRun(job);
+    
+    // The decode cannot be interrupted, so a cancel only discards its result
+    if (job.cancelled) {
+        discardStaging(job);
+        emit conversionFinished(job.inputPath, ConversionStatus::Cancelled, "");
+        finalizeConversion();
+        return;
+    }
+    
+    // One message per output, empty where that output was written
+    const QList<StagedOutput> outputs = stagedOutputs(job);
+    bool anyWritten = false;
+    for (int i = 0; i < outputs.size(); ++i) {
+        anyWritten = anyWritten || errorMessages.value(i).isEmpty();
+    }
+    if (!anyWritten) {
+        // Nothing decoded: ImageMagick gets the whole job
+        discardStaging(job);
+        retryOrFallBack(job, "Conversion failed: " + errorMessages.value(0), false);
+        finalizeConversion();
+        return;
+    }
+    recordCost(job);
+    for (int i = 0; i < outputs.size(); ++i) {
+        QString errorMessage = errorMessages.value(i);
+        if (errorMessage.isEmpty()) {
+            publishStaged(job.inputPath, outputs[i], job.outputDirectory, job.writeBehind);
+        } else {
+            OutputStaging::removeStagingDirectory(outputs[i].stagingDirectory);
+            emit conversionError(job.inputPath, "Conversion failed: " + errorMessage);
+        }
+    }
+    finalizeConversion();
+}
+
+void Converter::convertImagesToPdf(const QString &jobId, const QStringList &imagePaths, const StagedOutput &output)
+{
+    ConversionJob job;
+    job.inProcess = true;
+    job.inputPath = jobId;
+    job.outputPath = output.outputPath;
+    activeJobs[jobId] = job;
+    
+    pdfAssembler->assemble(jobId, imagePaths, output.outputPath);
+}
+
+void Converter::convertSpreadsheet(const QString &inputPath, const StagedOutput &output)
+{
+    ConversionJob job;
+    job.inProcess = true;
+    job.inputPath = inputPath;
+    job.outputPath = output.outputPath;
+    activeJobs[inputPath] = job;
+    
+    spreadsheetConverter->convert(inputPath, inputPath, output.outputPath, output.format);
+}
+
+void Converter::onInProcessFinished(const QString &jobId, const QString &errorMessage)
 {
-    if (!QFileInfo::exists(inputPath)) {
-        emit conversionError(inputPath, "File does not exist");
+    auto it = activeJobs.find(jobId);
+    if (it == activeJobs.end() || !it.value().inProcess) {
         return;
     }
-
-    FileFormat sourceFormat = detectFormat(inputPath);
-    if (sourceFormat == FileFormat::Unknown) {
-        emit conversionError(inputPath, "Unsupported file format");
-        return;
+    ConversionJob job = it.value();
+    activeJobs.erase(it);
+    traceRun(job);
+    
+    // Like a HEIC decode, a cancel only discards the result
+    if (job.cancelled) {
+        discardStaging(job);
+        emit conversionFinished(job.inputPath, ConversionStatus::Cancelled, "");
+    } else if (!errorMessage.isEmpty()) {
+        discardStaging(job);
+        retryOrFallBack(job, "Conversion failed: " + errorMessage, false);
+    } else {
+        publishOutput(job);
     }
+    finalizeConversion();
+}
 
-    // Check if already converting this file
-    if (activeJobs.contains(inputPath)) {
-        emit conversionError(inputPath, "File is already being converted");
+void Converter::convertPdfToImages(const QString &inputPath, const StagedOutput &output)
+{
+    if (pdfRendererPath.isEmpty()) {
+        emit conversionError(inputPath, "pdftoppm not found. Please install Poppler.");
         return;
     }
-
-    // Add to queue
-    conversionQueue.append(qMakePair(inputPath, targetFormat));
     
-    // Start conversion if we have capacity
-    startNextQueuedConversion();
+    // Pages are rendered into the job's staging directory; each one is moved
+    // into a staging directory of its own when its run is done
+    int threads = threadGrant();
+    PdfRasterJob *raster = new PdfRasterJob(pdfRendererPath, inputPath, output.format, rasterDpi, rasterPages,
+                                            output.stagingDirectory, threads, this);
+    
+    ConversionJob job;
+    job.raster = raster;
+    job.threads = threads;
+    job.inputPath = inputPath;
+    job.outputPath = output.outputPath;
+    activeJobs[inputPath] = job;
+    
+    connect(raster, &PdfRasterJob::progress, this, [this, inputPath](int percent) {
+        emit conversionProgress(inputPath, percent);
+    });
+    connect(raster, &PdfRasterJob::pagesRendered, this, &Converter::onRasterPages);
+    connect(raster, &PdfRasterJob::finished, this, &Converter::onRasterFinished);
+    
+    // Started from the event loop: a failure to start reports back at once
+    // and must not land inside startNextQueuedConversion()
+    QMetaObject::invokeMethod(raster, &PdfRasterJob::start, Qt::QueuedConnection);
 }
 
-void Converter::startNextQueuedConversion()
+void Converter::onRasterPages(const QStringList &pagePaths)
 {
-    while (activeJobs.size() < maxParallelConversions && !conversionQueue.isEmpty()) {
-        auto job = conversionQueue.takeFirst();
-        QString inputPath = job.first;
-        FileFormat targetFormat = job.second;
-        
-        FileFormat sourceFormat = detectFormat(inputPath);
-        QFileInfo fileInfo(inputPath);
-        
-        // Use outputDirectory if set, otherwise use same directory as input
-        QString outDir = outputDirectory.isEmpty() ? fileInfo.absolutePath() : outputDirectory;
-        QString outputPath = outDir + "/" + fileInfo.baseName() + "." + formatToExtension(targetFormat);
-
-        emit conversionStarted(inputPath);
-
-        // Document to PDF conversions (DOCX/PPTX -> PDF)
-        if ((sourceFormat == FileFormat::DOCX || sourceFormat == FileFormat::PPTX) && targetFormat == FileFormat::PDF) {
-            convertDocumentToPDF(inputPath, outputPath);
-        }
-        // PDF to document conversions (PDF -> DOCX/PPTX)
-        else if (sourceFormat == FileFormat::PDF && (targetFormat == FileFormat::DOCX || targetFormat == FileFormat::PPTX)) {
-            convertPDFtoDocument(inputPath, outputPath, targetFormat);
-        }
-        // Image conversions (including HEIC as source - HEIC can be converted TO other formats but not FROM)
-        else if ((sourceFormat == FileFormat::JPG || sourceFormat == FileFormat::PNG || sourceFormat == FileFormat::WEBP || sourceFormat == FileFormat::HEIC) &&
-                 (targetFormat == FileFormat::JPG || targetFormat == FileFormat::PNG || targetFormat == FileFormat::WEBP)) {
-            convertImage(inputPath, outputPath, targetFormat);
-        }
-        else {
-            emit conversionFinished(inputPath, ConversionStatus::Unsupported, "");
-        }
+    PdfRasterJob *raster = qobject_cast<PdfRasterJob*>(sender());
+    if (!raster) return;
+    
+    auto it = activeJobs.begin();
+    while (it != activeJobs.end() && it.value().raster != raster) {
+        ++it;
     }
-}
-
-void Converter::cancelConversion(const QString &inputPath)
-{
-    // Check queue first
-    for (int i = 0; i < conversionQueue.size(); ++i) {
-        if (conversionQueue[i].first == inputPath) {
-            conversionQueue.removeAt(i);
-            emit conversionFinished(inputPath, ConversionStatus::Cancelled, "");
-            return;
-        }
+    // A cancelled job's pages are discarded with its staging directory
+    if (it == activeJobs.end() || it.value().cancelled) {
+        return;
     }
+    const ConversionJob job = it.value();
     
-    // Check active jobs
-    if (activeJobs.contains(inputPath)) {
-        ConversionJob &job = activeJobs[inputPath];
-        job.cancelled = true;
-        if (job.process) {
-            job.process->kill();
+    // Next to the job's own staging directory, under the same root
+    QString stagingParent = QDir::cleanPath(job.stagingDirectory + "/../..");
+    for (const QString &pagePath : pagePaths) {
+        // A pdftoppm that died mid-run can leave its last page cut short
+        QString damage = OutputVerifier::verify(pagePath, job.targetFormat);
+        if (!damage.isEmpty()) {
+            QFile::remove(pagePath);
+            emit conversionError(job.inputPath, "Output is damaged: " + QFileInfo(pagePath).fileName() + ": " + damage);
+            continue;
         }
+        StagedOutput page;
+        page.format = job.targetFormat;
+        page.stagingDirectory = OutputStaging::createStagingDirectory(stagingParent);
+        page.outputPath = page.stagingDirectory + "/" + QFileInfo(pagePath).fileName();
+        if (page.stagingDirectory.isEmpty() || !QFile::rename(pagePath, page.outputPath)) {
+            OutputStaging::removeStagingDirectory(page.stagingDirectory);
+            emit conversionError(job.inputPath, "Could not stage " + QFileInfo(pagePath).fileName());
+            continue;
+        }
+        publishStaged(job.inputPath, page, job.outputDirectory, job.writeBehind);
     }
 }
 
-void Converter::cancelAll()
+void Converter::onRasterFinished(bool ok, const QString &errorMessage)
 {
-    // Clear queue
-    QList<QPair<QString, FileFormat>> queueCopy = conversionQueue;
-    conversionQueue.clear();
+    PdfRasterJob *raster = qobject_cast<PdfRasterJob*>(sender());
+    if (!raster) return;
     
-    for (const auto &job : queueCopy) {
-        emit conversionFinished(job.first, ConversionStatus::Cancelled, "");
-    }
+    ConversionJob job;
+    bool found = false;
     
-    // Kill active processes
     for (auto it = activeJobs.begin(); it != activeJobs.end(); ++it) {
-        it.value().cancelled = true;
-        if (it.value().process) {
-            it.value().process->kill();
+        if (it.value().raster == raster) {
+            job = it.value();
+            found = true;
+            activeJobs.erase(it);
+            break;
         }
     }
+    
+    raster->deleteLater();
+    
+    if (!found) return;
+    traceRun(job);
+    
+    // Only leftovers remain in staging; pages already published are kept,
+    // also when a later run failed
+    discardStaging(job);
+    if (job.cancelled) {
+        emit conversionFinished(job.inputPath, ConversionStatus::Cancelled, "");
+    } else if (!ok) {
+        emit conversionError(job.inputPath, "Conversion failed: " + errorMessage);
+    } else {
+        // Each page already reported its own conversionFinished
+        recordCost(job);
+        onJobCompleted(job.inputPath);
+    }
+    finalizeConversion();
 }
 
-void Converter::convertDocumentToPDF(const QString &inputPath, const QString &outputPath)
+void Converter::convertDocument(const QString &inputPath, const QList<StagedOutput> &outputs)
 {
     if (libreOfficePath.isEmpty()) {
         emit conversionError(inputPath, "LibreOffice not found. Please install LibreOffice.");
         return;
     }
 
-    QProcess *process = new QProcess(this);
+    FileFormat sourceFormat = detectFormat(inputPath);
+    QString outputPath = outputs.first().outputPath;
+    int profileSlot = acquireProfileSlot();
+    QStringList args;
+    args << profileArgument(profileSlot) << "--headless";
     
-    ConversionJob job;
-    job.process = process;
-    job.inputPath = inputPath;
-    job.outputPath = outputPath;
-    job.cancelled = false;
-    activeJobs[inputPath] = job;
+    if (outputs.size() == 1) {
+        args << "--convert-to" << DocumentExport::convertToArgument(sourceFormat, outputs.first().format)
+             << "--outdir" << QFileInfo(outputPath).absolutePath()
+             << inputPath;
+        startProcess(inputPath, outputPath, libreOfficePath, args, profileSlot);
+        return;
+    }
     
-    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &Converter::onProcessFinished);
-    connect(process, &QProcess::errorOccurred, this, &Converter::onProcessError);
-
-    QFileInfo outputInfo(outputPath);
-    QStringList args;
-    args << "--headless"
-         << "--convert-to" << "pdf"
-         << "--outdir" << outputInfo.absolutePath()
-         << inputPath;
-
-    process->start(libreOfficePath, args);
+    // --convert-to loads the document again for every format; the macro
+    // loads it once and runs each export filter on the same layout
+    QString errorMessage;
+    if (!DocumentExport::installMacro(profileDirectory(profileSlot), &errorMessage)) {
+        releaseProfileSlot(profileSlot);
+        emit conversionError(inputPath, errorMessage);
+        return;
+    }
+    QList<DocumentExport::Target> targets;
+    for (const StagedOutput &output : outputs) {
+        DocumentExport::Target target;
+        target.format = output.format;
+        target.outputPath = output.outputPath;
+        targets << target;
+    }
+    args << "--norestore" << DocumentExport::macroUrl();
+    startProcess(inputPath, outputPath, libreOfficePath, args, profileSlot,
+                 DocumentExport::environment(inputPath, sourceFormat, targets));
 }
 
 void Converter::convertPDFtoDocument(const QString &inputPath, const QString &outputPath, FileFormat targetFormat)
@@ -226,19 +1863,6 @@ void Converter::convertPDFtoDocument(const QString &inputPath, const QString &ou
         return;
     }
 
-    QProcess *process = new QProcess(this);
-    
-    ConversionJob job;
-    job.process = process;
-    job.inputPath = inputPath;
-    job.outputPath = outputPath;
-    job.cancelled = false;
-    activeJobs[inputPath] = job;
-    
-    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &Converter::onProcessFinished);
-    connect(process, &QProcess::errorOccurred, this, &Converter::onProcessError);
-
     QFileInfo outputInfo(outputPath);
     
     // LibreOffice PDF to DOCX: use writer_pdf_import filter and appropriate export filter
@@ -255,43 +1879,66 @@ void Converter::convertPDFtoDocument(const QString &inputPath, const QString &ou
         formatStr = "docx";
     }
     
+    int profileSlot = acquireProfileSlot();
     QStringList args;
-    args << "--headless"
+    args << profileArgument(profileSlot)
+         << "--headless"
          << QString("--infilter=%1").arg(infilter)
          << "--convert-to" << formatStr
          << "--outdir" << outputInfo.absolutePath()
          << inputPath;
 
-    process->start(libreOfficePath, args);
+    startProcess(inputPath, outputPath, libreOfficePath, args, profileSlot);
 }
 
-void Converter::convertImage(const QString &inputPath, const QString &outputPath, FileFormat targetFormat)
+void Converter::convertImage(const QString &inputPath, const QList<StagedOutput> &outputs)
 {
-    Q_UNUSED(targetFormat);
-    
     if (imageMagickPath.isEmpty()) {
         emit conversionError(inputPath, "ImageMagick not found. Please install ImageMagick.");
         return;
     }
 
-    QProcess *process = new QProcess(this);
-    
-    ConversionJob job;
-    job.process = process;
-    job.inputPath = inputPath;
-    job.outputPath = outputPath;
-    job.cancelled = false;
-    activeJobs[inputPath] = job;
-    
-    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &Converter::onProcessFinished);
-    connect(process, &QProcess::errorOccurred, this, &Converter::onProcessError);
+    QStringList args = imageMagickArguments(inputPath, detectFormat(inputPath), outputs);
+    startProcess(inputPath, outputs.first().outputPath, imageMagickPath, args);
+}
 
+QStringList Converter::imageMagickArguments(const QString &input, FileFormat sourceFormat,
+                                            const QList<StagedOutput> &outputs)
+{
+    bool allResized = true;
+    bool anyResized = false;
+    int side = 0;
+    for (const StagedOutput &output : outputs) {
+        allResized = allResized && !output.resize.isNull();
+        anyResized = anyResized || !output.resize.isNull();
+        side = qMax(side, qMax(output.resize.box.width(), output.resize.box.height()));
+    }
+    
     QStringList args;
-    args << inputPath
-         << outputPath;
-
-    process->start(imageMagickPath, args);
+    // libjpeg decodes straight to 1/2..1/8 scale while both sides stay at
+    // least this large. Square, because EXIF rotation may swap the sides.
+    if (sourceFormat == FileFormat::JPG && allResized) {
+        args << "-define" << QString("jpeg:size=%1x%1").arg(side);
+    }
+    
+    args << input;
+    if (anyResized) {
+        args << "-auto-orient";
+    }
+    
+    // The image is read once; every output but the last is written from a
+    // clone, so the resizes do not compound
+    for (int i = 0; i < outputs.size(); ++i) {
+        QStringList resizeArgs = resizeArguments(outputs[i].resize);
+        if (i == outputs.size() - 1) {
+            args << resizeArgs << outputs[i].outputPath;
+        } else if (resizeArgs.isEmpty()) {
+            args << "-write" << outputs[i].outputPath;
+        } else {
+            args << "(" << "+clone" << resizeArgs << "-write" << outputs[i].outputPath << "+delete" << ")";
+        }
+    }
+    return args;
 }
 
 void Converter::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
@@ -300,15 +1947,13 @@ void Converter::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
     if (!process) return;
     
     // Find the job for this process
-    QString inputPath;
-    QString outputPath;
-    bool cancelled = false;
+    ConversionJob job;
+    bool found = false;
     
     for (auto it = activeJobs.begin(); it != activeJobs.end(); ++it) {
         if (it.value().process == process) {
-            inputPath = it.value().inputPath;
-            outputPath = it.value().outputPath;
-            cancelled = it.value().cancelled;
+            job = it.value();
+            found = true;
             activeJobs.erase(it);
             break;
         }
@@ -316,104 +1961,260 @@ void Converter::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
     
     process->deleteLater();
     
-    if (inputPath.isEmpty()) return;
+    if (!found) return;
     
-    if (cancelled) {
-        emit conversionFinished(inputPath, ConversionStatus::Cancelled, "");
-        finalizeConversion();
+    traceRun(job);
+    releaseProfileSlot(job.profileSlot);
+    
+    if (job.cancelled) {
+        discardStaging(job);
+        emit conversionFinished(job.inputPath, ConversionStatus::Cancelled, "");
     } else if (exitStatus == QProcess::NormalExit && exitCode == 0) {
-        // Schedule non-blocking file existence check
-        scheduleFileCheck(inputPath, outputPath);
+        publishOutput(job);
     } else {
+        discardStaging(job);
         QString errorOutput = process->readAllStandardError();
         QString stdOutput = process->readAllStandardOutput();
         QString fullError = errorOutput.isEmpty() ? stdOutput : errorOutput;
         if (fullError.isEmpty()) {
             fullError = QString("Process exited with code %1").arg(exitCode);
         }
-        emit conversionError(inputPath, "Conversion failed: " + fullError);
-        finalizeConversion();
+        // An error the tool reported comes back on a rerun; a crash (on
+        // Windows an NTSTATUS exit code such as 0xC0000005) often does not
+        bool crashed = exitStatus == QProcess::CrashExit
+                       || (static_cast<quint32>(exitCode) & 0xC0000000u) == 0xC0000000u;
+        retryOrFallBack(job, "Conversion failed: " + fullError, crashed);
     }
+    finalizeConversion();
 }
 
-void Converter::scheduleFileCheck(const QString &inputPath, const QString &outputPath)
+void Converter::onRemoteFinished(bool ok, bool retryable, const QString &errorMessage)
 {
-    PendingFileCheck check;
-    check.inputPath = inputPath;
-    check.outputPath = outputPath;
-    check.retryCount = 0;
-    check.timer = new QTimer(this);
-    check.timer->setSingleShot(true);
+    RemoteJob *remote = qobject_cast<RemoteJob*>(sender());
+    if (!remote) return;
+    
+    ConversionJob job;
+    bool found = false;
+    
+    for (auto it = activeJobs.begin(); it != activeJobs.end(); ++it) {
+        if (it.value().remote == remote) {
+            job = it.value();
+            found = true;
+            activeJobs.erase(it);
+            break;
+        }
+    }
+    
+    remote->deleteLater();
     
-    pendingFileChecks[inputPath] = check;
+    if (!found) return;
+    traceRun(job);
     
-    connect(check.timer, &QTimer::timeout, this, &Converter::checkFileExists);
-    check.timer->start(50); // First check after 50ms
+    workerPool->release(job.workerIndex, !ok && retryable);
+    
+    if (job.cancelled) {
+        discardStaging(job);
+        emit conversionFinished(job.inputPath, ConversionStatus::Cancelled, "");
+    } else if (ok) {
+        publishOutput(job);
+    } else if (retryable) {
+        // The worker failed, not the conversion: put the job back at the head
+        // of the queue, excluding this worker. Once every worker has been
+        // tried it runs locally.
+        discardStaging(job);
+        job.triedWorkers.insert(remote->workerId());
+        if (trace) {
+            trace->instant("worker failed", "scheduler", TraceRecorder::SchedulerLane,
+                           QFileInfo(job.inputPath).fileName() + ": " + errorMessage);
+        }
+        requeue(job);
+    } else {
+        discardStaging(job);
+        retryOrFallBack(job, "Conversion failed: " + errorMessage, false);
+    }
+    finalizeConversion();
 }
 
-void Converter::checkFileExists()
+void Converter::publishOutput(const ConversionJob &job)
 {
-    QTimer *timer = qobject_cast<QTimer*>(sender());
-    if (!timer) return;
+    qint64 detectUs = trace ? trace->nowUs() : 0;
+    const QList<StagedOutput> outputs = stagedOutputs(job);
     
-    // Find which pending check this timer belongs to
-    QString inputPath;
-    for (auto it = pendingFileChecks.begin(); it != pendingFileChecks.end(); ++it) {
-        if (it.value().timer == timer) {
-            inputPath = it.key();
-            break;
+    // Nothing written at all (e.g. the document did not load) is one failure
+    // of the job, not one per output
+    if (outputs.size() > 1) {
+        bool anyStaged = false;
+        for (const StagedOutput &output : outputs) {
+            anyStaged = anyStaged || !OutputStaging::findStagedFile(output.stagingDirectory, output.outputPath).isEmpty();
+        }
+        if (!anyStaged) {
+            discardStaging(job);
+            emit conversionError(job.inputPath, "No output file was created. Check if LibreOffice/ImageMagick is installed correctly.");
+            return;
         }
     }
     
-    if (inputPath.isEmpty()) {
-        timer->deleteLater();
+    // A tool that was killed or crashed half way can leave a file that only
+    // looks finished; such a job runs again before it counts as failed
+    for (const StagedOutput &output : outputs) {
+        QString stagedPath = OutputStaging::findStagedFile(output.stagingDirectory, output.outputPath);
+        QString damage = stagedPath.isEmpty() ? QString() : OutputVerifier::verify(stagedPath, output.format);
+        if (damage.isEmpty()) {
+            continue;
+        }
+        if (trace) {
+            trace->span("output-detect", "job", job.lane, detectUs, trace->nowUs(), "damaged: " + damage);
+        }
+        discardStaging(job);
+        retryOrFallBack(job, "Output is damaged: " + damage, true);
         return;
     }
     
-    PendingFileCheck &check = pendingFileChecks[inputPath];
-    QString outputPath = check.outputPath;
+    recordCost(job);
+    qint64 publishUs = trace ? trace->nowUs() : 0;
+    for (const StagedOutput &output : outputs) {
+        publishStaged(job.inputPath, output, job.outputDirectory, job.writeBehind);
+    }
+    if (trace) {
+        // Write-behind copies show on the publisher's threads
+        QString name = QFileInfo(job.inputPath).fileName();
+        trace->span("output-detect", "job", job.lane, detectUs, publishUs, name);
+        trace->span("publish", "job", job.lane, publishUs, trace->nowUs(), name);
+    }
+}
+
+void Converter::requeue(const ConversionJob &job, int delayMs)
+{
+    // At the head of the queue, so it runs again as soon as a slot is free
+    QFileInfo fileInfo(job.inputPath);
+    QueuedJob retry;
+    retry.inputPath = job.inputPath;
+    retry.targetFormat = job.targetFormat;
+    retry.resize = job.resize;
+    for (const StagedOutput &extra : job.extraOutputs) {
+        OutputSpec spec;
+        spec.format = extra.format;
+        spec.resize = extra.resize;
+        retry.extraOutputs << spec;
+    }
+    retry.outputDirectory = job.outputDirectory;
+    retry.directory = fileInfo.absolutePath();
+    retry.fileId = 0;
+    retry.size = fileInfo.size();
+    retry.triedWorkers = job.triedWorkers;
+    retry.checked = true;
+    // A retry runs where the failed run did; anything else is routed afresh
+    retry.backend = job.attempts > 0 ? job.backend : Backend::None;
+    retry.failedBackends = job.failedBackends;
+    retry.attempts = job.attempts;
+    retry.queuedUs = trace ? trace->nowUs() : 0;
+    if (delayMs <= 0) {
+        enqueueAtHead(retry);
+        return;
+    }
     
-    // Check if file exists and has content
-    if (QFileInfo::exists(outputPath)) {
-        QFileInfo fi(outputPath);
-        if (fi.size() > 0) {
-            // Success!
-            timer->deleteLater();
-            pendingFileChecks.remove(inputPath);
-            emit conversionFinished(inputPath, ConversionStatus::Success, outputPath);
-            finalizeConversion();
-            return;
+    // Other queued jobs take the slot meanwhile
+    delayedRetries[job.inputPath] = retry;
+    QTimer::singleShot(delayMs, this, [this, inputPath = job.inputPath]() {
+        auto it = delayedRetries.find(inputPath);
+        if (it == delayedRetries.end()) {
+            return;     // Cancelled while it waited
         }
+        enqueueAtHead(it.value());
+        delayedRetries.erase(it);
+        startNextQueuedConversion();
+    });
+}
+
+void Converter::retryOrFallBack(const ConversionJob &job, const QString &errorMessage, bool retryable)
+{
+    // Merged PDFs never went through the queue and cannot be run again
+    if (job.capability < 0) {
+        emit conversionError(job.inputPath, errorMessage);
+        return;
+    }
+    
+    ConversionJob retry = job;
+    if (retryable && job.attempts + 1 < backendAttempts(job.backend)) {
+        if (trace) {
+            trace->instant("retry", "scheduler", TraceRecorder::SchedulerLane,
+                           QFileInfo(job.inputPath).fileName() + ": " + errorMessage);
+        }
+        retry.attempts++;
+        requeue(retry, RetryBackoffMs << job.attempts);
+        return;
+    }
+    
+    // The same tool would fail the same way; another one might not
+    retry.failedBackends << job.backend;
+    retry.attempts = 0;
+    if (capabilitiesFor(detectFormat(job.inputPath), targetFormats(job), retry.failedBackends).isEmpty()) {
+        emit conversionError(job.inputPath, errorMessage);
+        return;
+    }
+    if (trace) {
+        trace->instant("fall back", "scheduler", TraceRecorder::SchedulerLane,
+                       QFileInfo(job.inputPath).fileName() + ": " + backendName(job.backend) + " failed");
+    }
+    requeue(retry);
+}
+
+void Converter::publishStaged(const QString &inputPath, const StagedOutput &output,
+                              const QString &outputDirectory, bool writeBehind)
+{
+    // The tool has exited, so whatever is in the staging directory is complete
+    QString stagedPath = OutputStaging::findStagedFile(output.stagingDirectory, output.outputPath);
+    if (stagedPath.isEmpty()) {
+        OutputStaging::removeStagingDirectory(output.stagingDirectory);
+        emit conversionError(inputPath, "Output file was not created. Check if LibreOffice/ImageMagick is installed correctly.");
+        return;
     }
     
-    check.retryCount++;
+    emit conversionStaged(inputPath);
+    
+    if (writeBehind) {
+        // Slot is released now; the copy to the destination runs in the background
+        stagingParents.insert(outputDirectory);
+        publisher->publish(inputPath, stagedPath, output.stagingDirectory, outputDirectory, incremental);
+        return;
+    }
     
-    if (check.retryCount < 20) { // Max 20 retries = 2 seconds total
-        timer->start(100); // Retry after 100ms
+    QFileInfo stagedInfo(stagedPath);
+    QString errorMessage;
+    QString finalPath;
+    if (incremental) {
+        finalPath = OutputStaging::replace(stagedPath, outputDirectory,
+                                           stagedInfo.completeBaseName(), stagedInfo.suffix(),
+                                           &errorMessage);
     } else {
-        // Final attempt: search for file with matching pattern
-        QFileInfo inputInfo(inputPath);
-        QFileInfo outputInfo(outputPath);
-        QString outDir = outputInfo.absolutePath();
-        QString baseName = inputInfo.baseName();
-        QString ext = outputInfo.suffix();
-        
-        QDir dir(outDir);
-        QStringList filters;
-        filters << baseName + "." + ext;
-        filters << baseName + "*." + ext;
-        QStringList matchingFiles = dir.entryList(filters, QDir::Files, QDir::Time);
-        
-        timer->deleteLater();
-        pendingFileChecks.remove(inputPath);
-        
-        if (!matchingFiles.isEmpty()) {
-            QString foundPath = outDir + "/" + matchingFiles.first();
-            emit conversionFinished(inputPath, ConversionStatus::Success, foundPath);
-        } else {
-            emit conversionError(inputPath, "Output file was not created. Check if LibreOffice/ImageMagick is installed correctly.");
-        }
-        finalizeConversion();
+        finalPath = OutputStaging::publish(stagedPath, outputDirectory,
+                                           stagedInfo.completeBaseName(), stagedInfo.suffix(),
+                                           &errorMessage);
+    }
+    OutputStaging::removeStagingDirectory(output.stagingDirectory);
+    
+    if (finalPath.isEmpty()) {
+        emit conversionError(inputPath, errorMessage);
+    } else {
+        emit conversionFinished(inputPath, ConversionStatus::Success, finalPath);
+    }
+}
+
+QList<Converter::StagedOutput> Converter::stagedOutputs(const ConversionJob &job)
+{
+    StagedOutput primary;
+    primary.format = job.targetFormat;
+    primary.resize = job.resize;
+    primary.outputPath = job.outputPath;
+    primary.stagingDirectory = job.stagingDirectory;
+    return QList<StagedOutput>() << primary << job.extraOutputs;
+}
+
+void Converter::discardStaging(const ConversionJob &job)
+{
+    const QList<StagedOutput> outputs = stagedOutputs(job);
+    for (const StagedOutput &output : outputs) {
+        OutputStaging::removeStagingDirectory(output.stagingDirectory);
     }
 }
 
@@ -422,23 +2223,99 @@ void Converter::finalizeConversion()
     // Start next queued conversion
     startNextQueuedConversion();
     
-    // Check if all done (no active jobs, no queue, no pending file checks)
-    if (activeJobs.isEmpty() && conversionQueue.isEmpty() && pendingFileChecks.isEmpty()) {
+    // Check if all done (no active jobs, no queue, nothing left to publish)
+    if (activeJobs.isEmpty() && streamJobs.isEmpty() && archiveJobs.isEmpty()
+        && conversionQueue.isEmpty() && delayedRetries.isEmpty() && publisher->pendingCount() == 0
+        && postedJobs.load(std::memory_order_acquire) == 0) {
+        // Nothing can be creating a staging directory now
+        for (const QString &parent : stagingParents) {
+            OutputStaging::removeStagingRoot(parent);
+        }
+        stagingParents.clear();
+        if (journal) {
+            journal->reset();
+        }
+        if (incrementalIndex) {
+            incrementalIndex->save();
+        }
+        throughputStats->save();
+        writeTrace();
         emit allConversionsFinished();
     }
 }
 
+void Converter::onJobFinished(const QString &inputPath, ConversionStatus status, const QString &outputPath)
+{
+    auto stamp = incrementalStamps.find(inputPath);
+    if (stamp != incrementalStamps.end() && !activeJobs.contains(inputPath)) {
+        if (status == ConversionStatus::Success && incrementalIndex) {
+            IncrementalIndex::Record record;
+            record.inputSize = stamp.value().inputSize;
+            record.inputModifiedMs = stamp.value().inputModifiedMs;
+            record.outputPath = outputPath;
+            incrementalIndex->update(inputPath, stamp.value().extension, record);
+        }
+    }
+    onJobCompleted(inputPath);
+}
+
+void Converter::onJobCompleted(const QString &inputPath)
+{
+    // Errors for a duplicate submission arrive while the original is still running
+    if (activeJobs.contains(inputPath)) {
+        return;
+    }
+    if (journal) {
+        journal->recordCompleted(inputPath);
+    }
+    incrementalStamps.remove(inputPath);
+}
+
+bool Converter::useWriteBehind(const QString &outputDirectory)
+{
+    switch (writeBehindMode) {
+        case WriteBehindMode::Always:
+            return true;
+        case WriteBehindMode::Off:
+            return false;
+        default:
+            break;
+    }
+    
+    auto it = networkVolumeCache.find(outputDirectory);
+    if (it == networkVolumeCache.end()) {
+        it = networkVolumeCache.insert(outputDirectory, OutputStaging::isNetworkPath(outputDirectory));
+    }
+    return it.value();
+}
+
+void Converter::onOutputPublished(const QString &inputPath, const QString &outputPath)
+{
+    emit conversionFinished(inputPath, ConversionStatus::Success, outputPath);
+    finalizeConversion();
+}
+
+void Converter::onPublishFailed(const QString &inputPath, const QString &errorMessage)
+{
+    emit conversionError(inputPath, errorMessage);
+    finalizeConversion();
+}
+
 void Converter::onProcessError(QProcess::ProcessError error)
 {
     QProcess *process = qobject_cast<QProcess*>(sender());
     if (!process) return;
     
     // Find the job for this process
-    QString inputPath;
+    ConversionJob job;
+    bool found = false;
     
     for (auto it = activeJobs.begin(); it != activeJobs.end(); ++it) {
         if (it.value().process == process) {
-            inputPath = it.value().inputPath;
+            job = it.value();
+            found = true;
+            discardStaging(job);
+            releaseProfileSlot(job.profileSlot);
             activeJobs.erase(it);
             break;
         }
@@ -446,7 +2323,15 @@ void Converter::onProcessError(QProcess::ProcessError error)
     
     process->deleteLater();
     
-    if (inputPath.isEmpty()) return;
+    if (!found) return;
+    traceRun(job);
+    
+    // A killed process reports a crash too
+    if (job.cancelled) {
+        emit conversionFinished(job.inputPath, ConversionStatus::Cancelled, "");
+        finalizeConversion();
+        return;
+    }
     
     QString errorMsg;
     switch (error) {
@@ -460,15 +2345,9 @@ void Converter::onProcessError(QProcess::ProcessError error)
             errorMsg = "Unknown error occurred";
             break;
     }
-    emit conversionError(inputPath, errorMsg);
-    
-    // Start next queued conversion
-    startNextQueuedConversion();
+    retryOrFallBack(job, errorMsg, error == QProcess::Crashed);
     
-    // Check if all done
-    if (activeJobs.isEmpty() && conversionQueue.isEmpty()) {
-        emit allConversionsFinished();
-    }
+    finalizeConversion();
 }
 
 QString Converter::findLibreOffice()
@@ -535,3 +2414,35 @@ QString Converter::findImageMagick()
 
     return QString();
 }
+
+QString Converter::findPdfRenderer()
+{
+    // Poppler for Windows unpacks anywhere; look in the usual places
+    QStringList possiblePaths;
+    const QStringList roots = {"C:/Program Files", "C:/Program Files (x86)", QDir::homePath() + "/AppData/Local/Programs"};
+    for (const QString &root : roots) {
+        const QStringList popplerDirs = QDir(root).entryList(QStringList() << "poppler*", QDir::Dirs);
+        for (const QString &dir : popplerDirs) {
+            possiblePaths << root + "/" + dir + "/Library/bin/pdftoppm.exe"
+                          << root + "/" + dir + "/bin/pdftoppm.exe";
+        }
+    }
+
+    for (const QString &path : possiblePaths) {
+        if (QFileInfo::exists(path)) {
+            return path;
+        }
+    }
+
+    // Try to find in PATH
+    QString pathEnv = qEnvironmentVariable("PATH");
+    QStringList pathDirs = pathEnv.split(';', Qt::SkipEmptyParts);
+    for (const QString &dir : pathDirs) {
+        QString rendererPath = dir + "/pdftoppm.exe";
+        if (QFileInfo::exists(rendererPath)) {
+            return rendererPath;
+        }
+    }
+
+    return QString();
+}
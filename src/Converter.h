@@ -5,6 +5,30 @@
 #include <QString>
 #include <QProcess>
 #include <QMap>
+#include <QFileInfo>
+#include <QSet>
+#include <QSize>
+#include "InputPrefetcher.h"
+#include "IncrementalIndex.h"
+#include "WorkerProtocol.h"
+#include "CostModel.h"
+#include "MpscQueue.h"
+#include <atomic>
+
+class OutputPublisher;
+class JobJournal;
+class WorkerPool;
+class RemoteJob;
+class PipeJob;
+class ArchiveJob;
+class HeifDecoder;
+class PdfRasterJob;
+class PdfAssembler;
+class SpreadsheetConverter;
+class Preflight;
+class ThroughputStats;
+class TraceRecorder;
+class QIODevice;
 
 class Converter : public QObject
 {
@@ -15,88 +39,449 @@ public:
         Success,
         Failed,
         Unsupported,
-        Cancelled
+        Cancelled,
+        UpToDate        // Incremental mode: existing output is newer than the input
     };
 
     enum class FileFormat {
         DOCX,
         PPTX,
         PDF,
+        PDFA,           // Target only: PDF/A-2b, written as .pdf
         JPG,
         PNG,
         WEBP,
         HEIC,
+        XLSX,
+        CSV,
+        ZIP,            // Input only: every entry is converted into a new archive
         Unknown
     };
 
+    enum class WriteBehindMode {
+        Auto,       // Only for outputs on network volumes
+        Always,
+        Off
+    };
+
+    // Downscaling of image outputs
+    struct ResizeOptions {
+        enum class Mode {
+            Fit,        // Inside the box, keeping the aspect ratio; never enlarges
+            Fill        // Covers the box and is cropped to it around the center
+        };
+        QSize box;      // Empty = keep the original size
+        Mode mode = Mode::Fit;
+
+        bool isNull() const { return box.isEmpty(); }
+        // Size of an image of the given size after scaling, before any crop
+        QSize scaledSize(const QSize &source) const;
+        // "1600" (square box) or "1600x900", with a trailing "^" for Fill
+        QString toString() const;
+        static ResizeOptions fromString(const QString &text, bool *ok = nullptr);
+    };
+    
+    // One output of a job that produces several from a single decode
+    struct OutputSpec {
+        FileFormat format;
+        ResizeOptions resize;
+        
+        // "webp", or "webp@1600x900^" when resized
+        QString toString() const;
+        static OutputSpec fromString(const QString &text, bool *ok = nullptr);
+    };
+
+    struct Submission {
+        QString inputPath;
+        QList<OutputSpec> outputs;
+    };
+
     explicit Converter(QObject *parent = nullptr);
     ~Converter();
 
-    void convertFile(const QString &inputPath, FileFormat targetFormat);
+    // Image targets are scaled down to resize.box when it is set; large JPEG
+    // and HEIC inputs are then decoded at reduced size
+    void convertFile(const QString &inputPath, FileFormat targetFormat,
+                     const ResizeOptions &resize = ResizeOptions());
+    // Several outputs for one input: an image in several formats or sizes, or
+    // a document as PDF, PDF/A and a PNG of its first page. The source is
+    // decoded (or loaded by LibreOffice) once and every output is written
+    // from it. Each output gets its own conversionFinished; a failure of the
+    // whole job is reported once. Resized outputs get a size suffix
+    // ("photo-800.webp"), PDF/A next to PDF gets "-pdfa".
+    void convertFile(const QString &inputPath, const QList<OutputSpec> &outputs);
+    // The same into outputDir instead of the configured output directory,
+    // for callers that give every job a directory of its own
+    void convertFile(const QString &inputPath, const QList<OutputSpec> &outputs, const QString &outputDir);
+    // convertFile() for any thread: the job goes onto a lock-free queue and
+    // the caller returns at once. The converter's thread takes everything
+    // posted since it last looked in one go, in order, and reports as
+    // convertFile() does. A batch is appended as one step.
+    void post(const QString &inputPath, const QList<OutputSpec> &outputs);
+    void postBatch(const QList<Submission> &batch);
+    // Writes JPG/PNG/WEBP images as the pages of one PDF, in the given order.
+    // JPEGs are embedded without being decoded. Signals use outputPath as
+    // the file path; it is published like any other output, so an existing
+    // file of that name is kept and the PDF gets a numbered name.
+    void assemblePdf(const QStringList &inputPaths, const QString &outputPath);
     void cancelConversion(const QString &inputPath);
     void cancelAll();
     bool isConverting() const;
     int activeConversions() const;
+    // Whether a caller feeding a large batch bit by bit should submit more
+    // now; false once enough is queued to keep every slot busy, prefetch
+    // ahead and order by locality
+    bool wantsMoreJobs() const;
+    
+    // Streams an image from input to output through ImageMagick's stdin and
+    // stdout, without temporary files. streamId stands in for the file path
+    // in signals; both devices must stay valid until the job finishes. The
+    // source format is sniffed from the first bytes when not given.
+    void convertStream(const QString &streamId, QIODevice *input, QIODevice *output,
+                       FileFormat targetFormat, FileFormat sourceFormat = FileFormat::Unknown,
+                       const ResizeOptions &resize = ResizeOptions());
     
     static FileFormat detectFormat(const QString &filePath);
+    static FileFormat sniffFormat(QIODevice *device);
     static QString formatToString(FileFormat format);
     static QString formatToExtension(FileFormat format);
+    // Whether any backend converts between the two formats
+    static bool canConvert(FileFormat sourceFormat, FileFormat targetFormat);
 
     void setLibreOfficePath(const QString &path);
     void setImageMagickPath(const QString &path);
     void setMaxParallelConversions(int max);
     void setOutputDirectory(const QString &path);
+    void setPrefetchDepth(int depth);
+    void setPrefetchMemoryBudget(qint64 bytes);
+    void setLocalityOrdering(bool enabled);
+    void setWriteBehindMode(WriteBehindMode mode);
+    void setPublishThreads(int count);
+    
+    // PDF -> JPG/PNG/WEBP writes one image per page, named "<name>-<page>".
+    // pageRanges: "1-3,7,10-" (empty = every page)
+    void setRasterDpi(int dpi);
+    void setRasterPages(const QString &pageRanges);
+    
+    // Crash-safe job journal; resumeFromJournal() re-queues unfinished jobs
+    // from a previous run and returns their input paths
+    void setJournalPath(const QString &path);
+    QStringList resumeFromJournal();
+    void discardJournal();
+    
+    // Make-style mode: skip jobs whose output is newer than the input and
+    // overwrite stale outputs in place. The optional index remembers input
+    // size/mtime per output so re-runs do not stat the output volume.
+    void setIncremental(bool enabled);
+    void setIncrementalIndexPath(const QString &path);
+    
+    // Run times per backend and format pair are kept in this file across
+    // runs; they drive routing, job estimates and the ETA
+    void setThroughputStatsPath(const QString &path);
+    // Expected run time of one job on a local slot, or -1 when nothing
+    // converts it
+    qint64 estimateMs(const QString &inputPath, const QList<OutputSpec> &outputs) const;
+    // Expected time until every queued and running job is done: queued jobs
+    // are laid out in order on the local slots as running ones free up
+    qint64 remainingMs() const;
+    // The same for a batch not yet submitted, on idle slots; for a dry run
+    qint64 planMs(const QList<qint64> &estimatesMs) const;
+    
+    // Records each job's time queued, starting, running, checking and
+    // publishing its output per slot, plus routing decisions, and writes
+    // them to path as Chrome Trace Event JSON whenever the converter runs
+    // dry and on exit. Recording starts with the first path set.
+    void setTracePath(const QString &path);
+    
+    // Remote "--worker" processes; a job goes to a free worker slot when that
+    // is expected to finish before a local one. Failed workers are retried
+    // elsewhere.
+    void setWorkerEndpoints(const QList<WorkerEndpoint> &endpoints);
+    
+    // Upper bound on converted archive entries held in memory before they
+    // are appended to the output archive
+    void setArchiveMemoryBudget(qint64 bytes);
 
 signals:
     void conversionStarted(const QString &filePath);
     void conversionProgress(const QString &filePath, int percent);
+    void conversionStaged(const QString &filePath);
     void conversionFinished(const QString &filePath, ConversionStatus status, const QString &outputPath);
     void conversionError(const QString &filePath, const QString &errorMessage);
+    // The backend a job (or a retry of it) was handed to; attempt counts
+    // from 1 per backend
+    void conversionRouted(const QString &filePath, const QString &backend, int attempt);
     void allConversionsFinished();
 
 private slots:
     void onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
     void onProcessError(QProcess::ProcessError error);
-    void checkFileExists();
+    void onOutputPublished(const QString &inputPath, const QString &outputPath);
+    void onPublishFailed(const QString &inputPath, const QString &errorMessage);
+    void onRemoteFinished(bool ok, bool retryable, const QString &errorMessage);
+    void onStreamFinished(bool ok, const QString &errorMessage);
+    void onArchiveFinished(ConversionStatus status, const QString &outputPath, const QString &errorMessage);
+    void onHeifConverted(const QString &inputPath, const QStringList &errorMessages);
+    void onRasterPages(const QStringList &pagePaths);
+    void onRasterFinished(bool ok, const QString &errorMessage);
+    void onInProcessFinished(const QString &jobId, const QString &errorMessage);
+    void onPreflightChecked(const QString &inputPath, const QString &reason);
+    void onJobFinished(const QString &inputPath, ConversionStatus status, const QString &outputPath);
+    void onJobCompleted(const QString &inputPath);
 
 private:
+    // Feeds archive entries into the queue and reuses the backend table
+    friend class ArchiveJob;
+    
+    enum class Backend {
+        LibreOfficeExport,      // DOCX/PPTX -> PDF
+        LibreOfficeImport,      // PDF -> DOCX/PPTX
+        ImageMagick,
+        PdfRaster,              // PDF -> one image per page
+        PdfAssembly,            // JPG/PNG/WEBP -> PDF, JPEG data embedded as is
+        Spreadsheet,            // XLSX <-> CSV, streamed in process
+        Libheif,                // HEIC -> JPG/PNG/WEBP in process
+        Remote,                 // A --worker process, which picks its own backend
+        None
+    };
+    
+    // One row of the capability table: a backend and the conversions it does
+    struct Capability {
+        Backend backend;
+        QList<FileFormat> sources;
+        QList<FileFormat> targets;
+        bool remote;                // May be sent to a worker instead
+        double startupMs;           // Cost model seed
+        double msPerMB;
+    };
+
+    // An output written into its own staging directory
+    struct StagedOutput {
+        FileFormat format;
+        ResizeOptions resize;
+        QString outputPath;
+        QString stagingDirectory;
+    };
+
+    // Defaults describe a local job that is not running anything yet; each
+    // start sets what differs
     struct ConversionJob {
-        QProcess *process;
+        QProcess *process = nullptr;
+        RemoteJob *remote = nullptr;        // Set instead of process for remote jobs
+        PdfRasterJob *raster = nullptr;     // Set instead of process for PDF page rendering
+        int workerIndex = -1;
+        int profileSlot = -1;               // LibreOffice user profile in use, or -1
+        int threads = 1;                    // Local CPU threads held; 0 for remote jobs
+        bool inProcess = false;             // On the HEIC decoder's, PDF assembler's or spreadsheet pool
+        QSet<QString> triedWorkers;
+        FileFormat targetFormat = FileFormat::Unknown;
+        ResizeOptions resize;
         QString inputPath;
-        QString outputPath;
-        bool cancelled;
+        QString outputPath;                 // Expected path inside stagingDirectory
+        QString outputDirectory;            // Final destination
+        QString stagingDirectory;
+        QList<StagedOutput> extraOutputs;   // Fan-out jobs: outputs beyond the first
+        Backend backend = Backend::None;
+        int capability = -1;                // Row in capabilities(); -1 when not a queued job
+        QList<Backend> failedBackends;
+        int attempts = 0;                   // Earlier runs on this backend that failed
+        qint64 inputSize = 0;
+        qint64 startedMs = 0;
+        bool writeBehind = false;           // Staged in local scratch, copied by the publisher
+        bool cancelled = false;
+        int lane = -1;                      // Slot lane in the trace, or -1
+        qint64 dequeuedUs = 0;              // Trace times: taken off the queue, tool running
+        qint64 runningUs = 0;
+    };
+    
+    struct IncrementalStamp {
+        QString extension;
+        qint64 inputSize;
+        qint64 inputModifiedMs;
     };
     
-    struct PendingFileCheck {
+    struct QueuedJob {
         QString inputPath;
-        QString outputPath;
-        int retryCount;
-        QTimer *timer;
+        FileFormat targetFormat;
+        ResizeOptions resize;
+        QList<OutputSpec> extraOutputs;
+        QString outputDirectory;    // Empty = next to the input
+        QString directory;
+        quint64 fileId;
+        qint64 size;
+        QSet<QString> triedWorkers; // Workers that already failed this job
+        bool checked;               // Passed the pre-flight check; only then may it start
+        Backend backend;            // Pinned for a retry; None lets the router choose
+        QList<Backend> failedBackends;
+        int attempts;
+        qint64 queuedUs;            // Trace time it was queued
+    };
+    
+    // Queue order: retries put back at the head first, newest first; then
+    // by directory and inode when locality ordering is on; then arrival
+    struct QueueKey {
+        int band;                   // 0 = put back at the head
+        QString directory;
+        quint64 fileId;
+        qint64 sequence;
+        bool operator<(const QueueKey &other) const
+        {
+            if (band != other.band) {
+                return band < other.band;
+            }
+            if (directory != other.directory) {
+                return directory < other.directory;
+            }
+            if (fileId != other.fileId) {
+                return fileId < other.fileId;
+            }
+            return sequence < other.sequence;
+        }
     };
 
-    void convertDocumentToPDF(const QString &inputPath, const QString &outputPath);
+    void convertDocument(const QString &inputPath, const QList<StagedOutput> &outputs);
     void convertPDFtoDocument(const QString &inputPath, const QString &outputPath, FileFormat targetFormat);
-    void convertImage(const QString &inputPath, const QString &outputPath, FileFormat targetFormat);
+    void convertImage(const QString &inputPath, const QList<StagedOutput> &outputs);
+    void convertHeifInProcess(const QString &inputPath, const QList<StagedOutput> &outputs);
+    void convertPdfToImages(const QString &inputPath, const StagedOutput &output);
+    void convertImagesToPdf(const QString &jobId, const QStringList &imagePaths, const StagedOutput &output);
+    void convertSpreadsheet(const QString &inputPath, const StagedOutput &output);
+    static QStringList imageMagickArguments(const QString &input, FileFormat sourceFormat,
+                                            const QList<StagedOutput> &outputs);
+    // outputs: the first is the job's target, any others are fanned out
+    void submit(const QString &inputPath, const QList<OutputSpec> &outputs, const QString &outputDir,
+                bool journaled = true);
+    void startArchive(const QString &inputPath, FileFormat targetFormat, const QString &outputDir,
+                      const ResizeOptions &resize);
+    void enqueue(const QueuedJob &job);
+    // Ahead of everything queued, e.g. a retry
+    void enqueueAtHead(const QueuedJob &job);
     void startNextQueuedConversion();
-    void scheduleFileCheck(const QString &inputPath, const QString &outputPath);
+    void prefetchQueueHead();
+    static const QList<Capability> &capabilities();
+    // Rows that write every target from the source
+    static QList<int> capabilitiesFor(FileFormat sourceFormat, const QList<FileFormat> &targetFormats,
+                                      const QList<Backend> &excluded = QList<Backend>());
+    static Backend backendFor(FileFormat sourceFormat, FileFormat targetFormat);
+    static QList<FileFormat> targetFormats(const QueuedJob &job);
+    static QList<FileFormat> targetFormats(const ConversionJob &job);
+    static QString costKey(int capability, FileFormat sourceFormat, const QList<FileFormat> &targetFormats,
+                           bool remote);
+    static CostModel costSeed(int capability, bool remote);
+    CostModel costModel(int capability, FileFormat sourceFormat, const QList<FileFormat> &targetFormats,
+                        bool remote) const;
+    // The row expected to run the job fastest on a local slot, or -1; pinned
+    // (unless None) limits it to that backend
+    int cheapestCapability(FileFormat sourceFormat, const QList<FileFormat> &targetFormats, qint64 size,
+                           const QList<Backend> &excluded, Backend pinned, double *estimateMs) const;
+    // Expected milliseconds until a local slot is free
+    double localWaitMs() const;
+    double expectedLeftMs(const ConversionJob &job, qint64 now) const;
+    // When the last job ends if each starts on the slot that frees first
+    static qint64 scheduleMs(QList<double> slotFreeMs, const QList<double> &durationsMs);
+    void recordCost(const ConversionJob &job);
+    static int backendAttempts(Backend backend);
+    static QString backendName(Backend backend);
+    int localConversions() const;
+    int threadsInUse() const;
+    int threadGrant() const;
+    void startProcess(const QString &inputPath, const QString &outputPath,
+                      const QString &program, const QStringList &args, int profileSlot = -1,
+                      const QProcessEnvironment &environment = QProcessEnvironment());
+    int acquireProfileSlot();
+    void releaseProfileSlot(int slot);
+    // Trace lanes are handed out like profile slots, so a slot's lane shows
+    // one job at a time
+    int acquireTraceLane();
+    void releaseTraceLane(int lane);
+    // Start-up and run spans of a job whose tool has just finished
+    void traceRun(const ConversionJob &job);
+    void writeTrace();
+    static QString profileDirectory(int slot);
+    static QString profileArgument(int slot);
+    void startRemote(const QueuedJob &job, int workerIndex, const QString &outputPath);
+    void publishOutput(const ConversionJob &job);
+    void requeue(const ConversionJob &job, int delayMs = 0);
+    // retryable: the failure may not happen again (a crash, a cut-off output)
+    void retryOrFallBack(const ConversionJob &job, const QString &errorMessage, bool retryable);
+    void publishStaged(const QString &inputPath, const StagedOutput &output,
+                       const QString &outputDirectory, bool writeBehind);
+    static QList<StagedOutput> stagedOutputs(const ConversionJob &job);
+    static void discardStaging(const ConversionJob &job);
     void finalizeConversion();
+    bool useWriteBehind(const QString &outputDirectory);
+    bool isUpToDate(const QFileInfo &inputInfo, FileFormat targetFormat,
+                    const QString &outputDir, QString *outputPath);
+    void scheduleFinalize();
+    void drainSubmissions();
     QString findLibreOffice();
     QString findImageMagick();
+    QString findPdfRenderer();
 
     QString libreOfficePath;
     QString imageMagickPath;
+    QString pdfRendererPath;
+    int rasterDpi;
+    QString rasterPages;
     QString outputDirectory;
     
     // Active conversions: key = inputPath
     QMap<QString, ConversionJob> activeJobs;
     
-    // Pending file existence checks
-    QMap<QString, PendingFileCheck> pendingFileChecks;
+    // Streamed conversions: key = stream id. They start immediately but
+    // occupy local slots for file jobs.
+    QMap<QString, PipeJob *> streamJobs;
+    
+    // ZIP inputs being converted entry by entry: key = archive path
+    QMap<QString, ArchiveJob *> archiveJobs;
+    qint64 archiveMemoryBudget;
+    
+    // Queue for pending conversions; ordered, so a job goes in at its place
+    // in O(log n) also when a large batch or journal is queued at once
+    QMap<QueueKey, QueuedJob> conversionQueue;
+    qint64 queueSequence;
+    
+    // Posted from any thread, not yet taken by drainSubmissions()
+    MpscQueue<Submission> submissions;
+    std::atomic<int> postedJobs;
+    
+    // Retries waiting out their backoff, off the queue so the slot is not
+    // held: key = inputPath
+    QMap<QString, QueuedJob> delayedRetries;
+    
+    // Directories with a staging root in them, removed once the batch is done
+    QSet<QString> stagingParents;
+    
+    // Concurrent soffice instances need separate user profiles
+    QList<bool> profileSlotsInUse;
+    
+    // Readahead for the next few queued inputs
+    InputPrefetcher prefetcher;
+    
+    // Write-behind copies to slow output volumes
+    OutputPublisher *publisher;
+    WriteBehindMode writeBehindMode;
+    QMap<QString, bool> networkVolumeCache;
+    
+    JobJournal *journal;
+    HeifDecoder *heifDecoder;
+    PdfAssembler *pdfAssembler;
+    SpreadsheetConverter *spreadsheetConverter;
+    Preflight *preflight;
+    WorkerPool *workerPool;
+    ThroughputStats *throughputStats;
+    TraceRecorder *trace;       // Null unless a trace path is set
+    QString tracePath;
+    QList<bool> traceLanesInUse;
     
-    // Queue for pending conversions
-    QList<QPair<QString, FileFormat>> conversionQueue;
+    // Incremental mode
+    bool incremental;
+    IncrementalIndex *incrementalIndex;
+    QMap<QString, IncrementalStamp> incrementalStamps;
+    bool finalizeScheduled;
     
     int maxParallelConversions;
+    bool localityOrdering;
 };
 
 #endif // CONVERTER_H
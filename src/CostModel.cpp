@@ -0,0 +1,113 @@
+#include "CostModel.h"
+#include <QStringList>
+
+namespace {
+// Weight left to earlier runs each time one finishes
+constexpr double Decay = 0.9;
+// The seed line is entered as two runs, at no input and at this size
+constexpr double SeedMB = 8.0;
+constexpr double BytesPerMB = 1024.0 * 1024.0;
+}
+
+CostModel::CostModel(double startupMs, double msPerMB)
+    : weight(0), sumX(0), sumY(0), sumXX(0), sumXY(0), startup(startupMs), perMB(msPerMB), count(0)
+{
+    add(0, startupMs, 1);
+    add(SeedMB, startupMs + msPerMB * SeedMB, 1);
+}
+
+double CostModel::estimateMs(qint64 inputBytes) const
+{
+    return startup + perMB * (inputBytes / BytesPerMB);
+}
+
+void CostModel::record(qint64 inputBytes, qint64 elapsedMs)
+{
+    weight *= Decay;
+    sumX *= Decay;
+    sumY *= Decay;
+    sumXX *= Decay;
+    sumXY *= Decay;
+    add(inputBytes / BytesPerMB, qMax<qint64>(0, elapsedMs), 1);
+    count++;
+    fit();
+}
+
+double CostModel::startupMs() const
+{
+    return startup;
+}
+
+double CostModel::msPerMB() const
+{
+    return perMB;
+}
+
+int CostModel::samples() const
+{
+    return count;
+}
+
+QString CostModel::toString() const
+{
+    QStringList fields;
+    for (double value : {weight, sumX, sumY, sumXX, sumXY}) {
+        fields << QString::number(value, 'g', 10);
+    }
+    fields << QString::number(count);
+    return fields.join(' ');
+}
+
+CostModel CostModel::fromString(const QString &text, bool *ok)
+{
+    CostModel model;
+    QStringList fields = text.split(' ', Qt::SkipEmptyParts);
+    bool valid = fields.size() == 6;
+    double values[5] = {};
+    for (int i = 0; valid && i < 5; ++i) {
+        values[i] = fields[i].toDouble(&valid);
+    }
+    if (valid) {
+        model.count = fields[5].toInt(&valid);
+    }
+    valid = valid && values[0] > 0;
+    if (valid) {
+        model.weight = values[0];
+        model.sumX = values[1];
+        model.sumY = values[2];
+        model.sumXX = values[3];
+        model.sumXY = values[4];
+        model.fit();
+    }
+    if (ok) {
+        *ok = valid;
+    }
+    return model;
+}
+
+void CostModel::add(double megabytes, double ms, double sampleWeight)
+{
+    weight += sampleWeight;
+    sumX += sampleWeight * megabytes;
+    sumY += sampleWeight * ms;
+    sumXX += sampleWeight * megabytes * megabytes;
+    sumXY += sampleWeight * megabytes * ms;
+}
+
+void CostModel::fit()
+{
+    double meanX = sumX / weight;
+    double meanY = sumY / weight;
+    double varianceX = sumXX / weight - meanX * meanX;
+    // Runs of (nearly) one size say nothing new about the slope; they only
+    // move the line
+    if (varianceX > 1e-6) {
+        perMB = qMax(0.0, (sumXY / weight - meanX * meanY) / varianceX);
+    }
+    startup = meanY - perMB * meanX;
+    if (startup < 0) {
+        // No negative start-up: put the line through the origin instead
+        startup = 0;
+        perMB = sumXX > 0 ? qMax(0.0, sumXY / sumXX) : perMB;
+    }
+}
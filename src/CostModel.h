@@ -0,0 +1,41 @@
+#ifndef COSTMODEL_H
+#define COSTMODEL_H
+
+#include <QString>
+
+// Expected run time of a backend as a start-up cost plus a cost per MB of
+// input, fitted to the jobs it finished. Older runs weigh less with every new
+// one, so the fit follows a machine that gets busier or a share that gets
+// slower. Until enough runs are in, the seed values dominate.
+class CostModel
+{
+public:
+    CostModel(double startupMs = 0, double msPerMB = 0);
+
+    double estimateMs(qint64 inputBytes) const;
+    void record(qint64 inputBytes, qint64 elapsedMs);
+
+    double startupMs() const;
+    double msPerMB() const;
+    int samples() const;
+    
+    // The fitted sums, so a model can be kept across runs
+    QString toString() const;
+    static CostModel fromString(const QString &text, bool *ok = nullptr);
+
+private:
+    void add(double megabytes, double ms, double weight);
+    void fit();
+
+    // Decayed sums for a least-squares line: ms = startup + perMB * MB
+    double weight;
+    double sumX;
+    double sumY;
+    double sumXX;
+    double sumXY;
+    double startup;
+    double perMB;
+    int count;
+};
+
+#endif // COSTMODEL_H
@@ -0,0 +1,136 @@
+#include "DocumentExport.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+
+namespace {
+constexpr char MacroFileName[] = "fileconverter_export.py";
+
+// Run inside soffice. FILECONVERTER_EXPORTS has one "filter<TAB>data<TAB>path"
+// line per output; an export that fails leaves its output missing and the
+// others are still written.
+constexpr char MacroSource[] = R"PY(import os
+import sys
+import uno
+from com.sun.star.beans import PropertyValue
+
+INTEGER_OPTIONS = ("SelectPdfVersion",)
+
+
+def _property(name, value):
+    result = PropertyValue()
+    result.Name = name
+    result.Value = value
+    return result
+
+
+def export(*args):
+    desktop = XSCRIPTCONTEXT.getDesktop()
+    document = None
+    try:
+        source = uno.systemPathToFileUrl(os.environ["FILECONVERTER_SOURCE"])
+        document = desktop.loadComponentFromURL(source, "_blank", 0, (_property("Hidden", True),))
+        for line in os.environ["FILECONVERTER_EXPORTS"].splitlines():
+            filter_name, options, path = line.split("\t")
+            data = []
+            for option in options.split(","):
+                if option:
+                    key, value = option.split("=", 1)
+                    data.append(_property(key, int(value) if key in INTEGER_OPTIONS else value))
+            store = [_property("FilterName", filter_name), _property("Overwrite", True)]
+            if data:
+                store.append(_property("FilterData", uno.Any("[]com.sun.star.beans.PropertyValue", tuple(data))))
+            try:
+                uno.invoke(document, "storeToURL", (uno.systemPathToFileUrl(path), tuple(store)))
+            except Exception as error:
+                sys.stderr.write("%s: %s\n" % (path, error))
+    finally:
+        if document is not None:
+            document.close(True)
+        desktop.terminate()
+
+
+g_exportedScripts = (export,)
+)PY";
+
+bool isPresentation(Converter::FileFormat sourceFormat)
+{
+    return sourceFormat == Converter::FileFormat::PPTX;
+}
+}
+
+QString DocumentExport::convertToArgument(Converter::FileFormat sourceFormat, Converter::FileFormat targetFormat)
+{
+    if (targetFormat != Converter::FileFormat::PDFA) {
+        // LibreOffice picks the Writer or Impress filter from the extension
+        return Converter::formatToExtension(targetFormat);
+    }
+    // Filter options as JSON need LibreOffice 7.4 or later
+    return QString("pdf:%1:{\"SelectPdfVersion\":{\"type\":\"long\",\"value\":\"2\"}}")
+        .arg(filterName(sourceFormat, targetFormat));
+}
+
+bool DocumentExport::installMacro(const QString &profileDirectory, QString *errorMessage)
+{
+    QString scriptDirectory = profileDirectory + "/user/Scripts/python";
+    if (!QDir().mkpath(scriptDirectory)) {
+        *errorMessage = "Could not create " + scriptDirectory;
+        return false;
+    }
+
+    QByteArray source(MacroSource);
+    QFile script(scriptDirectory + "/" + MacroFileName);
+    // The whole script is compared, it is small: an older version of the
+    // same length must still be replaced
+    if (script.open(QIODevice::ReadOnly)) {
+        bool current = script.readAll() == source;
+        script.close();
+        if (current) {
+            return true;
+        }
+    }
+    if (!script.open(QIODevice::WriteOnly | QIODevice::Truncate) || script.write(source) != source.size()) {
+        *errorMessage = "Could not write " + script.fileName() + ": " + script.errorString();
+        return false;
+    }
+    return true;
+}
+
+QString DocumentExport::macroUrl()
+{
+    return QString("vnd.sun.star.script:%1$export?language=Python&location=user").arg(MacroFileName);
+}
+
+QProcessEnvironment DocumentExport::environment(const QString &inputPath, Converter::FileFormat sourceFormat,
+                                                const QList<Target> &targets)
+{
+    QStringList exports;
+    for (const Target &target : targets) {
+        exports << filterName(sourceFormat, target.format) + "\t" + filterData(target.format) + "\t"
+                       + QDir::toNativeSeparators(QFileInfo(target.outputPath).absoluteFilePath());
+    }
+
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    environment.insert("FILECONVERTER_SOURCE", QDir::toNativeSeparators(QFileInfo(inputPath).absoluteFilePath()));
+    environment.insert("FILECONVERTER_EXPORTS", exports.join('\n'));
+    return environment;
+}
+
+QString DocumentExport::filterName(Converter::FileFormat sourceFormat, Converter::FileFormat targetFormat)
+{
+    QString application = isPresentation(sourceFormat) ? "impress" : "writer";
+    if (targetFormat == Converter::FileFormat::PNG) {
+        return application + "_png_Export";
+    }
+    return application + "_pdf_Export";
+}
+
+QString DocumentExport::filterData(Converter::FileFormat targetFormat)
+{
+    switch (targetFormat) {
+        case Converter::FileFormat::PDFA: return "SelectPdfVersion=2";     // PDF/A-2b
+        case Converter::FileFormat::PNG: return "PageRange=1";
+        default: return QString();
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef DOCUMENTEXPORT_H
+#define DOCUMENTEXPORT_H
+
+#include <QList>
+#include <QProcessEnvironment>
+#include <QString>
+#include "Converter.h"
+
+// Several exports of one DOCX/PPTX from a single LibreOffice load. soffice
+// runs a small Python macro that opens the document once and stores it once
+// per export filter, so the layout is computed once and the job is still a
+// single process that can be killed on cancel.
+class DocumentExport
+{
+public:
+    struct Target {
+        Converter::FileFormat format;
+        QString outputPath;
+    };
+
+    // --convert-to argument for a single export, e.g. "pdf" or PDF/A options
+    static QString convertToArgument(Converter::FileFormat sourceFormat, Converter::FileFormat targetFormat);
+
+    // Writes the macro into a LibreOffice profile (created on first use)
+    static bool installMacro(const QString &profileDirectory, QString *errorMessage);
+    // soffice argument that runs the macro
+    static QString macroUrl();
+    // Describes the job to the macro, which reads it from its environment
+    static QProcessEnvironment environment(const QString &inputPath, Converter::FileFormat sourceFormat,
+                                           const QList<Target> &targets);
+
+private:
+    // LibreOffice filter name and "Key=value,..." FilterData for one export
+    static QString filterName(Converter::FileFormat sourceFormat, Converter::FileFormat targetFormat);
+    static QString filterData(Converter::FileFormat targetFormat);
+};
+
+#endif // DOCUMENTEXPORT_H
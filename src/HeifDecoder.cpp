@@ -0,0 +1,282 @@
+#include "HeifDecoder.h"
+#include "PixelKernels.h"
+#include <QFile>
+#include <QImage>
+#include <QImageWriter>
+#include <QList>
+#include <QThread>
+
+#ifdef FILECONVERTER_HAVE_LIBHEIF
+#include <libheif/heif.h>
+#endif
+
+namespace {
+// Matches ImageMagick's default, which the external path uses
+constexpr int JpegQuality = 92;
+
+QByteArray writerFormat(Converter::FileFormat format)
+{
+    switch (format) {
+        case Converter::FileFormat::JPG: return "jpeg";
+        case Converter::FileFormat::PNG: return "png";
+        case Converter::FileFormat::WEBP: return "webp";
+        default: return QByteArray();
+    }
+}
+
+#ifdef FILECONVERTER_HAVE_LIBHEIF
+// Phones embed a small preview next to the full image; use the smallest one
+// that still covers every requested output size. Returns null if none does.
+heif_image_handle *smallestThumbnailFor(heif_image_handle *handle, const QList<HeifDecoder::Target> &targets)
+{
+    QSize full(heif_image_handle_get_width(handle), heif_image_handle_get_height(handle));
+    QSize needed(0, 0);
+    for (const HeifDecoder::Target &target : targets) {
+        if (target.resize.isNull()) {
+            return nullptr;
+        }
+        needed = needed.expandedTo(target.resize.scaledSize(full));
+    }
+    int count = heif_image_handle_get_number_of_thumbnails(handle);
+    if (count <= 0) {
+        return nullptr;
+    }
+    QList<heif_item_id> ids(count);
+    count = heif_image_handle_get_list_of_thumbnail_IDs(handle, ids.data(), count);
+
+    heif_image_handle *best = nullptr;
+    for (int i = 0; i < count; ++i) {
+        heif_image_handle *thumbnail = nullptr;
+        if (heif_image_handle_get_thumbnail(handle, ids[i], &thumbnail).code != heif_error_Ok) {
+            continue;
+        }
+        int width = heif_image_handle_get_width(thumbnail);
+        int height = heif_image_handle_get_height(thumbnail);
+        bool covers = width >= needed.width() && height >= needed.height();
+        if (covers && (!best || qint64(width) * height < qint64(heif_image_handle_get_width(best))
+                                                          * heif_image_handle_get_height(best))) {
+            if (best) {
+                heif_image_handle_release(best);
+            }
+            best = thumbnail;
+        } else {
+            heif_image_handle_release(thumbnail);
+        }
+    }
+    return best;
+}
+
+bool allRows(const uchar *pixels, int stride, int width, int height,
+             bool (*test)(const uchar *, qsizetype))
+{
+    for (int y = 0; y < height; ++y) {
+        if (!test(pixels + qsizetype(y) * stride, width)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Scales and crops the decoded image for one target and writes it
+QString encode(const QImage &pixelsView, bool grayscale, const HeifDecoder::Target &target)
+{
+    QImage image = pixelsView;
+    QSize scaled = target.resize.scaledSize(image.size());
+    if (scaled != image.size()) {
+        image = image.scaled(scaled, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+    if (!target.resize.isNull() && target.resize.mode == Converter::ResizeOptions::Mode::Fill) {
+        QSize box = target.resize.box.boundedTo(image.size());
+        image = image.copy((image.width() - box.width()) / 2, (image.height() - box.height()) / 2,
+                           box.width(), box.height());
+    }
+    // Gray images are written with one channel (WebP is always YUV)
+    if (grayscale && target.format != Converter::FileFormat::WEBP) {
+        image = image.convertToFormat(QImage::Format_Grayscale8);
+    }
+
+    QImageWriter writer(target.outputPath, writerFormat(target.format));
+    if (target.format == Converter::FileFormat::JPG) {
+        writer.setQuality(JpegQuality);
+    }
+    if (!writer.write(image)) {
+        return "Could not write output: " + writer.errorString();
+    }
+    return QString();
+}
+#endif
+}
+
+HeifDecoder::HeifDecoder(QObject *parent)
+    : QObject(parent)
+{
+    // Jobs are limited by the converter's slots; threads by the grants it hands out
+    pool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+HeifDecoder::~HeifDecoder()
+{
+    pool.waitForDone();
+}
+
+bool HeifDecoder::canConvertTo(Converter::FileFormat targetFormat)
+{
+#ifdef FILECONVERTER_HAVE_LIBHEIF
+    static const QList<QByteArray> supported = QImageWriter::supportedImageFormats();
+    QByteArray format = writerFormat(targetFormat);
+    return !format.isEmpty() && supported.contains(format);
+#else
+    Q_UNUSED(targetFormat);
+    return false;
+#endif
+}
+
+void HeifDecoder::convert(const QString &inputPath, const QList<Target> &targets, int threads)
+{
+    pool.start([this, inputPath, targets, threads]() {
+        QStringList errorMessages = decodeAndEncode(inputPath, targets, threads);
+
+        // Report back on the thread that owns the decoder
+        QMetaObject::invokeMethod(this, [this, inputPath, errorMessages]() {
+            emit converted(inputPath, errorMessages);
+        }, Qt::QueuedConnection);
+    });
+}
+
+QStringList HeifDecoder::decodeAndEncode(const QString &inputPath, const QList<Target> &targets, int threads)
+{
+#ifdef FILECONVERTER_HAVE_LIBHEIF
+    QStringList errorMessages(targets.size());
+
+    // Mapped rather than opened by name, so Unicode paths work on Windows too
+    QFile file(inputPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        errorMessages.fill("Could not read input: " + file.errorString());
+        return errorMessages;
+    }
+    uchar *data = file.map(0, file.size());
+    if (!data) {
+        errorMessages.fill("Could not map input: " + file.errorString());
+        return errorMessages;
+    }
+
+    heif_context *context = heif_context_alloc();
+    heif_image_handle *handle = nullptr;
+    heif_image *image = nullptr;
+
+    // Grid images are decoded tile by tile on this many threads
+    heif_context_set_max_decoding_threads(context, qMax(1, threads));
+
+    heif_error error = heif_context_read_from_memory_without_copy(context, data, file.size(), nullptr);
+    if (error.code == heif_error_Ok) {
+        error = heif_context_get_primary_image_handle(context, &handle);
+    }
+    if (error.code == heif_error_Ok) {
+        heif_image_handle *thumbnail = smallestThumbnailFor(handle, targets);
+        if (thumbnail) {
+            heif_image_handle_release(handle);
+            handle = thumbnail;
+        }
+    }
+    bool alpha = false;
+    bool deep = false;
+    if (error.code == heif_error_Ok) {
+        alpha = heif_image_handle_has_alpha_channel(handle);
+        // 10/12-bit images are reduced to 8 bits here rather than by libheif
+        deep = heif_image_handle_get_luma_bits_per_pixel(handle) > 8 && Q_BYTE_ORDER == Q_LITTLE_ENDIAN;
+        heif_chroma chroma = deep ? (alpha ? heif_chroma_interleaved_RRGGBBAA_LE : heif_chroma_interleaved_RRGGBB_LE)
+                                  : (alpha ? heif_chroma_interleaved_RGBA : heif_chroma_interleaved_RGB);
+        // Orientation (irot/imir) is applied by libheif, so the pixels are upright
+        error = heif_decode_image(handle, &image, heif_colorspace_RGB, chroma, nullptr);
+    }
+
+    if (error.code != heif_error_Ok) {
+        errorMessages.fill(QString("HEIC decode failed: %1").arg(QString::fromUtf8(error.message)));
+    } else {
+        int width = heif_image_get_width(image, heif_channel_interleaved);
+        int height = heif_image_get_height(image, heif_channel_interleaved);
+        int channels = alpha ? 4 : 3;
+        int stride = 0;
+        uchar *pixels = nullptr;
+        QImage reduced;
+
+        if (deep) {
+            int bits = heif_image_get_bits_per_pixel_range(image, heif_channel_interleaved);
+            const uint8_t *plane = heif_image_get_plane_readonly(image, heif_channel_interleaved, &stride);
+            reduced = QImage(width, height, alpha ? QImage::Format_RGBA8888 : QImage::Format_RGB888);
+            for (int y = 0; y < height; ++y) {
+                PixelKernels::reduceTo8(reinterpret_cast<const quint16 *>(plane + qsizetype(y) * stride),
+                                        reduced.scanLine(y), qsizetype(width) * channels, bits);
+            }
+            pixels = reduced.bits();
+            stride = reduced.bytesPerLine();
+        } else {
+            pixels = heif_image_get_plane(image, heif_channel_interleaved, &stride);
+        }
+
+        // An alpha channel that is opaque everywhere is dropped for all
+        // targets. Rows are repacked in place.
+        if (alpha && allRows(pixels, stride, width, height, PixelKernels::isOpaque)) {
+            for (int y = 0; y < height; ++y) {
+                uchar *row = pixels + qsizetype(y) * stride;
+                PixelKernels::rgbaToRgb(row, row, width);
+            }
+            channels = 3;
+        }
+
+        // Targets that keep the alpha channel are encoded first; JPEG has no
+        // alpha, so its targets follow once the same buffer has been
+        // composited onto white
+        bool heldBack = false;
+        for (int pass = 0; pass < 2; ++pass) {
+            if (pass == 1) {
+                if (!heldBack) {
+                    break;
+                }
+                for (int y = 0; y < height; ++y) {
+                    uchar *row = pixels + qsizetype(y) * stride;
+                    PixelKernels::flattenAlpha(row, row, width, 255, 255, 255);
+                }
+                channels = 3;
+            }
+
+            QList<int> pending;
+            for (int i = 0; i < targets.size(); ++i) {
+                bool jpeg = targets[i].format == Converter::FileFormat::JPG;
+                if (pass == 0 && jpeg && channels == 4) {
+                    heldBack = true;
+                } else if (pass == 0 || jpeg) {
+                    pending << i;
+                }
+            }
+            if (pending.isEmpty()) {
+                continue;
+            }
+
+            // Wraps the pixel buffer; nothing is copied before the encoder
+            QImage pixelsView(pixels, width, height, stride,
+                              channels == 4 ? QImage::Format_RGBA8888 : QImage::Format_RGB888);
+            bool grayscale = channels == 3 && allRows(pixels, stride, width, height, PixelKernels::isGrayscale);
+            for (int i : pending) {
+                errorMessages[i] = encode(pixelsView, grayscale, targets[i]);
+            }
+        }
+    }
+
+    if (image) {
+        heif_image_release(image);
+    }
+    if (handle) {
+        heif_image_handle_release(handle);
+    }
+    heif_context_free(context);
+    file.unmap(data);
+    return errorMessages;
+#else
+    Q_UNUSED(inputPath);
+    Q_UNUSED(threads);
+    QStringList errorMessages;
+    errorMessages.fill("Built without libheif", targets.size());
+    return errorMessages;
+#endif
+}
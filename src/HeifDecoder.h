@@ -0,0 +1,46 @@
+#ifndef HEIFDECODER_H
+#define HEIFDECODER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include "Converter.h"
+
+// In-process HEIC conversion with libheif (when built with
+// FILECONVERTER_HAVE_LIBHEIF): the grid tiles of an image are decoded on
+// several threads and the pixels go straight to Qt's encoder, without a
+// child process or an intermediate file.
+class HeifDecoder : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Target {
+        QString outputPath;
+        Converter::FileFormat format;
+        Converter::ResizeOptions resize;
+    };
+
+    explicit HeifDecoder(QObject *parent = nullptr);
+    ~HeifDecoder();
+
+    // False without libheif or when Qt has no writer for the target
+    static bool canConvertTo(Converter::FileFormat targetFormat);
+
+    // The image is decoded once and encoded to every target. threads: tiles
+    // decoded in parallel for this image. When every target is resized, an
+    // embedded thumbnail is decoded instead if it is large enough for all.
+    void convert(const QString &inputPath, const QList<Target> &targets, int threads);
+
+signals:
+    // One message per target, in order; empty where the target was written
+    void converted(const QString &inputPath, const QStringList &errorMessages);
+
+private:
+    static QStringList decodeAndEncode(const QString &inputPath, const QList<Target> &targets, int threads);
+
+    QThreadPool pool;
+};
+
+#endif // HEIFDECODER_H
@@ -0,0 +1,548 @@
+#include "HttpService.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QTimer>
+
+namespace {
+constexpr int MaxHeaderSize = 16 * 1024;
+constexpr qint64 ChunkSize = 1024 * 1024;
+constexpr qint64 MaxBufferedBytes = 4 * 1024 * 1024;
+constexpr int IdleTimeoutMs = 30000;
+
+void disconnectLater(QTcpSocket *socket)
+{
+    // Deferred so the connection is not torn down while a request is being handled
+    QMetaObject::invokeMethod(socket, [socket]() { socket->disconnectFromHost(); }, Qt::QueuedConnection);
+}
+}
+
+HttpService::HttpService(Converter *converter, QObject *parent)
+    : QObject(parent), converter(converter), maxPending(16), maxUploadSize(Q_INT64_C(2) * 1024 * 1024 * 1024),
+      pending(0)
+{
+    converter->setWriteBehindMode(Converter::WriteBehindMode::Off);
+
+    connect(&server, &QTcpServer::newConnection, this, &HttpService::onNewConnection);
+    connect(converter, &Converter::conversionStarted, this, &HttpService::onConversionStarted);
+    connect(converter, &Converter::conversionFinished, this, &HttpService::onConversionFinished);
+    connect(converter, &Converter::conversionError, this, &HttpService::onConversionError);
+}
+
+HttpService::~HttpService()
+{
+    const QList<Connection *> open = connections;
+    for (Connection *connection : open) {
+        closeConnection(connection);
+    }
+}
+
+bool HttpService::listen(const QHostAddress &address, quint16 port)
+{
+    return server.listen(address, port);
+}
+
+QString HttpService::errorString() const
+{
+    return server.errorString();
+}
+
+void HttpService::setMaxPending(int count)
+{
+    maxPending = qMax(1, count);
+}
+
+void HttpService::setMaxUploadSize(qint64 bytes)
+{
+    maxUploadSize = bytes;
+}
+
+void HttpService::onNewConnection()
+{
+    while (QTcpSocket *socket = server.nextPendingConnection()) {
+        Connection *connection = new Connection;
+        connection->socket = socket;
+        connection->idleTimer = new QTimer(socket);
+        connection->idleTimer->setSingleShot(true);
+        connection->state = State::ReadingHeaders;
+        connection->keepAlive = true;
+        connection->closing = false;
+        connection->admitted = false;
+        connection->bodyRemaining = 0;
+        connection->directory = nullptr;
+        connection->file = nullptr;
+        connection->targetFormat = Converter::FileFormat::Unknown;
+        connection->uploadDoneMs = -1;
+        connection->startedMs = -1;
+        connections.append(connection);
+
+        // Unread request data stays in the kernel while a conversion runs, so
+        // a client streaming faster than we convert is slowed down by TCP
+        socket->setReadBufferSize(ChunkSize);
+
+        connect(socket, &QTcpSocket::readyRead, this, [this, connection]() { onReadyRead(connection); });
+        connect(socket, &QTcpSocket::bytesWritten, this, [this, connection]() { pumpFile(connection); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, connection]() {
+            if (connection->state == State::Converting) {
+                // Client gave up; stop the tool and drop the connection when it exits
+                connection->idleTimer->stop();
+                connection->socket->disconnect(this);
+                connection->socket->deleteLater();
+                connection->socket = nullptr;
+                converter->cancelConversion(connection->inputPath);
+            } else {
+                closeConnection(connection);
+            }
+        });
+        connect(connection->idleTimer, &QTimer::timeout, this, [this, connection]() {
+            // Idle keep-alive connections and stalled uploads
+            if (connection->state == State::ReadingHeaders || connection->state == State::ReadingBody) {
+                connection->socket->abort();
+            }
+        });
+        connection->idleTimer->start(IdleTimeoutMs);
+    }
+}
+
+void HttpService::onReadyRead(Connection *connection)
+{
+    if (!connection->socket || connection->closing) {
+        return;
+    }
+    if (connection->state != State::ReadingHeaders && connection->state != State::ReadingBody) {
+        return;
+    }
+    connection->buffer.append(connection->socket->readAll());
+    connection->idleTimer->start(IdleTimeoutMs);
+    processBuffer(connection);
+}
+
+void HttpService::processBuffer(Connection *connection)
+{
+    while (connection->socket && !connection->closing) {
+        if (connection->state == State::ReadingHeaders) {
+            if (!parseHeaders(connection)) {
+                return;
+            }
+        } else if (connection->state == State::ReadingBody) {
+            if (connection->bodyRemaining > 0) {
+                if (connection->buffer.isEmpty()) {
+                    return;
+                }
+                qint64 count = qMin<qint64>(connection->buffer.size(), connection->bodyRemaining);
+                if (connection->file->write(connection->buffer.constData(), count) != count) {
+                    connection->keepAlive = false;
+                    sendResponse(connection, 500, "text/plain",
+                                 "Could not store the upload: " + connection->file->errorString().toUtf8());
+                    return;
+                }
+                connection->buffer.remove(0, count);
+                connection->bodyRemaining -= count;
+            }
+            if (connection->bodyRemaining == 0) {
+                finishUpload(connection);
+            }
+        } else {
+            return;
+        }
+    }
+}
+
+bool HttpService::parseHeaders(Connection *connection)
+{
+    int end = connection->buffer.indexOf("\r\n\r\n");
+    if (end < 0) {
+        if (connection->buffer.size() > MaxHeaderSize) {
+            connection->keepAlive = false;
+            sendResponse(connection, 431, "text/plain", "Request headers too large");
+        }
+        return false;
+    }
+
+    QList<QByteArray> lines = connection->buffer.left(end).split('\n');
+    connection->buffer.remove(0, end + 4);
+    connection->clock.start();
+
+    QList<QByteArray> requestLine = lines.takeFirst().trimmed().split(' ');
+    if (requestLine.size() != 3 || !requestLine[2].startsWith("HTTP/1.")) {
+        connection->keepAlive = false;
+        sendResponse(connection, 400, "text/plain", "Malformed request line");
+        return true;
+    }
+
+    QMap<QByteArray, QByteArray> headers;
+    for (const QByteArray &line : lines) {
+        int colon = line.indexOf(':');
+        if (colon > 0) {
+            headers[line.left(colon).trimmed().toLower()] = line.mid(colon + 1).trimmed();
+        }
+    }
+
+    // HTTP/1.1 is persistent unless the client says otherwise; 1.0 only on request
+    QByteArray connectionHeader = headers.value("connection").toLower();
+    connection->keepAlive = requestLine[2] == "HTTP/1.0" ? connectionHeader == "keep-alive"
+                                                         : connectionHeader != "close";
+
+    connection->method = requestLine[0];
+    QByteArray target = requestLine[1];
+    int question = target.indexOf('?');
+    connection->path = question < 0 ? target : target.left(question);
+    connection->query.clear();
+    if (question >= 0) {
+        const QList<QByteArray> pairs = target.mid(question + 1).split('&');
+        for (const QByteArray &pair : pairs) {
+            int equals = pair.indexOf('=');
+            QByteArray key = equals < 0 ? pair : pair.left(equals);
+            QByteArray value = equals < 0 ? QByteArray() : pair.mid(equals + 1);
+            connection->query[QByteArray::fromPercentEncoding(key)] =
+                QByteArray::fromPercentEncoding(value.replace('+', ' '));
+        }
+    }
+
+    beginRequest(connection, headers);
+    return true;
+}
+
+void HttpService::beginRequest(Connection *connection, const QMap<QByteArray, QByteArray> &headers)
+{
+    if (connection->path == "/health") {
+        if (connection->method != "GET") {
+            sendResponse(connection, 405, "text/plain", "Use GET", {{"Allow", "GET"}});
+            return;
+        }
+        QJsonObject health;
+        health["pending"] = pending;
+        health["maxPending"] = maxPending;
+        health["active"] = converter->activeConversions();
+        sendResponse(connection, 200, "application/json", QJsonDocument(health).toJson(QJsonDocument::Compact));
+        return;
+    }
+
+    if (connection->path != "/convert") {
+        connection->keepAlive = connection->keepAlive && !headers.contains("content-length");
+        sendResponse(connection, 404, "text/plain", "Not found");
+        return;
+    }
+    if (connection->method != "POST") {
+        sendResponse(connection, 405, "text/plain", "Use POST", {{"Allow", "POST"}});
+        return;
+    }
+
+    // Anything rejected from here on has an unread body, so the connection
+    // cannot be reused
+    if (headers.contains("transfer-encoding")) {
+        connection->keepAlive = false;
+        sendResponse(connection, 501, "text/plain", "Chunked uploads are not supported; send Content-Length");
+        return;
+    }
+    bool lengthOk = false;
+    qint64 length = headers.value("content-length").toLongLong(&lengthOk);
+    if (!lengthOk || length < 0) {
+        connection->keepAlive = false;
+        sendResponse(connection, 411, "text/plain", "Content-Length required");
+        return;
+    }
+    if (length > maxUploadSize) {
+        connection->keepAlive = false;
+        sendResponse(connection, 413, "text/plain", "Upload too large");
+        return;
+    }
+
+    // Only the file name is used, never a path from the request
+    QString name = QFileInfo(QString::fromUtf8(connection->query.value("name"))).fileName();
+    Converter::FileFormat sourceFormat = Converter::detectFormat(name);
+    connection->targetFormat = Converter::detectFormat("target." + QString::fromUtf8(connection->query.value("target")));
+    if (connection->targetFormat == Converter::FileFormat::Unknown) {
+        connection->keepAlive = false;
+        sendResponse(connection, 400, "text/plain", "Missing or unknown target format");
+        return;
+    }
+    if (sourceFormat == Converter::FileFormat::Unknown) {
+        connection->keepAlive = false;
+        sendResponse(connection, 415, "text/plain", "Missing or unsupported input name");
+        return;
+    }
+    // A PDF rendered to images gives one output per page, and a response
+    // carries one file
+    if (sourceFormat == Converter::FileFormat::PDF
+        && (connection->targetFormat == Converter::FileFormat::JPG
+            || connection->targetFormat == Converter::FileFormat::PNG
+            || connection->targetFormat == Converter::FileFormat::WEBP)) {
+        connection->keepAlive = false;
+        sendResponse(connection, 415, "text/plain", "PDF to image gives one file per page; not available here");
+        return;
+    }
+    bool resizeOk = false;
+    connection->resize = Converter::ResizeOptions::fromString(QString::fromUtf8(connection->query.value("resize")),
+                                                              &resizeOk);
+    if (!resizeOk) {
+        connection->keepAlive = false;
+        sendResponse(connection, 400, "text/plain", "Invalid resize, expected N or WxH");
+        return;
+    }
+    if (connection->query.value("fit") == "fill") {
+        connection->resize.mode = Converter::ResizeOptions::Mode::Fill;
+    }
+
+    // Back-pressure: uploads count against the limit too, so a burst of
+    // clients cannot fill the disk while the queue is full
+    if (pending >= maxPending) {
+        connection->keepAlive = false;
+        sendResponse(connection, 503, "text/plain", "Conversion queue is full", {{"Retry-After", "1"}});
+        return;
+    }
+
+    connection->directory = new QTemporaryDir();
+    if (!connection->directory->isValid()) {
+        connection->keepAlive = false;
+        sendResponse(connection, 500, "text/plain", "Could not create a working directory");
+        return;
+    }
+    QDir(connection->directory->path()).mkpath("in");
+    connection->inputPath = connection->directory->path() + "/in/" + name;
+    connection->file = new QFile(connection->inputPath);
+    if (!connection->file->open(QIODevice::WriteOnly)) {
+        connection->keepAlive = false;
+        sendResponse(connection, 500, "text/plain",
+                     "Could not store the upload: " + connection->file->errorString().toUtf8());
+        return;
+    }
+
+    pending++;
+    connection->admitted = true;
+    connection->bodyRemaining = length;
+    connection->state = State::ReadingBody;
+    if (headers.value("expect").toLower() == "100-continue") {
+        connection->socket->write("HTTP/1.1 100 Continue\r\n\r\n");
+    }
+}
+
+void HttpService::finishUpload(Connection *connection)
+{
+    connection->file->close();
+    delete connection->file;
+    connection->file = nullptr;
+    connection->uploadDoneMs = connection->clock.elapsed();
+    connection->state = State::Converting;
+
+    QString outDir = connection->directory->path() + "/out";
+    QDir().mkpath(outDir);
+    connectionsByInput[connection->inputPath] = connection;
+    // Each upload gets its own output directory; the converter's setting is
+    // left alone, as other requests are converting at the same time
+    Converter::OutputSpec output;
+    output.format = connection->targetFormat;
+    output.resize = connection->resize;
+    converter->convertFile(connection->inputPath, QList<Converter::OutputSpec>() << output, outDir);
+}
+
+void HttpService::onConversionStarted(const QString &filePath)
+{
+    Connection *connection = connectionsByInput.value(filePath);
+    if (connection) {
+        connection->startedMs = connection->clock.elapsed();
+    }
+}
+
+void HttpService::onConversionFinished(const QString &filePath, Converter::ConversionStatus status, const QString &outputPath)
+{
+    Connection *connection = connectionsByInput.take(filePath);
+    if (!connection) {
+        return;
+    }
+    if (!connection->socket) {
+        closeConnection(connection);
+    } else if (status == Converter::ConversionStatus::Success) {
+        sendFile(connection, outputPath);
+    } else if (status == Converter::ConversionStatus::Unsupported) {
+        sendResponse(connection, 415, "text/plain", "Unsupported conversion", timingHeaders(connection));
+    } else {
+        sendResponse(connection, 500, "text/plain", "Conversion failed", timingHeaders(connection));
+    }
+}
+
+void HttpService::onConversionError(const QString &filePath, const QString &errorMessage)
+{
+    Connection *connection = connectionsByInput.take(filePath);
+    if (!connection) {
+        return;
+    }
+    if (!connection->socket) {
+        closeConnection(connection);
+    } else {
+        sendResponse(connection, 500, "text/plain", errorMessage.toUtf8(), timingHeaders(connection));
+    }
+}
+
+QList<QPair<QByteArray, QByteArray>> HttpService::timingHeaders(Connection *connection) const
+{
+    qint64 now = connection->clock.elapsed();
+    qint64 upload = connection->uploadDoneMs;
+    qint64 started = connection->startedMs >= 0 ? connection->startedMs : now;
+    qint64 queue = started - upload;
+    qint64 convert = now - started;
+
+    return {
+        {"X-Upload-Time-Ms", QByteArray::number(upload)},
+        {"X-Queue-Time-Ms", QByteArray::number(queue)},
+        {"X-Convert-Time-Ms", QByteArray::number(convert)},
+        {"Server-Timing", QString("upload;dur=%1, queue;dur=%2, convert;dur=%3")
+                              .arg(upload).arg(queue).arg(convert).toUtf8()}
+    };
+}
+
+void HttpService::sendResponse(Connection *connection, int status, const QByteArray &contentType,
+                               const QByteArray &body, const QList<QPair<QByteArray, QByteArray>> &extraHeaders)
+{
+    QByteArray head = "HTTP/1.1 " + QByteArray::number(status) + ' ' + reasonPhrase(status) + "\r\n";
+    head += "Server: FileConverter\r\n";
+    head += "Content-Type: " + contentType + "\r\n";
+    head += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    for (const auto &header : extraHeaders) {
+        head += header.first + ": " + header.second + "\r\n";
+    }
+    head += connection->keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+
+    connection->socket->write(head);
+    connection->socket->write(body);
+    completeResponse(connection);
+}
+
+void HttpService::sendFile(Connection *connection, const QString &path)
+{
+    QList<QPair<QByteArray, QByteArray>> headers = timingHeaders(connection);
+    connection->file = new QFile(path);
+    if (!connection->file->open(QIODevice::ReadOnly)) {
+        sendResponse(connection, 500, "text/plain",
+                     "Could not read the output: " + connection->file->errorString().toUtf8(), headers);
+        return;
+    }
+
+    QByteArray name = QFileInfo(path).fileName().toUtf8();
+    QByteArray head = "HTTP/1.1 200 OK\r\n";
+    head += "Server: FileConverter\r\n";
+    head += "Content-Type: " + contentTypeFor(Converter::detectFormat(path)) + "\r\n";
+    head += "Content-Length: " + QByteArray::number(connection->file->size()) + "\r\n";
+    head += "Content-Disposition: attachment; filename*=UTF-8''" + name.toPercentEncoding() + "\r\n";
+    for (const auto &header : headers) {
+        head += header.first + ": " + header.second + "\r\n";
+    }
+    head += connection->keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+
+    connection->state = State::SendingResponse;
+    connection->socket->write(head);
+    pumpFile(connection);
+}
+
+void HttpService::pumpFile(Connection *connection)
+{
+    if (connection->state != State::SendingResponse || !connection->socket) {
+        return;
+    }
+    while (connection->socket->bytesToWrite() < MaxBufferedBytes) {
+        QByteArray chunk = connection->file->read(ChunkSize);
+        if (chunk.isEmpty()) {
+            completeResponse(connection);
+            // Pick up a pipelined request once this call stack has unwound
+            QMetaObject::invokeMethod(this, [this, connection]() {
+                if (connections.contains(connection)) {
+                    onReadyRead(connection);
+                }
+            }, Qt::QueuedConnection);
+            return;
+        }
+        connection->socket->write(chunk);
+    }
+}
+
+void HttpService::completeResponse(Connection *connection)
+{
+    resetRequest(connection);
+    connection->state = State::ReadingHeaders;
+    connection->idleTimer->start(IdleTimeoutMs);
+    if (!connection->keepAlive) {
+        connection->closing = true;
+        disconnectLater(connection->socket);
+    }
+}
+
+void HttpService::resetRequest(Connection *connection)
+{
+    if (connection->admitted) {
+        pending--;
+        connection->admitted = false;
+    }
+    if (connectionsByInput.value(connection->inputPath) == connection) {
+        connectionsByInput.remove(connection->inputPath);
+    }
+    delete connection->file;
+    connection->file = nullptr;
+    delete connection->directory; // Removes the upload and the produced output
+    connection->directory = nullptr;
+    connection->inputPath.clear();
+    connection->bodyRemaining = 0;
+    connection->uploadDoneMs = -1;
+    connection->startedMs = -1;
+}
+
+void HttpService::closeConnection(Connection *connection)
+{
+    if (connection->socket) {
+        connection->idleTimer->stop();
+        connection->socket->disconnect(this);
+        connection->socket->deleteLater(); // Also deletes the idle timer
+    }
+    resetRequest(connection);
+    connections.removeOne(connection);
+    delete connection;
+}
+
+QByteArray HttpService::contentTypeFor(Converter::FileFormat format)
+{
+    switch (format) {
+        case Converter::FileFormat::PDF:
+            return "application/pdf";
+        case Converter::FileFormat::DOCX:
+            return "application/vnd.openxmlformats-officedocument.wordprocessingml.document";
+        case Converter::FileFormat::PPTX:
+            return "application/vnd.openxmlformats-officedocument.presentationml.presentation";
+        case Converter::FileFormat::JPG:
+            return "image/jpeg";
+        case Converter::FileFormat::PNG:
+            return "image/png";
+        case Converter::FileFormat::WEBP:
+            return "image/webp";
+        case Converter::FileFormat::HEIC:
+            return "image/heic";
+        case Converter::FileFormat::XLSX:
+            return "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet";
+        case Converter::FileFormat::CSV:
+            return "text/csv";
+        case Converter::FileFormat::ZIP:
+            return "application/zip";
+        default:
+            return "application/octet-stream";
+    }
+}
+
+QByteArray HttpService::reasonPhrase(int status)
+{
+    switch (status) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 411: return "Length Required";
+        case 413: return "Payload Too Large";
+        case 415: return "Unsupported Media Type";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 503: return "Service Unavailable";
+        default: return "Unknown";
+    }
+}
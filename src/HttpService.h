@@ -0,0 +1,103 @@
+#ifndef HTTPSERVICE_H
+#define HTTPSERVICE_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QElapsedTimer>
+#include <QMap>
+#include "Converter.h"
+
+class QTcpSocket;
+class QTemporaryDir;
+class QFile;
+class QTimer;
+
+// "--serve" mode: a small HTTP/1.1 front end to the Converter queue.
+//
+//   POST /convert?target=pdf&name=report.docx   (body: the input file)
+//   GET  /health
+//
+// Uploads are streamed to disk as they arrive and results are streamed back.
+// Connections are kept alive between requests. When more than maxPending
+// requests are waiting for or running a conversion, new ones get 503.
+class HttpService : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr quint16 DefaultPort = 8080;
+
+    HttpService(Converter *converter, QObject *parent = nullptr);
+    ~HttpService();
+
+    bool listen(const QHostAddress &address, quint16 port);
+    QString errorString() const;
+    void setMaxPending(int count);
+    void setMaxUploadSize(qint64 bytes);
+
+private slots:
+    void onNewConnection();
+    void onConversionStarted(const QString &filePath);
+    void onConversionFinished(const QString &filePath, Converter::ConversionStatus status, const QString &outputPath);
+    void onConversionError(const QString &filePath, const QString &errorMessage);
+
+private:
+    enum class State {
+        ReadingHeaders,
+        ReadingBody,
+        Converting,
+        SendingResponse
+    };
+
+    struct Connection {
+        QTcpSocket *socket;
+        QTimer *idleTimer;
+        State state;
+        QByteArray buffer;
+        bool keepAlive;
+        bool closing;
+        bool admitted;              // Counted against maxPending
+
+        // Current request
+        QByteArray method;
+        QByteArray path;
+        QMap<QByteArray, QByteArray> query;
+        qint64 bodyRemaining;
+        QTemporaryDir *directory;
+        QFile *file;
+        QString inputPath;
+        Converter::FileFormat targetFormat;
+        Converter::ResizeOptions resize;
+
+        // Timing
+        QElapsedTimer clock;
+        qint64 uploadDoneMs;
+        qint64 startedMs;
+    };
+
+    void onReadyRead(Connection *connection);
+    void processBuffer(Connection *connection);
+    bool parseHeaders(Connection *connection);
+    void beginRequest(Connection *connection, const QMap<QByteArray, QByteArray> &headers);
+    void finishUpload(Connection *connection);
+    void sendResponse(Connection *connection, int status, const QByteArray &contentType,
+                      const QByteArray &body, const QList<QPair<QByteArray, QByteArray>> &extraHeaders = {});
+    void sendFile(Connection *connection, const QString &path);
+    void pumpFile(Connection *connection);
+    void completeResponse(Connection *connection);
+    void resetRequest(Connection *connection);
+    void closeConnection(Connection *connection);
+    QList<QPair<QByteArray, QByteArray>> timingHeaders(Connection *connection) const;
+    static QByteArray contentTypeFor(Converter::FileFormat format);
+    static QByteArray reasonPhrase(int status);
+
+    QTcpServer server;
+    Converter *converter;
+    int maxPending;
+    qint64 maxUploadSize;
+    int pending;
+    QMap<QString, Connection *> connectionsByInput;
+    QList<Connection *> connections;
+};
+
+#endif // HTTPSERVICE_H
@@ -0,0 +1,93 @@
+#include "IncrementalIndex.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QUrl>
+
+IncrementalIndex::IncrementalIndex(const QString &path)
+    : indexPath(path), dirty(false)
+{
+}
+
+QString IncrementalIndex::key(const QString &inputPath, const QString &extension)
+{
+    return extension + '\n' + inputPath;
+}
+
+bool IncrementalIndex::load()
+{
+    records.clear();
+    dirty = false;
+
+    QFile file(indexPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    // One record per line: size, mtime, extension, output, input
+    while (!file.atEnd()) {
+        QList<QByteArray> fields = file.readLine().trimmed().split('\t');
+        if (fields.size() != 5) {
+            continue;
+        }
+        Record record;
+        record.inputSize = fields[0].toLongLong();
+        record.inputModifiedMs = fields[1].toLongLong();
+        record.outputPath = QUrl::fromPercentEncoding(fields[3]);
+        QString extension = QString::fromLatin1(fields[2]);
+        records.insert(key(QUrl::fromPercentEncoding(fields[4]), extension), record);
+    }
+    return true;
+}
+
+bool IncrementalIndex::save()
+{
+    if (!dirty || indexPath.isEmpty()) {
+        return true;
+    }
+
+    QDir().mkpath(QFileInfo(indexPath).absolutePath());
+    QSaveFile file(indexPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    for (auto it = records.constBegin(); it != records.constEnd(); ++it) {
+        int split = it.key().indexOf('\n');
+        QByteArray line;
+        line += QByteArray::number(it.value().inputSize) + '\t';
+        line += QByteArray::number(it.value().inputModifiedMs) + '\t';
+        line += it.key().left(split).toLatin1() + '\t';
+        line += QUrl::toPercentEncoding(it.value().outputPath, "/:\\ ") + '\t';
+        line += QUrl::toPercentEncoding(it.key().mid(split + 1), "/:\\ ") + '\n';
+        file.write(line);
+    }
+
+    if (!file.commit()) {
+        return false;
+    }
+    dirty = false;
+    return true;
+}
+
+bool IncrementalIndex::isDirty() const
+{
+    return dirty;
+}
+
+bool IncrementalIndex::lookup(const QString &inputPath, const QString &extension, Record *record) const
+{
+    auto it = records.constFind(key(inputPath, extension));
+    if (it == records.constEnd()) {
+        return false;
+    }
+    *record = it.value();
+    return true;
+}
+
+void IncrementalIndex::update(const QString &inputPath, const QString &extension, const Record &record)
+{
+    records.insert(key(inputPath, extension), record);
+    dirty = true;
+}
@@ -0,0 +1,36 @@
+#ifndef INCREMENTALINDEX_H
+#define INCREMENTALINDEX_H
+
+#include <QString>
+#include <QHash>
+
+// Persistent record of what each input looked like when its output was last
+// produced. Lets incremental runs skip up-to-date jobs without touching the
+// output volume.
+class IncrementalIndex
+{
+public:
+    struct Record {
+        qint64 inputSize;
+        qint64 inputModifiedMs;
+        QString outputPath;
+    };
+
+    explicit IncrementalIndex(const QString &path = QString());
+
+    bool load();
+    bool save();
+    bool isDirty() const;
+
+    bool lookup(const QString &inputPath, const QString &extension, Record *record) const;
+    void update(const QString &inputPath, const QString &extension, const Record &record);
+
+private:
+    static QString key(const QString &inputPath, const QString &extension);
+
+    QString indexPath;
+    QHash<QString, Record> records;
+    bool dirty;
+};
+
+#endif // INCREMENTALINDEX_H
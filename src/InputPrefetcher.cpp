@@ -0,0 +1,125 @@
+#include "InputPrefetcher.h"
+#include <QFile>
+#include <QThreadPool>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#endif
+
+InputPrefetcher::InputPrefetcher()
+    : prefetchDepth(4), budgetBytes(256LL * 1024 * 1024), usedBytes(0)
+{
+}
+
+void InputPrefetcher::setDepth(int depth)
+{
+    prefetchDepth = qMax(0, depth);
+}
+
+void InputPrefetcher::setMemoryBudget(qint64 bytes)
+{
+    budgetBytes = qMax<qint64>(0, bytes);
+}
+
+int InputPrefetcher::depth() const
+{
+    return prefetchDepth;
+}
+
+qint64 InputPrefetcher::memoryBudget() const
+{
+    return budgetBytes;
+}
+
+qint64 InputPrefetcher::prefetchedBytes() const
+{
+    return usedBytes;
+}
+
+bool InputPrefetcher::prefetch(const QString &path, qint64 size)
+{
+    if (prefetched.contains(path)) {
+        return true;
+    }
+    if (size <= 0 || usedBytes + size > budgetBytes) {
+        return false;
+    }
+
+    prefetched.insert(path, size);
+    usedBytes += size;
+    issueReadahead(path, size);
+    return true;
+}
+
+void InputPrefetcher::release(const QString &path)
+{
+    auto it = prefetched.find(path);
+    if (it == prefetched.end()) {
+        return;
+    }
+    usedBytes -= it.value();
+    prefetched.erase(it);
+}
+
+void InputPrefetcher::releaseAll()
+{
+    prefetched.clear();
+    usedBytes = 0;
+}
+
+quint64 InputPrefetcher::fileId(const QString &path)
+{
+#if defined(Q_OS_UNIX)
+    struct stat st;
+    if (::stat(QFile::encodeName(path).constData(), &st) == 0) {
+        return static_cast<quint64>(st.st_ino);
+    }
+#elif defined(Q_OS_WIN)
+    HANDLE handle = CreateFileW(reinterpret_cast<LPCWSTR>(path.utf16()), 0,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+    if (handle != INVALID_HANDLE_VALUE) {
+        BY_HANDLE_FILE_INFORMATION info;
+        quint64 id = 0;
+        if (GetFileInformationByHandle(handle, &info)) {
+            id = (static_cast<quint64>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+        }
+        CloseHandle(handle);
+        return id;
+    }
+#else
+    Q_UNUSED(path);
+#endif
+    return 0;
+}
+
+void InputPrefetcher::issueReadahead(const QString &path, qint64 size)
+{
+#if defined(Q_OS_LINUX)
+    // Kernel-side asynchronous readahead, no copy into user space
+    int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        ::posix_fadvise(fd, 0, size, POSIX_FADV_WILLNEED);
+        ::posix_fadvise(fd, 0, size, POSIX_FADV_SEQUENTIAL);
+        ::close(fd);
+    }
+#else
+    // No fadvise: read the file once on a worker thread to populate the cache
+    Q_UNUSED(size);
+    QThreadPool::globalInstance()->start([path]() {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return;
+        }
+        QByteArray buffer(1024 * 1024, Qt::Uninitialized);
+        while (file.read(buffer.data(), buffer.size()) > 0) {
+        }
+    });
+#endif
+}
@@ -0,0 +1,39 @@
+#ifndef INPUTPREFETCHER_H
+#define INPUTPREFETCHER_H
+
+#include <QString>
+#include <QHash>
+
+// Warms the page cache for inputs at the head of the conversion queue so the
+// child tool reads from memory instead of waiting on a slow disk or share.
+class InputPrefetcher
+{
+public:
+    InputPrefetcher();
+
+    void setDepth(int depth);
+    void setMemoryBudget(qint64 bytes);
+    int depth() const;
+    qint64 memoryBudget() const;
+    qint64 prefetchedBytes() const;
+
+    // Returns false if the file would exceed the memory budget
+    bool prefetch(const QString &path, qint64 size);
+    void release(const QString &path);
+    void releaseAll();
+
+    // Stable on-disk identity (inode / file index) used for locality ordering
+    static quint64 fileId(const QString &path);
+
+private:
+    static void issueReadahead(const QString &path, qint64 size);
+
+    // Prefetched but not yet started: key = path, value = bytes
+    QHash<QString, qint64> prefetched;
+
+    int prefetchDepth;
+    qint64 budgetBytes;
+    qint64 usedBytes;
+};
+
+#endif // INPUTPREFETCHER_H
@@ -0,0 +1,193 @@
+#include "JobJournal.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTimer>
+#include <QUrl>
+#include <QMap>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+// Records are made durable at least this often, or every SyncEveryRecords
+constexpr int SyncIntervalMs = 250;
+constexpr int SyncEveryRecords = 256;
+
+void syncToDisk(QFile &file)
+{
+    file.flush();
+#ifdef Q_OS_WIN
+    FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(file.handle())));
+#else
+    ::fsync(file.handle());
+#endif
+}
+}
+
+JobJournal::JobJournal(const QString &path, QObject *parent)
+    : QObject(parent), journalPath(path), unsyncedRecords(0)
+{
+    syncTimer = new QTimer(this);
+    syncTimer->setSingleShot(true);
+    connect(syncTimer, &QTimer::timeout, this, &JobJournal::sync);
+}
+
+JobJournal::~JobJournal()
+{
+    sync();
+}
+
+QByteArray JobJournal::encode(const QString &value)
+{
+    // Keeps tabs and newlines in paths from breaking the line format
+    return QUrl::toPercentEncoding(value, "/:\\ ");
+}
+
+QString JobJournal::decode(const QByteArray &value)
+{
+    return QUrl::fromPercentEncoding(value);
+}
+
+QByteArray JobJournal::submittedRecord(const Entry &entry)
+{
+    // The resize and extra output fields were added later; older journals
+    // have five or six fields
+    QByteArray line = "S\t" + QByteArray::number(entry.submittedMs) + "\t" + entry.targetExtension.toLatin1()
+                      + "\t" + encode(entry.inputPath) + "\t" + encode(entry.outputDirectory);
+    if (!entry.resize.isEmpty() || !entry.extraOutputs.isEmpty()) {
+        line += "\t" + entry.resize.toLatin1();
+    }
+    if (!entry.extraOutputs.isEmpty()) {
+        line += "\t" + entry.extraOutputs.toLatin1();
+    }
+    return line + "\n";
+}
+
+bool JobJournal::ensureOpen()
+{
+    if (file.isOpen()) {
+        return true;
+    }
+    QDir().mkpath(QFileInfo(journalPath).absolutePath());
+    file.setFileName(journalPath);
+    return file.open(QIODevice::WriteOnly | QIODevice::Append);
+}
+
+QList<JobJournal::Entry> JobJournal::replay()
+{
+    sync();
+    file.close();
+    pending.clear();
+
+    // Ordered by first submission so the resumed batch keeps its order
+    QList<Entry> entries;
+    QMap<QString, int> index;
+
+    QFile in(journalPath);
+    if (in.open(QIODevice::ReadOnly)) {
+        while (!in.atEnd()) {
+            QByteArray line = in.readLine();
+            if (!line.endsWith('\n')) {
+                break; // Torn final record from a crash
+            }
+            QList<QByteArray> fields = line.trimmed().split('\t');
+            if (fields.size() >= 5 && fields.size() <= 7 && fields[0] == "S") {
+                Entry entry;
+                entry.submittedMs = fields[1].toLongLong();
+                entry.targetExtension = QString::fromLatin1(fields[2]);
+                entry.inputPath = decode(fields[3]);
+                entry.outputDirectory = decode(fields[4]);
+                entry.resize = QString::fromLatin1(fields.value(5));
+                entry.extraOutputs = QString::fromLatin1(fields.value(6));
+                if (index.contains(entry.inputPath)) {
+                    entries[index.value(entry.inputPath)] = entry;
+                } else {
+                    index.insert(entry.inputPath, entries.size());
+                    entries.append(entry);
+                }
+            } else if (fields.size() == 2 && fields[0] == "D") {
+                QString inputPath = decode(fields[1]);
+                if (index.contains(inputPath)) {
+                    entries[index.value(inputPath)].inputPath.clear();
+                    index.remove(inputPath);
+                }
+            }
+        }
+        in.close();
+    }
+
+    QList<Entry> unfinished;
+    for (const Entry &entry : entries) {
+        if (!entry.inputPath.isEmpty()) {
+            unfinished.append(entry);
+        }
+    }
+
+    // Compact: rewrite the journal with only the unfinished submissions
+    QSaveFile out(journalPath);
+    if (out.open(QIODevice::WriteOnly)) {
+        for (const Entry &entry : unfinished) {
+            out.write(submittedRecord(entry));
+            pending.insert(entry.inputPath);
+        }
+        out.commit();
+    }
+
+    return unfinished;
+}
+
+void JobJournal::recordSubmitted(const Entry &entry)
+{
+    pending.insert(entry.inputPath);
+    append(submittedRecord(entry));
+}
+
+void JobJournal::recordCompleted(const QString &inputPath)
+{
+    if (!pending.remove(inputPath)) {
+        return;
+    }
+    append("D\t" + encode(inputPath) + "\n");
+}
+
+bool JobJournal::isPending(const QString &inputPath) const
+{
+    return pending.contains(inputPath);
+}
+
+void JobJournal::append(const QByteArray &line)
+{
+    if (!ensureOpen()) {
+        return;
+    }
+    file.write(line);
+
+    if (++unsyncedRecords >= SyncEveryRecords) {
+        sync();
+    } else if (!syncTimer->isActive()) {
+        syncTimer->start(SyncIntervalMs);
+    }
+}
+
+void JobJournal::sync()
+{
+    syncTimer->stop();
+    if (file.isOpen() && unsyncedRecords > 0) {
+        syncToDisk(file);
+    }
+    unsyncedRecords = 0;
+}
+
+void JobJournal::reset()
+{
+    syncTimer->stop();
+    file.close();
+    unsyncedRecords = 0;
+    pending.clear();
+    QFile::remove(journalPath);
+}
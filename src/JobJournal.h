@@ -0,0 +1,58 @@
+#ifndef JOBJOURNAL_H
+#define JOBJOURNAL_H
+
+#include <QObject>
+#include <QString>
+#include <QFile>
+#include <QSet>
+#include <QList>
+
+class QTimer;
+
+// Append-only record of submitted and completed jobs so an interrupted batch
+// can be resumed. Writes are buffered and fsync'ed in batches.
+class JobJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Entry {
+        QString inputPath;
+        QString targetExtension;
+        QString outputDirectory;
+        QString resize;             // Converter::ResizeOptions string, empty for none
+        QString extraOutputs;       // Comma-separated Converter::OutputSpec strings
+        qint64 submittedMs;
+    };
+
+    explicit JobJournal(const QString &path, QObject *parent = nullptr);
+    ~JobJournal();
+
+    // Reads the existing journal and returns the jobs that never completed,
+    // then compacts the file so it only holds those jobs
+    QList<Entry> replay();
+
+    void recordSubmitted(const Entry &entry);
+    void recordCompleted(const QString &inputPath);
+    bool isPending(const QString &inputPath) const;
+
+    // Forces buffered records to disk
+    void sync();
+    // Called when a batch has fully finished
+    void reset();
+
+private:
+    bool ensureOpen();
+    void append(const QByteArray &line);
+    static QByteArray encode(const QString &value);
+    static QString decode(const QByteArray &value);
+    static QByteArray submittedRecord(const Entry &entry);
+
+    QString journalPath;
+    QFile file;
+    QSet<QString> pending;
+    QTimer *syncTimer;
+    int unsyncedRecords;
+};
+
+#endif // JOBJOURNAL_H
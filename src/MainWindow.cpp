@@ -11,25 +11,94 @@
 #include <QDesktopServices>
 #include <QUrl>
 #include <QDir>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QInputDialog>
 
 MainWindow::MainWindow(QWidget *parent)
-    : QMainWindow(parent), totalFiles(0), processedFiles(0)
+    : QMainWindow(parent), totalFiles(0), processedFiles(0), convertedFiles(0), publishedFiles(0),
+      nextRow(0), feedScheduled(false)
 {
     setupUI();
     
     // Create converter
     converter = new Converter(this);
     connect(converter, &Converter::conversionStarted, this, &MainWindow::onConversionStarted);
+    connect(converter, &Converter::conversionRouted, this, &MainWindow::onConversionRouted);
+    connect(converter, &Converter::conversionStaged, this, &MainWindow::onConversionStaged);
     connect(converter, &Converter::conversionFinished, this, &MainWindow::onConversionFinished);
     connect(converter, &Converter::conversionError, this, &MainWindow::onConversionError);
     connect(converter, &Converter::allConversionsFinished, this, &MainWindow::onAllConversionsFinished);
     
+    // Input readahead settings
+    QSettings settings;
+    converter->setPrefetchDepth(settings.value("io/prefetchDepth", 4).toInt());
+    converter->setPrefetchMemoryBudget(settings.value("io/prefetchBudgetMB", 256).toLongLong() * 1024 * 1024);
+    converter->setLocalityOrdering(settings.value("io/localityOrdering", true).toBool());
+    
+    // Write-behind for slow output volumes: "auto", "always" or "off"
+    QString writeBehind = settings.value("io/writeBehind", "auto").toString();
+    if (writeBehind == "always") {
+        converter->setWriteBehindMode(Converter::WriteBehindMode::Always);
+    } else if (writeBehind == "off") {
+        converter->setWriteBehindMode(Converter::WriteBehindMode::Off);
+    }
+    converter->setPublishThreads(settings.value("io/publishThreads", 2).toInt());
+    converter->setArchiveMemoryBudget(settings.value("io/archiveBudgetMB", 256).toLongLong() * 1024 * 1024);
+    
+    // Remote workers: "host:port[:slots],..."
+    converter->setWorkerEndpoints(WorkerProtocol::parseEndpoints(settings.value("remote/workers").toString()));
+    
     // Progress timer for time estimates
     progressTimer = new QTimer(this);
     connect(progressTimer, &QTimer::timeout, this, &MainWindow::updateProgressTimer);
     
     // Set default output directory to user's Documents
     outputDirectory = QDir::homePath() + "/Documents/FileConverter_Output";
+    
+    // Journal of submitted/completed jobs so a crashed batch can be resumed
+    journalPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/journal.log";
+    converter->setJournalPath(journalPath);
+    // Run times of earlier batches, for routing and the ETA
+    converter->setThroughputStatsPath(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+                                      + "/throughput.stats");
+    QTimer::singleShot(0, this, &MainWindow::checkForInterruptedBatch);
+}
+
+void MainWindow::checkForInterruptedBatch()
+{
+    if (!QFileInfo::exists(journalPath)) {
+        return;
+    }
+    
+    QMessageBox::StandardButton reply = QMessageBox::question(
+        this,
+        "Resume Conversion",
+        "A previous conversion batch did not finish.\n\nWould you like to resume the unfinished files?",
+        QMessageBox::Yes | QMessageBox::No
+    );
+    
+    if (reply != QMessageBox::Yes) {
+        converter->discardJournal();
+        return;
+    }
+    
+    QStringList resumed = converter->resumeFromJournal();
+    if (resumed.isEmpty()) {
+        converter->discardJournal();
+        statusBar()->showMessage("Nothing left to resume - all files were already converted");
+        return;
+    }
+    
+    addFilesToList(resumed);
+    beginBatch(resumed.size());
+    for (const QString &filePath : resumed) {
+        int row = findFileRow(filePath);
+        if (row != -1) {
+            fileListTable->item(row, 3)->setText("Queued");
+        }
+    }
+    statusBar()->showMessage(QString("Resuming %1 unfinished file(s)").arg(resumed.size()));
 }
 
 MainWindow::~MainWindow()
@@ -102,15 +171,39 @@ void MainWindow::setupUI()
 
     formatSelector = new QComboBox(this);
     formatSelector->addItem("PDF", static_cast<int>(Converter::FileFormat::PDF));
+    formatSelector->addItem("PDF/A", static_cast<int>(Converter::FileFormat::PDFA));
     formatSelector->addItem("DOCX", static_cast<int>(Converter::FileFormat::DOCX));
     formatSelector->addItem("PPTX", static_cast<int>(Converter::FileFormat::PPTX));
     formatSelector->addItem("JPG", static_cast<int>(Converter::FileFormat::JPG));
     formatSelector->addItem("PNG", static_cast<int>(Converter::FileFormat::PNG));
     formatSelector->addItem("WEBP", static_cast<int>(Converter::FileFormat::WEBP));
+    formatSelector->addItem("XLSX", static_cast<int>(Converter::FileFormat::XLSX));
+    formatSelector->addItem("CSV", static_cast<int>(Converter::FileFormat::CSV));
     formatSelector->setMinimumWidth(120);
     connect(formatSelector, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::onFormatChanged);
     controlLayout->addWidget(formatSelector);
 
+    // Further formats and sizes, all written from one decode (images) or one
+    // LibreOffice load (documents)
+    extraOutputsButton = new QToolButton(this);
+    extraOutputsButton->setText("Also as");
+    extraOutputsButton->setToolTip("Write inputs in further formats or sizes as well");
+    extraOutputsButton->setPopupMode(QToolButton::InstantPopup);
+    QMenu *extraOutputsMenu = new QMenu(extraOutputsButton);
+    for (Converter::FileFormat format : {Converter::FileFormat::PDF, Converter::FileFormat::PDFA,
+                                         Converter::FileFormat::JPG, Converter::FileFormat::PNG,
+                                         Converter::FileFormat::WEBP}) {
+        QAction *action = extraOutputsMenu->addAction(Converter::formatToString(format));
+        action->setCheckable(true);
+        action->setData(static_cast<int>(format));
+        extraFormatActions << action;
+    }
+    extraOutputsMenu->addSeparator();
+    QAction *sizesAction = extraOutputsMenu->addAction("Sizes...");
+    connect(sizesAction, &QAction::triggered, this, &MainWindow::onExtraSizesClicked);
+    extraOutputsButton->setMenu(extraOutputsMenu);
+    controlLayout->addWidget(extraOutputsButton);
+
     convertButton = new QPushButton("Convert All", this);
     convertButton->setStyleSheet("QPushButton { background-color: #4CAF50; color: white; font-weight: bold; padding: 8px 20px; }"
                                  "QPushButton:disabled { background-color: #cccccc; color: #666666; }");
@@ -180,7 +273,7 @@ void MainWindow::onAddFilesClicked()
         this,
         "Select Files to Convert",
         QString(),
-        "All Supported Files (*.docx *.pptx *.pdf *.jpg *.jpeg *.png *.webp *.heic *.heif);;Documents (*.docx *.pptx *.pdf);;Images (*.jpg *.jpeg *.png *.webp *.heic *.heif);;All Files (*.*)"
+        "All Supported Files (*.docx *.pptx *.pdf *.jpg *.jpeg *.png *.webp *.heic *.heif *.xlsx *.csv *.zip);;Documents (*.docx *.pptx *.pdf);;Images (*.jpg *.jpeg *.png *.webp *.heic *.heif);;Spreadsheets (*.xlsx *.csv);;Archives (*.zip);;All Files (*.*)"
     );
 
     if (!files.isEmpty()) {
@@ -274,8 +367,154 @@ void MainWindow::onConvertClicked()
         formatSelector->currentData().toInt()
     );
 
-    totalFiles = fileListTable->rowCount();
+    // Progress counts outputs, so an image written three ways counts three times
+    QList<QList<Converter::OutputSpec>> outputs;
+    int outputCount = 0;
+    rowOutputs.clear();
+    remainingOutputs.clear();
+    renderedPages.clear();
+    stagedPageRows.clear();
+    rowBackends.clear();
+    for (int i = 0; i < fileListTable->rowCount(); ++i) {
+        QString filePath = fileListTable->item(i, 1)->text();
+        outputs << outputsFor(filePath, targetFormat);
+        outputCount += outputs.last().size();
+        if (outputs.last().size() > 1) {
+            rowOutputs[filePath] = outputs.last().size();
+            remainingOutputs[filePath] = outputs.last().size();
+        }
+        // The page count is not known up front; such a row counts once
+        if (Converter::detectFormat(filePath) == Converter::FileFormat::PDF
+            && (targetFormat == Converter::FileFormat::JPG || targetFormat == Converter::FileFormat::PNG
+                || targetFormat == Converter::FileFormat::WEBP)) {
+            renderedPages[filePath] = 0;
+        }
+    }
+
+    beginBatch(outputCount);
+
+    for (int i = 0; i < fileListTable->rowCount(); ++i) {
+        fileListTable->item(i, 3)->setText("Queued");
+    }
+    // Rows are handed over only as the converter has room, so a long list
+    // does not sit in its queue all at once
+    pendingOutputs = outputs;
+    nextRow = 0;
+    feedRows();
+}
+
+void MainWindow::feedRows()
+{
+    feedScheduled = false;
+    while (nextRow < pendingOutputs.size() && converter->wantsMoreJobs()) {
+        int row = nextRow++;
+        converter->post(fileListTable->item(row, 1)->text(), pendingOutputs[row]);
+    }
+    if (nextRow >= pendingOutputs.size()) {
+        pendingOutputs.clear();
+        nextRow = 0;
+    }
+}
+
+void MainWindow::scheduleFeed()
+{
+    // Signals arrive from inside the converter's own loops; submit from the
+    // event loop instead
+    if (pendingOutputs.isEmpty() || feedScheduled) {
+        return;
+    }
+    feedScheduled = true;
+    QMetaObject::invokeMethod(this, &MainWindow::feedRows, Qt::QueuedConnection);
+}
+
+QList<Converter::OutputSpec> MainWindow::outputsFor(const QString &filePath, Converter::FileFormat targetFormat)
+{
+    Converter::OutputSpec primary;
+    primary.format = targetFormat;
+    QList<Converter::OutputSpec> outputs;
+    outputs << primary;
+
+    // Further outputs apply to image to image conversions and to document
+    // exports, which share one decode or one load respectively. PDF pages
+    // rendered to images are one output each and take no extras.
+    Converter::FileFormat sourceFormat = Converter::detectFormat(filePath);
+    bool document = sourceFormat == Converter::FileFormat::DOCX || sourceFormat == Converter::FileFormat::PPTX;
+    if (sourceFormat == Converter::FileFormat::PDF) {
+        return outputs;
+    }
+    auto shared = [&](Converter::FileFormat format) {
+        bool exportFormat = format == Converter::FileFormat::PDF || format == Converter::FileFormat::PDFA
+                            || format == Converter::FileFormat::PNG;
+        bool imageFormat = format == Converter::FileFormat::JPG || format == Converter::FileFormat::PNG
+                           || format == Converter::FileFormat::WEBP;
+        return (document ? exportFormat : imageFormat) && canConvertToFormat(sourceFormat, format);
+    };
+    if (sourceFormat == Converter::FileFormat::ZIP || !shared(targetFormat)) {
+        return outputs;
+    }
+
+    QList<Converter::FileFormat> formats;
+    formats << targetFormat;
+    for (QAction *action : extraFormatActions) {
+        Converter::FileFormat format = static_cast<Converter::FileFormat>(action->data().toInt());
+        if (action->isChecked() && !formats.contains(format) && shared(format)) {
+            formats << format;
+        }
+    }
+
+    // Every format at the original size and, for images, at every extra size
+    const QList<Converter::ResizeOptions> sizes = document ? QList<Converter::ResizeOptions>() : extraSizes;
+    outputs.clear();
+    for (Converter::FileFormat format : formats) {
+        Converter::OutputSpec output;
+        output.format = format;
+        outputs << output;
+        for (const Converter::ResizeOptions &size : sizes) {
+            output.resize = size;
+            outputs << output;
+        }
+    }
+    return outputs;
+}
+
+void MainWindow::onExtraSizesClicked()
+{
+    QStringList current;
+    for (const Converter::ResizeOptions &size : extraSizes) {
+        current << size.toString();
+    }
+
+    bool accepted = false;
+    QString text = QInputDialog::getText(this, "Extra Sizes",
+        "Also write image outputs at these sizes, separated by commas.\n"
+        "N fits a square box, WxH a rectangle; a trailing ^ crops to fill it.",
+        QLineEdit::Normal, current.join(", "), &accepted);
+    if (!accepted) {
+        return;
+    }
+
+    QList<Converter::ResizeOptions> sizes;
+    const QStringList entries = text.split(',', Qt::SkipEmptyParts);
+    for (const QString &entry : entries) {
+        bool ok = false;
+        Converter::ResizeOptions size = Converter::ResizeOptions::fromString(entry, &ok);
+        if (!ok || size.isNull()) {
+            QMessageBox::warning(this, "Invalid Size", QString("\"%1\" is not a valid size.").arg(entry.trimmed()));
+            return;
+        }
+        sizes << size;
+    }
+    extraSizes = sizes;
+    statusBar()->showMessage(extraSizes.isEmpty() ? "No extra sizes"
+                                                  : QString("Extra sizes: %1").arg(text.simplified()));
+}
+
+void MainWindow::beginBatch(int fileCount)
+{
+    totalFiles = fileCount;
     processedFiles = 0;
+    convertedFiles = 0;
+    publishedFiles = 0;
     lastOutputPath = outputDirectory;
 
     progressBar->setMaximum(totalFiles);
@@ -290,18 +529,12 @@ void MainWindow::onConvertClicked()
     clearButton->setEnabled(false);
     removeButton->setEnabled(false);
     formatSelector->setEnabled(false);
+    extraOutputsButton->setEnabled(false);
     browseOutputButton->setEnabled(false);
 
     // Start elapsed timer
     elapsedTimer.start();
     progressTimer->start(500); // Update every 500ms
-
-    // Queue all files for conversion (converter handles parallel execution)
-    for (int i = 0; i < fileListTable->rowCount(); ++i) {
-        QString filePath = fileListTable->item(i, 1)->text();
-        fileListTable->item(i, 3)->setText("Queued");
-        converter->convertFile(filePath, targetFormat);
-    }
 }
 
 void MainWindow::onConversionStarted(const QString &filePath)
@@ -313,48 +546,108 @@ void MainWindow::onConversionStarted(const QString &filePath)
     }
 }
 
+void MainWindow::onConversionRouted(const QString &filePath, const QString &backend, int attempt)
+{
+    int row = findFileRow(filePath);
+    if (row == -1) {
+        return;
+    }
+    // Routed once before means an earlier run failed
+    if (rowBackends.contains(filePath)) {
+        fileListTable->item(row, 3)->setText(QString("Retrying with %1 (attempt %2)...").arg(backend).arg(attempt));
+    }
+    rowBackends[filePath] = backend;
+}
+
+void MainWindow::onConversionStaged(const QString &filePath)
+{
+    // Entries of a ZIP being converted have no row of their own
+    int row = findFileRow(filePath);
+    if (row == -1) {
+        return;
+    }
+    if (!renderedPages.contains(filePath) || !stagedPageRows.contains(filePath)) {
+        convertedFiles++;
+        stagedPageRows.insert(filePath);
+    }
+    fileListTable->item(row, 3)->setText("Publishing...");
+}
+
 void MainWindow::onConversionFinished(const QString &filePath, Converter::ConversionStatus status, const QString &outputPath)
 {
     int row = findFileRow(filePath);
-    if (row != -1) {
-        switch (status) {
-            case Converter::ConversionStatus::Success:
+    if (row == -1) {
+        return; // An entry of a ZIP; the archive has the row
+    }
+    
+    // Images with several outputs report each one; anything but a success
+    // ends the whole row
+    int outputs = 1;
+    auto remaining = remainingOutputs.find(filePath);
+    if (remaining != remainingOutputs.end()) {
+        outputs = status == Converter::ConversionStatus::Success ? 1 : remaining.value();
+        remaining.value() -= outputs;
+    }
+    // A PDF rendered to images reports every page
+    auto pages = renderedPages.find(filePath);
+    if (pages != renderedPages.end() && status == Converter::ConversionStatus::Success) {
+        pages.value()++;
+        outputs = pages.value() == 1 ? 1 : 0;
+    }
+    
+    switch (status) {
+        case Converter::ConversionStatus::Success:
+            if (remaining != remainingOutputs.end() && remaining.value() > 0) {
+                int total = rowOutputs.value(filePath);
+                fileListTable->item(row, 3)->setText(QString("✓ %1 of %2").arg(total - remaining.value()).arg(total));
+            } else if (pages != renderedPages.end() && pages.value() > 1) {
+                fileListTable->item(row, 3)->setText(QString("✓ %1 pages").arg(pages.value()));
+            } else {
                 fileListTable->item(row, 3)->setText("✓ Success");
-                if (!outputPath.isEmpty()) {
-                    lastOutputPath = QFileInfo(outputPath).absolutePath();
-                }
-                break;
-            case Converter::ConversionStatus::Failed:
-                fileListTable->item(row, 3)->setText("✗ Failed");
-                break;
-            case Converter::ConversionStatus::Unsupported:
-                fileListTable->item(row, 3)->setText("⚠ Unsupported");
-                break;
-            case Converter::ConversionStatus::Cancelled:
-                fileListTable->item(row, 3)->setText("⊘ Cancelled");
-                break;
-        }
+            }
+            if (rowBackends.contains(filePath)) {
+                fileListTable->item(row, 3)->setToolTip("Converted by " + rowBackends.value(filePath));
+            }
+            publishedFiles++;
+            if (!outputPath.isEmpty()) {
+                lastOutputPath = QFileInfo(outputPath).absolutePath();
+            }
+            break;
+        case Converter::ConversionStatus::Failed:
+            fileListTable->item(row, 3)->setText("✗ Failed");
+            break;
+        case Converter::ConversionStatus::Unsupported:
+            fileListTable->item(row, 3)->setText("⚠ Unsupported");
+            break;
+        case Converter::ConversionStatus::Cancelled:
+            fileListTable->item(row, 3)->setText("⊘ Cancelled");
+            break;
+        case Converter::ConversionStatus::UpToDate:
+            fileListTable->item(row, 3)->setText("↻ Up to date");
+            break;
     }
 
-    processedFiles++;
+    processedFiles += outputs;
     progressBar->setValue(processedFiles);
     
     // Update progress with time estimate
     qint64 elapsed = elapsedTimer.elapsed();
     if (processedFiles > 0) {
-        qint64 avgTimePerFile = elapsed / processedFiles;
-        qint64 remainingFiles = totalFiles - processedFiles;
-        qint64 estimatedRemaining = avgTimePerFile * remainingFiles;
+        qint64 estimatedRemaining = converter->remainingMs();
         
-        statusLabel->setText(QString("Converting: %1/%2 files").arg(processedFiles).arg(totalFiles));
+        statusLabel->setText(QString("Converted: %1/%2 | Published: %3")
+                            .arg(convertedFiles).arg(totalFiles).arg(publishedFiles));
         timeLabel->setText(QString("Elapsed: %1 | Remaining: ~%2")
                           .arg(formatElapsedTime(elapsed))
                           .arg(formatRemainingTime(estimatedRemaining)));
     }
+    scheduleFeed();
 }
 
 void MainWindow::onCancelClicked()
 {
+    pendingOutputs.clear();
+    nextRow = 0;
     converter->cancelAll();
     progressTimer->stop();
     
@@ -378,11 +671,17 @@ void MainWindow::onCancelClicked()
     clearButton->setEnabled(true);
     removeButton->setEnabled(true);
     formatSelector->setEnabled(true);
+    extraOutputsButton->setEnabled(true);
     browseOutputButton->setEnabled(true);
 }
 
 void MainWindow::onAllConversionsFinished()
 {
+    // The converter ran dry before the rows did
+    feedRows();
+    if (converter->isConverting()) {
+        return;
+    }
     progressTimer->stop();
     qint64 totalTime = elapsedTimer.elapsed();
     
@@ -397,6 +696,7 @@ void MainWindow::onAllConversionsFinished()
     clearButton->setEnabled(true);
     removeButton->setEnabled(true);
     formatSelector->setEnabled(true);
+    extraOutputsButton->setEnabled(true);
     browseOutputButton->setEnabled(true);
     
     // Ask user if they want to open the output folder
@@ -422,6 +722,7 @@ void MainWindow::onConversionError(const QString &filePath, const QString &error
     }
 
     statusBar()->showMessage(QString("Error: %1").arg(errorMessage));
+    scheduleFeed();
 }
 
 void MainWindow::onFormatChanged(int index)
@@ -445,6 +746,7 @@ void MainWindow::updateConvertButtonState()
     // Check if at least one file can be converted to the target format
     bool hasConvertibleFiles = false;
     int convertibleCount = 0;
+    QList<qint64> estimates;
     
     for (int i = 0; i < fileListTable->rowCount(); ++i) {
         QString filePath = fileListTable->item(i, 1)->text();
@@ -453,6 +755,11 @@ void MainWindow::updateConvertButtonState()
         if (canConvertToFormat(sourceFormat, targetFormat)) {
             hasConvertibleFiles = true;
             convertibleCount++;
+            // Archives have no estimate of their own
+            qint64 estimate = converter->estimateMs(filePath, outputsFor(filePath, targetFormat));
+            if (estimate >= 0) {
+                estimates << estimate;
+            }
         }
     }
     
@@ -461,9 +768,10 @@ void MainWindow::updateConvertButtonState()
     if (!hasConvertibleFiles) {
         convertButton->setToolTip("No files can be converted to the selected format");
     } else {
-        convertButton->setToolTip(QString("%1 file(s) can be converted to %2")
+        convertButton->setToolTip(QString("%1 file(s) can be converted to %2, in about %3")
                                  .arg(convertibleCount)
-                                 .arg(Converter::formatToString(targetFormat)));
+                                 .arg(Converter::formatToString(targetFormat))
+                                 .arg(formatRemainingTime(converter->planMs(estimates))));
     }
 }
 
@@ -473,31 +781,12 @@ bool MainWindow::canConvertToFormat(Converter::FileFormat sourceFormat, Converte
         return false; // Same format, no conversion needed
     }
     
-    // Document conversions: DOCX/PPTX <-> PDF
-    if ((sourceFormat == Converter::FileFormat::DOCX || sourceFormat == Converter::FileFormat::PPTX) &&
-        targetFormat == Converter::FileFormat::PDF) {
-        return true;
-    }
-    if (sourceFormat == Converter::FileFormat::PDF &&
-        (targetFormat == Converter::FileFormat::DOCX || targetFormat == Converter::FileFormat::PPTX)) {
-        return true;
-    }
-    
-    // Image conversions: JPG/PNG/WEBP/HEIC -> JPG/PNG/WEBP
-    // Note: HEIC can be SOURCE but not TARGET (convert FROM heic, not TO heic)
-    bool sourceIsImage = (sourceFormat == Converter::FileFormat::JPG ||
-                         sourceFormat == Converter::FileFormat::PNG ||
-                         sourceFormat == Converter::FileFormat::WEBP ||
-                         sourceFormat == Converter::FileFormat::HEIC);
-    bool targetIsImage = (targetFormat == Converter::FileFormat::JPG ||
-                         targetFormat == Converter::FileFormat::PNG ||
-                         targetFormat == Converter::FileFormat::WEBP);
-    
-    if (sourceIsImage && targetIsImage) {
+    // Entries that cannot be converted are left out of the output archive
+    if (sourceFormat == Converter::FileFormat::ZIP) {
         return true;
     }
     
-    return false;
+    return Converter::canConvert(sourceFormat, targetFormat);
 }
 
 QString MainWindow::formatElapsedTime(qint64 ms)
@@ -534,14 +823,13 @@ QString MainWindow::formatRemainingTime(qint64 ms)
 
 void MainWindow::updateProgressTimer()
 {
-    if (!elapsedTimer.isValid() || processedFiles == 0) {
+    if (!elapsedTimer.isValid()) {
         return;
     }
     
+    // From per-format run times and the slots, not the average so far
     qint64 elapsed = elapsedTimer.elapsed();
-    qint64 avgTimePerFile = elapsed / processedFiles;
-    qint64 remainingFiles = totalFiles - processedFiles;
-    qint64 estimatedRemaining = avgTimePerFile * remainingFiles;
+    qint64 estimatedRemaining = converter->remainingMs();
     
     timeLabel->setText(QString("Elapsed: %1 | Remaining: ~%2")
                       .arg(formatElapsedTime(elapsed))
@@ -600,8 +888,11 @@ void MainWindow::setupMenuBar()
             "<p>Offline file converter for documents and images.</p>"
             "<p><b>Supported conversions:</b></p>"
             "<ul>"
-            "<li>DOCX/PPTX ↔ PDF (requires LibreOffice)</li>"
+            "<li>DOCX/PPTX ↔ PDF, DOCX/PPTX → PDF/A (requires LibreOffice)</li>"
             "<li>JPG, PNG, WEBP, HEIC (requires ImageMagick)</li>"
+            "<li>PDF → JPG, PNG, WEBP, one image per page (requires Poppler)</li>"
+            "<li>JPG, PNG, WEBP → PDF (built in)</li>"
+            "<li>XLSX ↔ CSV, first sheet (built in)</li>"
             "</ul>"
             "<p>Version 1.0</p>");
     });
@@ -5,6 +5,7 @@
 #include <QTableWidget>
 #include <QPushButton>
 #include <QComboBox>
+#include <QToolButton>
 #include <QProgressBar>
 #include <QLabel>
 #include <QElapsedTimer>
@@ -34,11 +35,16 @@ private slots:
     void onConvertClicked();
     void onCancelClicked();
     void onConversionStarted(const QString &filePath);
+    void onConversionRouted(const QString &filePath, const QString &backend, int attempt);
+    void onConversionStaged(const QString &filePath);
     void onConversionFinished(const QString &filePath, Converter::ConversionStatus status, const QString &outputPath);
     void onConversionError(const QString &filePath, const QString &errorMessage);
     void onAllConversionsFinished();
+    void feedRows();
     void onFormatChanged(int index);
+    void onExtraSizesClicked();
     void updateProgressTimer();
+    void checkForInterruptedBatch();
     
     // Integration menu slots
     void onInstallContextMenu();
@@ -53,6 +59,9 @@ private:
     void addFilesToList(const QStringList &filePaths);
     int findFileRow(const QString &filePath);
     void updateConvertButtonState();
+    void beginBatch(int fileCount);
+    void scheduleFeed();
+    QList<Converter::OutputSpec> outputsFor(const QString &filePath, Converter::FileFormat targetFormat);
     bool canConvertToFormat(Converter::FileFormat sourceFormat, Converter::FileFormat targetFormat);
     QString formatElapsedTime(qint64 ms);
     QString formatRemainingTime(qint64 ms);
@@ -61,6 +70,9 @@ private:
     Dropzone *dropzone;
     QTableWidget *fileListTable;
     QComboBox *formatSelector;
+    QToolButton *extraOutputsButton;
+    QList<QAction *> extraFormatActions;
+    QList<Converter::ResizeOptions> extraSizes;
     QPushButton *addFilesButton;
     QPushButton *convertButton;
     QPushButton *cancelButton;
@@ -76,8 +88,19 @@ private:
     Converter *converter;
     int totalFiles;
     int processedFiles;
+    int convertedFiles;
+    int publishedFiles;
+    QMap<QString, int> rowOutputs;          // Images with several outputs
+    QMap<QString, int> remainingOutputs;
+    QMap<QString, int> renderedPages;       // PDFs rendered to images: pages published
+    QSet<QString> stagedPageRows;           // ...and those counted as converted
+    QMap<QString, QString> rowBackends;     // Backend each row was last handed to
+    QList<QList<Converter::OutputSpec>> pendingOutputs;  // Per row, handed over as the converter has room
+    int nextRow;
+    bool feedScheduled;
     QString outputDirectory;
     QString lastOutputPath;
+    QString journalPath;
     
     // Progress timing
     QElapsedTimer elapsedTimer;
@@ -0,0 +1,105 @@
+#include "ManifestReader.h"
+#include <QFileInfo>
+#include <cstring>
+
+namespace {
+// A NUL this early means a NUL-separated manifest
+constexpr qint64 SniffSize = 64 * 1024;
+constexpr qint64 ChunkSize = 256 * 1024;
+}
+
+ManifestReader::ManifestReader(const QString &path)
+    : file(path), baseDirectory(QFileInfo(path).absoluteDir()), data(nullptr), length(0), offset(0),
+      pendingOffset(0), separator('\n'), line(0), finished(false)
+{
+}
+
+bool ManifestReader::open(QString *errorMessage)
+{
+    if (!file.open(QIODevice::ReadOnly)) {
+        *errorMessage = "Cannot open manifest: " + file.errorString();
+        return false;
+    }
+    length = file.isSequential() ? 0 : file.size();
+    if (length > 0) {
+        data = reinterpret_cast<const char *>(file.map(0, length));
+    }
+    if (data) {
+        if (std::memchr(data, '\0', qMin(length, SniffSize))) {
+            separator = '\0';
+        }
+    } else if (file.peek(SniffSize).contains('\0')) {
+        separator = '\0';
+    }
+    return true;
+}
+
+bool ManifestReader::atEnd() const
+{
+    return finished;
+}
+
+bool ManifestReader::next(Entry *entry)
+{
+    QByteArray record;
+    while (nextRecord(&record)) {
+        line++;
+        if (separator == '\n') {
+            if (record.endsWith('\r')) {
+                record.chop(1);
+            }
+            if (record.startsWith('#')) {
+                continue;
+            }
+        }
+        if (record.trimmed().isEmpty()) {
+            continue;
+        }
+
+        QString text = QString::fromUtf8(record);
+        qsizetype tab = text.lastIndexOf('\t');
+        entry->target = tab == -1 ? QString() : text.mid(tab + 1).trimmed();
+        entry->path = QDir::cleanPath(baseDirectory.absoluteFilePath(tab == -1 ? text : text.left(tab)));
+        entry->line = line;
+        return true;
+    }
+    finished = true;
+    return false;
+}
+
+bool ManifestReader::nextRecord(QByteArray *record)
+{
+    if (data) {
+        if (offset >= length) {
+            return false;
+        }
+        const char *start = data + offset;
+        const char *end = static_cast<const char *>(std::memchr(start, separator, length - offset));
+        qint64 recordLength = end ? end - start : length - offset;
+        *record = QByteArray(start, recordLength);
+        offset += recordLength + (end ? 1 : 0);
+        return true;
+    }
+
+    for (;;) {
+        qsizetype end = pending.indexOf(separator, pendingOffset);
+        if (end != -1) {
+            *record = pending.mid(pendingOffset, end - pendingOffset);
+            pendingOffset = end + 1;
+            return true;
+        }
+        // Keep only the unsplit tail before reading on
+        pending.remove(0, pendingOffset);
+        pendingOffset = 0;
+        QByteArray chunk = file.read(ChunkSize);
+        if (chunk.isEmpty()) {
+            if (pending.isEmpty()) {
+                return false;
+            }
+            *record = pending;
+            pending.clear();
+            return true;
+        }
+        pending += chunk;
+    }
+}
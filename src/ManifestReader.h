@@ -0,0 +1,47 @@
+#ifndef MANIFESTREADER_H
+#define MANIFESTREADER_H
+
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QString>
+
+// Reads a batch manifest one entry at a time, so a list of millions of paths
+// is never held in memory. Entries are separated by newlines, or by NULs
+// when the file has one near its start (find -print0). An entry may name its
+// own target after a tab: "scans/page1.png<TAB>pdf" or "photo.heic<TAB>webp@800".
+// Blank lines and, in newline manifests, lines starting with '#' are skipped.
+// Relative paths are taken from the manifest's directory. The file is mapped
+// where possible and read in chunks otherwise (a pipe).
+class ManifestReader
+{
+public:
+    struct Entry {
+        QString path;       // Absolute
+        QString target;     // Empty = the batch's target
+        int line;
+    };
+
+    explicit ManifestReader(const QString &path);
+
+    bool open(QString *errorMessage);
+    // False at the end of the manifest
+    bool next(Entry *entry);
+    bool atEnd() const;
+
+private:
+    bool nextRecord(QByteArray *record);
+
+    QFile file;
+    QDir baseDirectory;
+    const char *data;       // Mapped manifest, or null when read in chunks
+    qint64 length;
+    qint64 offset;
+    QByteArray pending;     // Read but not yet split (chunked reads)
+    qsizetype pendingOffset;
+    char separator;
+    int line;
+    bool finished;
+};
+
+#endif // MANIFESTREADER_H
@@ -0,0 +1,122 @@
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#include <atomic>
+#include <utility>
+
+// Unbounded multi-producer, single-consumer FIFO (Vyukov's intrusive queue).
+// Producers on any thread append with one atomic exchange, a whole batch
+// included, and never wait for each other or for the consumer. Only the
+// consumer's thread may pop.
+//
+// push() also tells the producer whether the consumer has to be woken:
+// exactly one producer gets true after each rearm(). The consumer calls
+// rearm() before draining, so a job appended while it drains wakes it once
+// more instead of being left behind.
+template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue()
+        : head(&stub), tail(&stub), armed(true)
+    {
+        stub.next.store(nullptr, std::memory_order_relaxed);
+    }
+
+    ~MpscQueue()
+    {
+        T value;
+        while (pop(&value)) {
+        }
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    bool push(T value)
+    {
+        Node *node = new Node(std::move(value));
+        append(node, node);
+        return armed.exchange(false, std::memory_order_acq_rel);
+    }
+
+    // Appends [first, last) in order, as one step; false for an empty range
+    template <typename Iterator>
+    bool pushBatch(Iterator first, Iterator last)
+    {
+        if (first == last) {
+            return false;
+        }
+        Node *batchHead = new Node(*first);
+        Node *batchTail = batchHead;
+        for (++first; first != last; ++first) {
+            Node *node = new Node(*first);
+            batchTail->next.store(node, std::memory_order_relaxed);
+            batchTail = node;
+        }
+        append(batchHead, batchTail);
+        return armed.exchange(false, std::memory_order_acq_rel);
+    }
+
+    // False when empty, or when the next job's producer is between its two
+    // steps; that producer then finds the queue armed and wakes the consumer
+    bool pop(T *value)
+    {
+        Node *first = tail;
+        Node *next = first->next.load(std::memory_order_acquire);
+        if (first == &stub) {
+            if (!next) {
+                return false;
+            }
+            tail = next;
+            first = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next) {
+            tail = next;
+            *value = std::move(first->value);
+            delete first;
+            return true;
+        }
+        if (first != head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        // Last node: put the stub behind it so it can be taken
+        append(&stub, &stub);
+        next = first->next.load(std::memory_order_acquire);
+        if (next) {
+            tail = next;
+            *value = std::move(first->value);
+            delete first;
+            return true;
+        }
+        return false;
+    }
+
+    void rearm()
+    {
+        armed.exchange(true, std::memory_order_acq_rel);
+    }
+
+private:
+    struct Node {
+        Node() = default;
+        explicit Node(T v) : next(nullptr), value(std::move(v)) {}
+        std::atomic<Node *> next;
+        T value;
+    };
+
+    void append(Node *first, Node *last)
+    {
+        last->next.store(nullptr, std::memory_order_relaxed);
+        Node *previous = head.exchange(last, std::memory_order_acq_rel);
+        previous->next.store(first, std::memory_order_release);
+    }
+
+    std::atomic<Node *> head;   // Producers: the newest node
+    Node *tail;                 // Consumer: the oldest node
+    std::atomic<bool> armed;
+    Node stub;
+};
+
+#endif // MPSCQUEUE_H
@@ -0,0 +1,130 @@
+#include "OutputPublisher.h"
+#include "OutputStaging.h"
+#include "TraceRecorder.h"
+#include <QFile>
+#include <QFileInfo>
+
+namespace {
+// Large sequential writes keep SMB/NFS round trips to a minimum
+constexpr qint64 CopyChunkSize = 8 * 1024 * 1024;
+}
+
+OutputPublisher::OutputPublisher(QObject *parent)
+    : QObject(parent), trace(nullptr), pending(0)
+{
+    pool.setMaxThreadCount(2);
+}
+
+OutputPublisher::~OutputPublisher()
+{
+    pool.waitForDone();
+}
+
+void OutputPublisher::setMaxThreads(int count)
+{
+    pool.setMaxThreadCount(qMax(1, count));
+}
+
+void OutputPublisher::setTraceRecorder(TraceRecorder *recorder)
+{
+    trace = recorder;
+}
+
+int OutputPublisher::pendingCount() const
+{
+    return pending;
+}
+
+void OutputPublisher::publish(const QString &inputPath, const QString &stagedPath,
+                              const QString &stagingDirectory, const QString &outputDirectory,
+                              bool replaceExisting)
+{
+    pending++;
+    TraceRecorder *recorder = trace;
+    pool.start([this, recorder, inputPath, stagedPath, stagingDirectory, outputDirectory, replaceExisting]() {
+        qint64 startUs = recorder ? recorder->nowUs() : 0;
+        QString errorMessage;
+        QString finalPath = copyAndPublish(stagedPath, outputDirectory, replaceExisting, &errorMessage);
+        OutputStaging::removeStagingDirectory(stagingDirectory);
+        if (recorder) {
+            recorder->span("publish", "write-behind", TraceRecorder::CurrentThread, startUs, recorder->nowUs(),
+                           QFileInfo(stagedPath).fileName());
+        }
+
+        // Report back on the thread that owns the publisher
+        QMetaObject::invokeMethod(this, [this, inputPath, finalPath, errorMessage]() {
+            pending--;
+            if (finalPath.isEmpty()) {
+                emit publishFailed(inputPath, errorMessage);
+            } else {
+                emit published(inputPath, finalPath);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+QString OutputPublisher::copyAndPublish(const QString &stagedPath, const QString &outputDirectory,
+                                        bool replaceExisting, QString *errorMessage)
+{
+    // Copy into a staging directory on the destination volume first, so the
+    // final step is still an atomic rename
+    QString remoteStaging = OutputStaging::createStagingDirectory(outputDirectory);
+    if (remoteStaging.isEmpty()) {
+        *errorMessage = "Could not create staging directory in " + outputDirectory;
+        return QString();
+    }
+
+    QFileInfo stagedInfo(stagedPath);
+    QString remotePath = remoteStaging + "/" + stagedInfo.fileName();
+
+    QFile in(stagedPath);
+    QFile out(remotePath);
+    if (!in.open(QIODevice::ReadOnly)) {
+        *errorMessage = "Could not read staged output: " + in.errorString();
+        OutputStaging::removeStagingDirectory(remoteStaging);
+        return QString();
+    }
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Unbuffered)) {
+        *errorMessage = "Could not write output: " + out.errorString();
+        OutputStaging::removeStagingDirectory(remoteStaging);
+        return QString();
+    }
+
+    QByteArray buffer(qMin(CopyChunkSize, qMax<qint64>(1, in.size())), Qt::Uninitialized);
+    bool ok = true;
+    while (true) {
+        qint64 n = in.read(buffer.data(), buffer.size());
+        if (n < 0) {
+            *errorMessage = "Could not read staged output: " + in.errorString();
+            ok = false;
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+        if (out.write(buffer.constData(), n) != n) {
+            *errorMessage = "Could not write output: " + out.errorString();
+            ok = false;
+            break;
+        }
+    }
+    in.close();
+    out.close();
+    if (ok && out.error() != QFileDevice::NoError) {
+        *errorMessage = "Could not write output: " + out.errorString();
+        ok = false;
+    }
+
+    QString finalPath;
+    if (ok && replaceExisting) {
+        finalPath = OutputStaging::replace(remotePath, outputDirectory,
+                                           stagedInfo.completeBaseName(), stagedInfo.suffix(),
+                                           errorMessage);
+    } else if (ok) {
+        finalPath = OutputStaging::publish(remotePath, outputDirectory,
+                                           stagedInfo.completeBaseName(), stagedInfo.suffix(),
+                                           errorMessage);
+    }
+    OutputStaging::removeStagingDirectory(remoteStaging);
+    return finalPath;
+}
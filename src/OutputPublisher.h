@@ -0,0 +1,42 @@
+#ifndef OUTPUTPUBLISHER_H
+#define OUTPUTPUBLISHER_H
+
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+
+class TraceRecorder;
+
+// Write-behind stage: moves finished outputs from local scratch to a slow
+// destination on a small pool of copier threads, so conversion slots are not
+// held for the duration of a network write.
+class OutputPublisher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit OutputPublisher(QObject *parent = nullptr);
+    ~OutputPublisher();
+
+    void setMaxThreads(int count);
+    // Copies are recorded as spans on their thread's lane
+    void setTraceRecorder(TraceRecorder *recorder);
+    void publish(const QString &inputPath, const QString &stagedPath,
+                 const QString &stagingDirectory, const QString &outputDirectory,
+                 bool replaceExisting);
+    int pendingCount() const;
+
+signals:
+    void published(const QString &inputPath, const QString &outputPath);
+    void publishFailed(const QString &inputPath, const QString &errorMessage);
+
+private:
+    static QString copyAndPublish(const QString &stagedPath, const QString &outputDirectory,
+                                  bool replaceExisting, QString *errorMessage);
+
+    QThreadPool pool;
+    TraceRecorder *trace;
+    int pending;
+};
+
+#endif // OUTPUTPUBLISHER_H
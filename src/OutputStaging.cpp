@@ -0,0 +1,137 @@
+#include "OutputStaging.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QUuid>
+#include <QStandardPaths>
+#include <QStorageInfo>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <cstdio>
+#endif
+
+QString OutputStaging::stagingRootName()
+{
+    return ".fileconverter-staging";
+}
+
+QString OutputStaging::createStagingDirectory(const QString &parentDirectory)
+{
+    QString path = parentDirectory + "/" + stagingRootName() + "/"
+                   + QUuid::createUuid().toString(QUuid::WithoutBraces);
+    if (!QDir().mkpath(path)) {
+        return QString();
+    }
+    return path;
+}
+
+void OutputStaging::removeStagingDirectory(const QString &stagingDirectory)
+{
+    if (stagingDirectory.isEmpty()) {
+        return;
+    }
+    QDir(stagingDirectory).removeRecursively();
+}
+
+void OutputStaging::removeStagingRoot(const QString &parentDirectory)
+{
+    // rmdir leaves a root that still holds a job's directory alone
+    QDir().rmdir(parentDirectory + "/" + stagingRootName());
+}
+
+QString OutputStaging::findStagedFile(const QString &stagingDirectory, const QString &expectedPath)
+{
+    QFileInfo expected(expectedPath);
+    if (expected.exists() && expected.size() > 0) {
+        return expectedPath;
+    }
+
+    // The directory is private to one job, so any non-empty file with the
+    // right extension is the tool's output (LibreOffice picks its own name)
+    QDir dir(stagingDirectory);
+    const QFileInfoList entries = dir.entryInfoList(QDir::Files);
+    for (const QFileInfo &entry : entries) {
+        if (entry.suffix().compare(expected.suffix(), Qt::CaseInsensitive) == 0 && entry.size() > 0) {
+            return entry.absoluteFilePath();
+        }
+    }
+    return QString();
+}
+
+QString OutputStaging::publish(const QString &stagedPath, const QString &outputDirectory,
+                               const QString &baseName, const QString &extension,
+                               QString *errorMessage)
+{
+    for (int n = 0; n < 10000; ++n) {
+        QString name = n == 0 ? QString("%1.%2").arg(baseName, extension)
+                              : QString("%1 (%2).%3").arg(baseName).arg(n).arg(extension);
+        QString target = outputDirectory + "/" + name;
+        if (QFileInfo::exists(target)) {
+            continue;
+        }
+        // QFile::rename never replaces an existing file, so a name taken by a
+        // concurrent job makes it fail and we move on to the next candidate
+        if (QFile::rename(stagedPath, target)) {
+            return target;
+        }
+        if (!QFileInfo::exists(target)) {
+            if (errorMessage) {
+                *errorMessage = QString("Could not move output to %1").arg(target);
+            }
+            return QString();
+        }
+    }
+    if (errorMessage) {
+        *errorMessage = "Could not find a free output file name";
+    }
+    return QString();
+}
+
+QString OutputStaging::replace(const QString &stagedPath, const QString &outputDirectory,
+                               const QString &baseName, const QString &extension,
+                               QString *errorMessage)
+{
+    QString target = outputDirectory + "/" + baseName + "." + extension;
+#ifdef Q_OS_WIN
+    bool ok = MoveFileExW(reinterpret_cast<LPCWSTR>(QDir::toNativeSeparators(stagedPath).utf16()),
+                          reinterpret_cast<LPCWSTR>(QDir::toNativeSeparators(target).utf16()),
+                          MOVEFILE_REPLACE_EXISTING);
+#else
+    bool ok = ::rename(QFile::encodeName(stagedPath).constData(),
+                       QFile::encodeName(target).constData()) == 0;
+#endif
+    if (!ok) {
+        if (errorMessage) {
+            *errorMessage = QString("Could not move output to %1").arg(target);
+        }
+        return QString();
+    }
+    return target;
+}
+
+QString OutputStaging::scratchDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::TempLocation) + "/FileConverter";
+}
+
+bool OutputStaging::isNetworkPath(const QString &path)
+{
+    QString absolute = QFileInfo(path).absoluteFilePath();
+#ifdef Q_OS_WIN
+    if (absolute.startsWith("//") || absolute.startsWith("\\\\")) {
+        return true; // UNC path
+    }
+    QString root = QDir::toNativeSeparators(QStorageInfo(absolute).rootPath());
+    if (root.isEmpty()) {
+        return false;
+    }
+    return GetDriveTypeW(reinterpret_cast<LPCWSTR>(root.utf16())) == DRIVE_REMOTE;
+#else
+    static const QList<QByteArray> networkTypes = {
+        "nfs", "nfs4", "cifs", "smbfs", "smb3", "fuse.sshfs", "afs", "9p", "ceph", "fuse.glusterfs"
+    };
+    return networkTypes.contains(QStorageInfo(absolute).fileSystemType());
+#endif
+}
@@ -0,0 +1,42 @@
+#ifndef OUTPUTSTAGING_H
+#define OUTPUTSTAGING_H
+
+#include <QString>
+
+// Private per-job staging directories and atomic, collision-aware publishing.
+// Staging lives on the same filesystem as the output so publishing is a rename.
+class OutputStaging
+{
+public:
+    // Creates <parent>/.fileconverter-staging/<unique>; returns empty on failure
+    static QString createStagingDirectory(const QString &parentDirectory);
+    // Leaves the shared root in place: other threads may be creating
+    // directories in it
+    static void removeStagingDirectory(const QString &stagingDirectory);
+    // Removes <parent>/.fileconverter-staging if it is empty. Only when no
+    // staging directory can be created under it meanwhile (a batch is done).
+    static void removeStagingRoot(const QString &parentDirectory);
+
+    // Locates the file a tool produced in a staging directory
+    static QString findStagedFile(const QString &stagingDirectory, const QString &expectedPath);
+
+    // Moves stagedPath to <outputDirectory>/<baseName>.<extension>, appending
+    // " (n)" instead of overwriting an existing file. Returns the final path.
+    static QString publish(const QString &stagedPath, const QString &outputDirectory,
+                           const QString &baseName, const QString &extension,
+                           QString *errorMessage);
+
+    // Atomically moves stagedPath over <outputDirectory>/<baseName>.<extension>,
+    // replacing an older output (make-style incremental runs)
+    static QString replace(const QString &stagedPath, const QString &outputDirectory,
+                           const QString &baseName, const QString &extension,
+                           QString *errorMessage);
+
+    static QString stagingRootName();
+
+    // Local scratch area used when the output directory is slow to write to
+    static QString scratchDirectory();
+    static bool isNetworkPath(const QString &path);
+};
+
+#endif // OUTPUTSTAGING_H
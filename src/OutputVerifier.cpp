@@ -0,0 +1,105 @@
+#include "OutputVerifier.h"
+#include <QFile>
+#include <QtEndian>
+
+namespace {
+// PDF readers look for %%EOF this far from the end
+constexpr qint64 PdfTailSize = 1024;
+// End of central directory record plus the longest comment
+constexpr qint64 ZipTailSize = 22 + 0xFFFF;
+constexpr char ZipEndSignature[] = "PK\x05\x06";
+
+// Bytes at offset, mapped rather than read where the file system allows;
+// valid while the file is open
+QByteArray region(QFile &file, qint64 offset, qint64 size)
+{
+    if (uchar *data = file.map(offset, size)) {
+        return QByteArray::fromRawData(reinterpret_cast<const char *>(data), size);
+    }
+    file.seek(offset);
+    return file.read(size);
+}
+
+QString verifyZip(const QByteArray &tail, qint64 tailOffset)
+{
+    qsizetype end = tail.lastIndexOf(ZipEndSignature);
+    if (end < 0 || end + 22 > tail.size()) {
+        return "Package is truncated (no ZIP central directory)";
+    }
+    // The directory must end where the end record starts (ZIP64 values are
+    // not followed up)
+    quint32 size = qFromLittleEndian<quint32>(tail.constData() + end + 12);
+    quint32 offset = qFromLittleEndian<quint32>(tail.constData() + end + 16);
+    if (size != 0xFFFFFFFF && offset != 0xFFFFFFFF
+        && static_cast<qint64>(offset) + size > tailOffset + end) {
+        return "Package is damaged (central directory out of range)";
+    }
+    return QString();
+}
+}
+
+QString OutputVerifier::verify(const QString &path, Converter::FileFormat format)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return "Cannot open output: " + file.errorString();
+    }
+    qint64 size = file.size();
+    if (size == 0) {
+        // An empty sheet is an empty CSV
+        return format == Converter::FileFormat::CSV ? QString() : QString("Output is empty");
+    }
+    QByteArray head = region(file, 0, qMin<qint64>(size, 16));
+    auto tail = [&file, size](qint64 length) {
+        length = qMin(size, length);
+        return region(file, size - length, length);
+    };
+
+    switch (format) {
+        case Converter::FileFormat::PDF:
+        case Converter::FileFormat::PDFA: {
+            if (!head.startsWith("%PDF-")) {
+                return "PDF has no header";
+            }
+            QByteArray end = tail(PdfTailSize);
+            if (!end.contains("startxref") || !end.contains("%%EOF")) {
+                return "PDF is truncated (no trailer)";
+            }
+            return QString();
+        }
+        case Converter::FileFormat::PNG:
+            if (!head.startsWith("\x89PNG\r\n\x1A\n")) {
+                return "PNG has no signature";
+            }
+            // Zero length, "IEND" and its CRC
+            if (tail(12) != QByteArray("\0\0\0\0IEND\xAE\x42\x60\x82", 12)) {
+                return "PNG is truncated (no IEND)";
+            }
+            return QString();
+        case Converter::FileFormat::JPG:
+            if (!head.startsWith("\xFF\xD8\xFF")) {
+                return "JPEG has no SOI marker";
+            }
+            if (tail(2) != "\xFF\xD9") {
+                return "JPEG is truncated (no EOI marker)";
+            }
+            return QString();
+        case Converter::FileFormat::WEBP:
+            if (size < 12 || !head.startsWith("RIFF") || head.mid(8, 4) != "WEBP") {
+                return "WebP has no RIFF header";
+            }
+            if (qFromLittleEndian<quint32>(head.constData() + 4) + 8LL != size) {
+                return "WebP is truncated (RIFF length does not match)";
+            }
+            return QString();
+        case Converter::FileFormat::DOCX:
+        case Converter::FileFormat::PPTX:
+        case Converter::FileFormat::XLSX:
+            if (!head.startsWith("PK\x03\x04")) {
+                return "Package has no ZIP header";
+            }
+            return verifyZip(tail(ZipTailSize), size - qMin(size, ZipTailSize));
+        default:
+            return QString();
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef OUTPUTVERIFIER_H
+#define OUTPUTVERIFIER_H
+
+#include <QString>
+#include "Converter.h"
+
+// Structural check of a finished output, so a file cut short by a killed or
+// crashing tool is not published as a success. Only the few bytes at either
+// end that a complete file must have are mapped and looked at: the PDF
+// trailer, PNG IEND, JPEG EOI, the WebP RIFF length and the ZIP end of
+// central directory of OOXML packages.
+class OutputVerifier
+{
+public:
+    // Why the file is not a complete output of the format, or an empty string
+    static QString verify(const QString &path, Converter::FileFormat format);
+};
+
+#endif // OUTPUTVERIFIER_H
@@ -0,0 +1,51 @@
+#include "PdfAssembler.h"
+#include "PdfWriter.h"
+#include <QFile>
+#include <QThread>
+
+PdfAssembler::PdfAssembler(QObject *parent)
+    : QObject(parent)
+{
+    // Each job is I/O bound; the converter's slots limit how many run
+    pool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+PdfAssembler::~PdfAssembler()
+{
+    pool.waitForDone();
+}
+
+void PdfAssembler::assemble(const QString &jobId, const QStringList &imagePaths, const QString &outputPath)
+{
+    pool.start([this, jobId, imagePaths, outputPath]() {
+        QString errorMessage = write(imagePaths, outputPath);
+
+        // Report back on the thread that owns the assembler
+        QMetaObject::invokeMethod(this, [this, jobId, errorMessage]() {
+            emit assembled(jobId, errorMessage);
+        }, Qt::QueuedConnection);
+    });
+}
+
+QString PdfAssembler::write(const QStringList &imagePaths, const QString &outputPath)
+{
+    QFile file(outputPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return "Cannot create output: " + file.errorString();
+    }
+
+    PdfWriter writer(&file);
+    QString errorMessage;
+    for (const QString &imagePath : imagePaths) {
+        if (!writer.addPage(imagePath, &errorMessage)) {
+            return errorMessage;
+        }
+    }
+    if (!writer.finish(&errorMessage)) {
+        return errorMessage;
+    }
+    if (!file.flush()) {
+        return "Cannot write output: " + file.errorString();
+    }
+    return QString();
+}
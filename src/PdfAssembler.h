@@ -0,0 +1,33 @@
+#ifndef PDFASSEMBLER_H
+#define PDFASSEMBLER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+
+// Writes images as the pages of one PDF on a worker thread, with PdfWriter:
+// JPEG data is embedded without decoding and pages are written as they are
+// read, so the size of the set does not matter.
+class PdfAssembler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PdfAssembler(QObject *parent = nullptr);
+    ~PdfAssembler();
+
+    // jobId identifies the job in assembled(); pages follow imagePaths
+    void assemble(const QString &jobId, const QStringList &imagePaths, const QString &outputPath);
+
+signals:
+    // Empty errorMessage on success
+    void assembled(const QString &jobId, const QString &errorMessage);
+
+private:
+    static QString write(const QStringList &imagePaths, const QString &outputPath);
+
+    QThreadPool pool;
+};
+
+#endif // PDFASSEMBLER_H
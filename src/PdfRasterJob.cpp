@@ -0,0 +1,296 @@
+#include "PdfRasterJob.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageWriter>
+#include <algorithm>
+
+namespace {
+// Matches ImageMagick's default, which the other image paths use
+constexpr int JpegQuality = 92;
+// Runs per process: enough that progress moves steadily and a slow run at the
+// end does not leave the other processes idle for long
+constexpr int RunsPerProcess = 4;
+}
+
+PdfRasterJob::PdfRasterJob(const QString &pdftoppmPath, const QString &inputPath, Converter::FileFormat targetFormat,
+                           int dpi, const QString &pageRanges, const QString &outputDirectory,
+                           int processes, QObject *parent)
+    : QObject(parent), pdftoppmPath(pdftoppmPath), inputPath(inputPath), targetFormat(targetFormat),
+      dpi(dpi), pageRanges(pageRanges), outputDirectory(outputDirectory), processes(qMax(1, processes)),
+      info(nullptr), pageCount(0), pagesDone(0), encoding(0), done(false)
+{
+    // As many as the processes: the job's share of the machine
+    encoders.setMaxThreadCount(this->processes);
+}
+
+PdfRasterJob::~PdfRasterJob()
+{
+    // A re-encode still running reports to this; its queued call is dropped
+    // with the object
+    encoders.waitForDone();
+    killProcesses();
+}
+
+bool PdfRasterJob::isValidPageRanges(const QString &pageRanges)
+{
+    bool ok = false;
+    parsePageRanges(pageRanges, &ok);
+    return ok;
+}
+
+QList<PdfRasterJob::PageRun> PdfRasterJob::parsePageRanges(const QString &pageRanges, bool *ok)
+{
+    QList<PageRun> runs;
+    *ok = true;
+    if (pageRanges.trimmed().isEmpty()) {
+        runs << PageRun(1, -1);
+        return runs;
+    }
+
+    const QStringList parts = pageRanges.split(',');
+    for (const QString &part : parts) {
+        QString range = part.trimmed();
+        int dash = range.indexOf('-');
+        bool firstOk = false;
+        bool lastOk = true;
+        int first = range.left(dash == -1 ? range.size() : dash).toInt(&firstOk);
+        int last = first;
+        if (dash != -1) {
+            QString end = range.mid(dash + 1);
+            last = end.isEmpty() ? -1 : end.toInt(&lastOk);
+        }
+        if (!firstOk || !lastOk || first < 1 || (last != -1 && last < first)) {
+            *ok = false;
+            return QList<PageRun>();
+        }
+        runs << PageRun(first, last);
+    }
+    return runs;
+}
+
+void PdfRasterJob::start()
+{
+    bool ok = false;
+    parsePageRanges(pageRanges, &ok);
+    if (!ok) {
+        complete(false, "Invalid page range: " + pageRanges);
+        return;
+    }
+
+    // The page count decides how the pages are split between processes
+    QFileInfo renderer(pdftoppmPath);
+    QString pdfinfoPath = renderer.dir().filePath("pdfinfo" + QString(renderer.suffix().isEmpty() ? "" : ".")
+                                                  + renderer.suffix());
+    info = new QProcess(this);
+    connect(info, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, &PdfRasterJob::onInfoFinished);
+    connect(info, &QProcess::errorOccurred, this, &PdfRasterJob::onProcessError);
+    info->start(pdfinfoPath, QStringList() << inputPath);
+}
+
+void PdfRasterJob::abort()
+{
+    complete(false, "Cancelled");
+}
+
+void PdfRasterJob::killProcesses()
+{
+    if (info) {
+        info->disconnect(this);
+        info->kill();
+        info->waitForFinished(1000);
+        info->deleteLater();
+        info = nullptr;
+    }
+    for (auto it = running.begin(); it != running.end(); ++it) {
+        it.key()->disconnect(this);
+        it.key()->kill();
+        it.key()->waitForFinished(1000);
+        it.key()->deleteLater();
+    }
+    running.clear();
+    pendingRuns.clear();
+}
+
+void PdfRasterJob::onInfoFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    QByteArray output = info->readAllStandardOutput();
+    QString errorOutput = QString::fromLocal8Bit(info->readAllStandardError()).trimmed();
+    info->deleteLater();
+    info = nullptr;
+    if (exitStatus != QProcess::NormalExit || exitCode != 0) {
+        complete(false, errorOutput.isEmpty() ? QString("pdfinfo exited with code %1").arg(exitCode) : errorOutput);
+        return;
+    }
+
+    int documentPages = 0;
+    const QList<QByteArray> lines = output.split('\n');
+    for (const QByteArray &line : lines) {
+        if (line.startsWith("Pages:")) {
+            documentPages = line.mid(6).trimmed().toInt();
+        }
+    }
+
+    // Clip the ranges to the document and merge them into sorted runs
+    bool ok = false;
+    const QList<PageRun> ranges = parsePageRanges(pageRanges, &ok);
+    QList<int> pages;
+    for (const PageRun &range : ranges) {
+        int last = range.second == -1 ? documentPages : qMin(range.second, documentPages);
+        for (int page = range.first; page <= last; ++page) {
+            pages << page;
+        }
+    }
+    std::sort(pages.begin(), pages.end());
+    pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+    if (pages.isEmpty()) {
+        complete(false, QString("No pages selected (the document has %1)").arg(documentPages));
+        return;
+    }
+    pageCount = pages.size();
+
+    // Consecutive pages of at most runLength go to one pdftoppm call
+    int runLength = qMax(1, (pageCount + processes * RunsPerProcess - 1) / (processes * RunsPerProcess));
+    for (int i = 0; i < pages.size(); ) {
+        int first = pages[i];
+        int last = first;
+        while (++i < pages.size() && pages[i] == last + 1 && last - first + 1 < runLength) {
+            last = pages[i];
+        }
+        pendingRuns << PageRun(first, last);
+    }
+    startRuns();
+}
+
+void PdfRasterJob::startRuns()
+{
+    while (!done && !pendingRuns.isEmpty() && running.size() < processes) {
+        PageRun run = pendingRuns.takeFirst();
+
+        // Each run writes into its own directory, so its files are easy to collect
+        QString runDirectory = outputDirectory + QString("/run-%1").arg(run.first);
+        if (!QDir().mkpath(runDirectory)) {
+            complete(false, "Could not create " + runDirectory);
+            return;
+        }
+
+        QStringList args;
+        args << "-r" << QString::number(dpi)
+             << "-f" << QString::number(run.first)
+             << "-l" << QString::number(run.second);
+        if (targetFormat == Converter::FileFormat::JPG) {
+            args << "-jpeg" << "-jpegopt" << QString("quality=%1").arg(JpegQuality);
+        } else {
+            // pdftoppm has no WebP writer; those pages are re-encoded from PNG
+            args << "-png";
+        }
+        args << inputPath << runDirectory + "/" + QFileInfo(inputPath).completeBaseName();
+
+        QProcess *process = new QProcess(this);
+        running[process] = run;
+        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+                this, &PdfRasterJob::onRunFinished);
+        connect(process, &QProcess::errorOccurred, this, &PdfRasterJob::onProcessError);
+        process->start(pdftoppmPath, args);
+    }
+}
+
+void PdfRasterJob::onRunFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    QProcess *process = qobject_cast<QProcess*>(sender());
+    if (!process || !running.contains(process)) {
+        return;
+    }
+    PageRun run = running.take(process);
+    process->deleteLater();
+
+    if (exitStatus != QProcess::NormalExit || exitCode != 0) {
+        QString errorOutput = QString::fromLocal8Bit(process->readAllStandardError()).trimmed();
+        complete(false, errorOutput.isEmpty() ? QString("pdftoppm exited with code %1").arg(exitCode) : errorOutput);
+        return;
+    }
+    collectRun(run);
+    startRuns();
+    completeIfDone();
+}
+
+void PdfRasterJob::onProcessError(QProcess::ProcessError error)
+{
+    if (error != QProcess::FailedToStart) {
+        return; // Crashes are reported through finished()
+    }
+    QProcess *process = qobject_cast<QProcess*>(sender());
+    QString tool = process == info ? "pdfinfo" : "pdftoppm";
+    complete(false, "Failed to start " + tool + ". Please install Poppler.");
+}
+
+void PdfRasterJob::collectRun(const PageRun &run)
+{
+    QDir runDirectory(outputDirectory + QString("/run-%1").arg(run.first));
+    QStringList pagePaths;
+    // Page numbers are zero-padded to the same width, so name order is page order
+    const QFileInfoList files = runDirectory.entryInfoList(QDir::Files, QDir::Name);
+    for (const QFileInfo &file : files) {
+        pagePaths << file.absoluteFilePath();
+    }
+
+    if (targetFormat != Converter::FileFormat::WEBP) {
+        pagesDone += run.second - run.first + 1;
+        emit pagesRendered(pagePaths);
+        emit progress(pagesDone * 100 / pageCount);
+        return;
+    }
+
+    // Re-encoding is CPU work; keep it off the thread that drives the processes
+    encoding++;
+    encoders.start([this, pagePaths, run]() {
+        QStringList webpPaths;
+        QString errorMessage;
+        for (const QString &pngPath : pagePaths) {
+            QFileInfo png(pngPath);
+            QString webpPath = png.dir().filePath(png.completeBaseName() + ".webp");
+            QImageWriter writer(webpPath, "webp");
+            if (!writer.write(QImage(pngPath))) {
+                errorMessage = "Could not write " + webpPath + ": " + writer.errorString();
+                break;
+            }
+            QFile::remove(pngPath);
+            webpPaths << webpPath;
+        }
+
+        // Only the pointer is used here; everything else on the job's thread
+        QMetaObject::invokeMethod(this, [this, webpPaths, errorMessage, run]() {
+            encoding--;
+            if (done) {
+                return;
+            }
+            if (!errorMessage.isEmpty()) {
+                complete(false, errorMessage);
+                return;
+            }
+            pagesDone += run.second - run.first + 1;
+            emit pagesRendered(webpPaths);
+            emit progress(pagesDone * 100 / pageCount);
+            startRuns();
+            completeIfDone();
+        }, Qt::QueuedConnection);
+    });
+}
+
+void PdfRasterJob::completeIfDone()
+{
+    if (info == nullptr && pendingRuns.isEmpty() && running.isEmpty() && encoding == 0) {
+        complete(true, QString());
+    }
+}
+
+void PdfRasterJob::complete(bool ok, const QString &errorMessage)
+{
+    if (done) {
+        return;
+    }
+    done = true;
+    killProcesses();
+    emit finished(ok, errorMessage);
+}
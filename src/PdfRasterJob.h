@@ -0,0 +1,76 @@
+#ifndef PDFRASTERJOB_H
+#define PDFRASTERJOB_H
+
+#include <QObject>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QProcess>
+#include <QStringList>
+#include <QThreadPool>
+#include "Converter.h"
+
+// Renders the pages of a PDF to one image each with Poppler's pdftoppm. The
+// selected pages are cut into runs that several pdftoppm processes work
+// through in parallel; the pages of each run are reported as soon as it is
+// done, so they can be published while later pages are still rendering.
+class PdfRasterJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    // pdftoppm and pdfinfo are expected in the same directory
+    PdfRasterJob(const QString &pdftoppmPath, const QString &inputPath, Converter::FileFormat targetFormat,
+                 int dpi, const QString &pageRanges, const QString &outputDirectory,
+                 int processes, QObject *parent = nullptr);
+    ~PdfRasterJob();
+
+    void start();
+    void abort();
+
+    // "1-3,7,10-" (empty = every page); false if it cannot be parsed
+    static bool isValidPageRanges(const QString &pageRanges);
+
+signals:
+    void progress(int percent);
+    // Files of one finished run inside the output directory, in page order
+    void pagesRendered(const QStringList &pagePaths);
+    void finished(bool ok, const QString &errorMessage);
+
+private slots:
+    void onInfoFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void onRunFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void onProcessError(QProcess::ProcessError error);
+
+private:
+    typedef QPair<int, int> PageRun;    // First and last page
+
+    // Last page -1 = to the end of the document
+    static QList<PageRun> parsePageRanges(const QString &pageRanges, bool *ok);
+    void startRuns();
+    void collectRun(const PageRun &run);
+    void completeIfDone();
+    void complete(bool ok, const QString &errorMessage);
+    void killProcesses();
+
+    QString pdftoppmPath;
+    QString inputPath;
+    Converter::FileFormat targetFormat;
+    int dpi;
+    QString pageRanges;
+    QString outputDirectory;
+    int processes;
+
+    QProcess *info;
+    QList<PageRun> pendingRuns;
+    QMap<QProcess *, PageRun> running;
+    int pageCount;          // Selected pages
+    int pagesDone;
+    int encoding;           // WEBP runs being re-encoded off the main thread
+    bool done;
+    // The re-encodes' threads; waited for on destruction, so they never
+    // outlive the job they report to
+    QThreadPool encoders;
+};
+
+#endif // PDFRASTERJOB_H
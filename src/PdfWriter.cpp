@@ -0,0 +1,392 @@
+#include "PdfWriter.h"
+#include "PixelKernels.h"
+#include <QFile>
+#include <QImageReader>
+#include <QtEndian>
+#include <zlib.h>
+#include <cstring>
+
+namespace {
+constexpr qint64 CopyChunkSize = 1024 * 1024;
+constexpr int DeflateChunkSize = 64 * 1024;
+// Used when an image does not carry a density: one pixel per point
+constexpr double DefaultDotsPerInch = 72.0;
+
+QByteArray number(double value)
+{
+    // PDF has no exponent notation
+    return QByteArray::number(value, 'f', 2);
+}
+
+double toPoints(int pixels, double dotsPerInch)
+{
+    return pixels * 72.0 / (dotsPerInch > 0 ? dotsPerInch : DefaultDotsPerInch);
+}
+
+// Degrees clockwise for /Rotate; mirrored orientations are shown unmirrored
+int rotationFor(int orientation)
+{
+    switch (orientation) {
+        case 3: return 180;
+        case 6: return 90;
+        case 8: return 270;
+        default: return 0;
+    }
+}
+
+// Orientation tag (0x0112) from IFD0 of an APP1 "Exif" segment
+int exifOrientation(const QByteArray &segment)
+{
+    if (segment.size() < 14 || !segment.startsWith(QByteArray("Exif\0\0", 6))) {
+        return 1;
+    }
+    const char *tiff = segment.constData() + 6;
+    qsizetype size = segment.size() - 6;
+    bool little = tiff[0] == 'I';
+    auto u16 = [little](const char *p) {
+        return little ? qFromLittleEndian<quint16>(p) : qFromBigEndian<quint16>(p);
+    };
+    auto u32 = [little](const char *p) {
+        return little ? qFromLittleEndian<quint32>(p) : qFromBigEndian<quint32>(p);
+    };
+
+    // Wide enough that a bogus offset near 4 GB cannot wrap past the check
+    qint64 ifd = u32(tiff + 4);
+    if (ifd < 8 || ifd + 2 > size) {
+        return 1;
+    }
+    int count = u16(tiff + ifd);
+    for (int i = 0; i < count && ifd + 2 + (i + 1) * qint64(12) <= size; ++i) {
+        const char *entry = tiff + ifd + 2 + i * 12;
+        if (u16(entry) == 0x0112) {
+            int orientation = u16(entry + 8);
+            return orientation >= 1 && orientation <= 8 ? orientation : 1;
+        }
+    }
+    return 1;
+}
+}
+
+PdfWriter::PdfWriter(QIODevice *device)
+    : device(device), offset(0)
+{
+    // 1 is the catalog, written first, and 2 the page tree, written last
+    objectOffsets << -1 << -1;
+}
+
+int PdfWriter::pageCount() const
+{
+    return pageIds.size();
+}
+
+bool PdfWriter::write(const QByteArray &bytes, QString *errorMessage)
+{
+    if (device->write(bytes) != bytes.size()) {
+        *errorMessage = "Cannot write PDF: " + device->errorString();
+        return false;
+    }
+    offset += bytes.size();
+    return true;
+}
+
+int PdfWriter::allocateObject()
+{
+    objectOffsets << -1;
+    return objectOffsets.size();
+}
+
+bool PdfWriter::beginObject(int id, QString *errorMessage)
+{
+    objectOffsets[id - 1] = offset;
+    return write(QByteArray::number(id) + " 0 obj\n", errorMessage);
+}
+
+bool PdfWriter::readJpegInfo(QIODevice *device, JpegInfo *info)
+{
+    uchar soi[2];
+    if (device->read(reinterpret_cast<char *>(soi), 2) != 2 || soi[0] != 0xFF || soi[1] != 0xD8) {
+        return false;
+    }
+
+    // Only the segments before the first scan are read; the image data is not
+    forever {
+        char byte = 0;
+        if (!device->getChar(&byte)) {
+            return false;
+        }
+        if (uchar(byte) != 0xFF) {
+            continue;
+        }
+        uchar marker = 0xFF;
+        while (marker == 0xFF) {
+            if (!device->getChar(&byte)) {
+                return false;
+            }
+            marker = uchar(byte);
+        }
+        // Markers without a segment
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+            continue;
+        }
+        if (marker == 0xD9 || marker == 0xDA) {
+            return false;   // End or scan before a frame header
+        }
+
+        uchar lengthBytes[2];
+        if (device->read(reinterpret_cast<char *>(lengthBytes), 2) != 2) {
+            return false;
+        }
+        int length = qFromBigEndian<quint16>(lengthBytes) - 2;
+        if (length < 0) {
+            return false;
+        }
+        QByteArray segment = device->read(length);
+        if (segment.size() != length) {
+            return false;
+        }
+        const uchar *data = reinterpret_cast<const uchar *>(segment.constData());
+
+        if (marker == 0xE0 && length >= 12 && segment.startsWith(QByteArray("JFIF\0", 5))) {
+            int units = data[7];
+            int density = qFromBigEndian<quint16>(data + 8);
+            if (density > 0 && units == 1) {
+                info->dotsPerInch = density;
+            } else if (density > 0 && units == 2) {
+                info->dotsPerInch = density * 2.54;
+            }
+        } else if (marker == 0xE1) {
+            info->orientation = exifOrientation(segment);
+        } else if (marker == 0xEE && segment.startsWith("Adobe")) {
+            info->adobe = true;
+        } else if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            // Baseline, extended and progressive Huffman are what DCTDecode
+            // handles; lossless and arithmetic coding are not
+            if ((marker != 0xC0 && marker != 0xC1 && marker != 0xC2) || length < 6 || data[0] != 8) {
+                return false;
+            }
+            info->height = qFromBigEndian<quint16>(data + 1);
+            info->width = qFromBigEndian<quint16>(data + 3);
+            info->components = data[5];
+            return info->width > 0 && info->height > 0
+                   && (info->components == 1 || info->components == 3 || info->components == 4);
+        }
+    }
+}
+
+bool PdfWriter::addPage(const QString &imagePath, QString *errorMessage)
+{
+    if (offset == 0) {
+        // Binary comment so transfer tools treat the file as binary
+        if (!write("%PDF-1.4\n%\xE2\xE3\xCF\xD3\n", errorMessage)) {
+            return false;
+        }
+        if (!beginObject(1, errorMessage) || !write("<< /Type /Catalog /Pages 2 0 R >>\nendobj\n", errorMessage)) {
+            return false;
+        }
+    }
+
+    QFile file(imagePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *errorMessage = "Cannot read " + imagePath + ": " + file.errorString();
+        return false;
+    }
+    JpegInfo info;
+    if (readJpegInfo(&file, &info)) {
+        file.close();
+        return addJpegPage(imagePath, info, errorMessage);
+    }
+    file.close();
+    return addDecodedPage(imagePath, errorMessage);
+}
+
+bool PdfWriter::addJpegPage(const QString &imagePath, const JpegInfo &info, QString *errorMessage)
+{
+    QFile file(imagePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *errorMessage = "Cannot read " + imagePath + ": " + file.errorString();
+        return false;
+    }
+
+    QByteArray colorSpace = info.components == 1 ? "/DeviceGray" : info.components == 4 ? "/DeviceCMYK" : "/DeviceRGB";
+    QByteArray dictionary = "<< /Type /XObject /Subtype /Image /Width " + QByteArray::number(info.width)
+                            + " /Height " + QByteArray::number(info.height)
+                            + " /ColorSpace " + colorSpace + " /BitsPerComponent 8 /Filter /DCTDecode";
+    if (info.components == 4 && info.adobe) {
+        // Photoshop writes CMYK JPEGs inverted
+        dictionary += " /Decode [1 0 1 0 1 0 1 0]";
+    }
+    dictionary += " /Length " + QByteArray::number(file.size()) + " >>\nstream\n";
+
+    int imageId = allocateObject();
+    if (!beginObject(imageId, errorMessage) || !write(dictionary, errorMessage)) {
+        return false;
+    }
+    // The file is the stream; copy it through without holding it
+    qint64 copied = 0;
+    while (copied < file.size()) {
+        QByteArray chunk = file.read(CopyChunkSize);
+        if (chunk.isEmpty()) {
+            *errorMessage = "Cannot read " + imagePath + ": " + file.errorString();
+            return false;
+        }
+        if (!write(chunk, errorMessage)) {
+            return false;
+        }
+        copied += chunk.size();
+    }
+    if (!write("\nendstream\nendobj\n", errorMessage)) {
+        return false;
+    }
+
+    return writePage(imageId, toPoints(info.width, info.dotsPerInch), toPoints(info.height, info.dotsPerInch),
+                     rotationFor(info.orientation), errorMessage);
+}
+
+bool PdfWriter::addDecodedPage(const QString &imagePath, QString *errorMessage)
+{
+    QImageReader reader(imagePath);
+    reader.setAutoTransform(true);
+    QImage image = reader.read();
+    if (image.isNull()) {
+        *errorMessage = "Cannot read " + imagePath + ": " + reader.errorString();
+        return false;
+    }
+
+    // No soft masks: transparent areas become white, as in JPG outputs
+    double dotsPerInch = image.dotsPerMeterX() * 0.0254;
+    QImage rgb;
+    if (image.hasAlphaChannel()) {
+        image = image.convertToFormat(QImage::Format_RGBA8888);
+        rgb = QImage(image.size(), QImage::Format_RGB888);
+        for (int y = 0; y < image.height(); ++y) {
+            PixelKernels::flattenAlpha(image.constScanLine(y), rgb.scanLine(y), image.width(), 255, 255, 255);
+        }
+    } else {
+        rgb = image.convertToFormat(QImage::Format_RGB888);
+    }
+    image = QImage();
+
+    bool grayscale = true;
+    for (int y = 0; y < rgb.height() && grayscale; ++y) {
+        grayscale = PixelKernels::isGrayscale(rgb.constScanLine(y), rgb.width());
+    }
+
+    int imageId = allocateObject();
+    int lengthId = allocateObject();
+    QByteArray dictionary = "<< /Type /XObject /Subtype /Image /Width " + QByteArray::number(rgb.width())
+                            + " /Height " + QByteArray::number(rgb.height())
+                            + " /ColorSpace " + (grayscale ? "/DeviceGray" : "/DeviceRGB")
+                            + " /BitsPerComponent 8 /Filter /FlateDecode /Length "
+                            + QByteArray::number(lengthId) + " 0 R >>\nstream\n";
+    if (!beginObject(imageId, errorMessage) || !write(dictionary, errorMessage)) {
+        return false;
+    }
+
+    // Rows are deflated as they are read, so only one output chunk is held
+    z_stream stream = {};
+    if (deflateInit(&stream, Z_DEFAULT_COMPRESSION) != Z_OK) {
+        *errorMessage = "Cannot initialize compression";
+        return false;
+    }
+    QByteArray row(grayscale ? rgb.width() : rgb.width() * 3, Qt::Uninitialized);
+    QByteArray output(DeflateChunkSize, Qt::Uninitialized);
+    qint64 streamStart = offset;
+    bool ok = true;
+    for (int y = 0; y <= rgb.height() && ok; ++y) {
+        bool last = y == rgb.height();
+        if (!last) {
+            const uchar *pixels = rgb.constScanLine(y);
+            if (grayscale) {
+                uchar *gray = reinterpret_cast<uchar *>(row.data());
+                for (int x = 0; x < rgb.width(); ++x) {
+                    gray[x] = pixels[x * 3];
+                }
+            } else {
+                memcpy(row.data(), pixels, row.size());
+            }
+            stream.next_in = reinterpret_cast<Bytef *>(row.data());
+            stream.avail_in = static_cast<uInt>(row.size());
+        }
+        int result = Z_OK;
+        do {
+            stream.next_out = reinterpret_cast<Bytef *>(output.data());
+            stream.avail_out = static_cast<uInt>(output.size());
+            result = deflate(&stream, last ? Z_FINISH : Z_NO_FLUSH);
+            qsizetype produced = output.size() - stream.avail_out;
+            if (produced > 0 && !write(output.left(produced), errorMessage)) {
+                ok = false;
+                break;
+            }
+        } while (stream.avail_out == 0 || (last && result == Z_OK));
+    }
+    deflateEnd(&stream);
+    if (!ok) {
+        return false;
+    }
+    qint64 streamLength = offset - streamStart;
+    if (!write("\nendstream\nendobj\n", errorMessage)
+        || !beginObject(lengthId, errorMessage)
+        || !write(QByteArray::number(streamLength) + "\nendobj\n", errorMessage)) {
+        return false;
+    }
+
+    // Orientation was applied while decoding
+    return writePage(imageId, toPoints(rgb.width(), dotsPerInch), toPoints(rgb.height(), dotsPerInch), 0,
+                     errorMessage);
+}
+
+bool PdfWriter::writePage(int imageId, double widthPoints, double heightPoints, int rotation,
+                          QString *errorMessage)
+{
+    // The image fills the page; /Rotate turns the page for EXIF orientation
+    QByteArray content = "q " + number(widthPoints) + " 0 0 " + number(heightPoints) + " 0 0 cm /Im0 Do Q";
+    int contentId = allocateObject();
+    if (!beginObject(contentId, errorMessage)
+        || !write("<< /Length " + QByteArray::number(content.size()) + " >>\nstream\n" + content
+                  + "\nendstream\nendobj\n", errorMessage)) {
+        return false;
+    }
+
+    int pageId = allocateObject();
+    QByteArray page = "<< /Type /Page /Parent 2 0 R /MediaBox [0 0 " + number(widthPoints) + " "
+                      + number(heightPoints) + "] /Resources << /XObject << /Im0 "
+                      + QByteArray::number(imageId) + " 0 R >> >> /Contents "
+                      + QByteArray::number(contentId) + " 0 R";
+    if (rotation != 0) {
+        page += " /Rotate " + QByteArray::number(rotation);
+    }
+    page += " >>\nendobj\n";
+    if (!beginObject(pageId, errorMessage) || !write(page, errorMessage)) {
+        return false;
+    }
+    pageIds << pageId;
+    return true;
+}
+
+bool PdfWriter::finish(QString *errorMessage)
+{
+    if (pageIds.isEmpty()) {
+        *errorMessage = "No pages were added";
+        return false;
+    }
+
+    QByteArray kids;
+    for (int id : pageIds) {
+        kids += QByteArray::number(id) + " 0 R ";
+    }
+    if (!beginObject(2, errorMessage)
+        || !write("<< /Type /Pages /Kids [" + kids + "] /Count " + QByteArray::number(pageIds.size())
+                  + " >>\nendobj\n", errorMessage)) {
+        return false;
+    }
+
+    // Cross-reference entries are exactly 20 bytes each
+    qint64 xrefOffset = offset;
+    QByteArray xref = "xref\n0 " + QByteArray::number(objectOffsets.size() + 1) + "\n0000000000 65535 f \n";
+    for (qint64 objectOffset : objectOffsets) {
+        xref += QByteArray::number(objectOffset).rightJustified(10, '0') + " 00000 n \n";
+    }
+    xref += "trailer\n<< /Size " + QByteArray::number(objectOffsets.size() + 1) + " /Root 1 0 R >>\n"
+            "startxref\n" + QByteArray::number(xrefOffset) + "\n%%EOF\n";
+    return write(xref, errorMessage);
+}
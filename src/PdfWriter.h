@@ -0,0 +1,52 @@
+#ifndef PDFWRITER_H
+#define PDFWRITER_H
+
+#include <QIODevice>
+#include <QImage>
+#include <QList>
+#include <QString>
+
+// Writes a PDF of image pages to a device in one pass, one page per image.
+// JPEG files are embedded as they are (DCTDecode), without decoding a pixel;
+// other images are decoded one at a time and deflated. Pages go out as they
+// are added and only object offsets are kept, so a PDF of thousands of scans
+// needs no more memory than one.
+class PdfWriter
+{
+public:
+    // What the page layout needs from a JPEG, read from its markers
+    struct JpegInfo {
+        int width = 0;
+        int height = 0;
+        int components = 0;         // 1 = gray, 3 = YCbCr/RGB, 4 = CMYK
+        double dotsPerInch = 0;     // 0 when the file does not say
+        int orientation = 1;        // EXIF orientation, 1 = upright
+        bool adobe = false;         // Adobe APP14 marker: CMYK is stored inverted
+    };
+
+    explicit PdfWriter(QIODevice *device);
+
+    // JPEGs that PDF readers can show are copied in; anything else (PNG,
+    // WebP, arithmetic-coded or 12-bit JPEG) is decoded and deflated
+    bool addPage(const QString &imagePath, QString *errorMessage);
+    bool finish(QString *errorMessage);
+    int pageCount() const;
+
+    // False if this is not a baseline or progressive 8-bit JPEG
+    static bool readJpegInfo(QIODevice *device, JpegInfo *info);
+
+private:
+    bool addJpegPage(const QString &imagePath, const JpegInfo &info, QString *errorMessage);
+    bool addDecodedPage(const QString &imagePath, QString *errorMessage);
+    bool writePage(int imageId, double widthPoints, double heightPoints, int rotation, QString *errorMessage);
+    int allocateObject();
+    bool beginObject(int id, QString *errorMessage);
+    bool write(const QByteArray &bytes, QString *errorMessage);
+
+    QIODevice *device;
+    qint64 offset;
+    QList<qint64> objectOffsets;    // Index = object number - 1
+    QList<int> pageIds;
+};
+
+#endif // PDFWRITER_H
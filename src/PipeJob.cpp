@@ -0,0 +1,122 @@
+#include "PipeJob.h"
+#include <QFileDevice>
+#include <QFileInfo>
+
+namespace {
+constexpr qint64 ChunkSize = 1024 * 1024;
+constexpr qint64 MaxBufferedBytes = 4 * 1024 * 1024;
+}
+
+PipeJob::PipeJob(const QString &program, const QStringList &arguments,
+                 QIODevice *input, QIODevice *output, QObject *parent)
+    : QObject(parent), program(program), arguments(arguments), input(input), output(output),
+      inputFinished(false), inputClosed(false), done(false)
+{
+    process = new QProcess(this);
+    connect(process, &QProcess::started, this, &PipeJob::pumpInput);
+    connect(process, &QProcess::bytesWritten, this, &PipeJob::pumpInput);
+    connect(process, &QProcess::readyReadStandardOutput, this, &PipeJob::onReadyReadOutput);
+    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, &PipeJob::onProcessFinished);
+    connect(process, &QProcess::errorOccurred, this, &PipeJob::onProcessError);
+
+    // Sockets and other event-driven devices announce data and end of stream
+    connect(input, &QIODevice::readyRead, this, &PipeJob::pumpInput);
+    connect(input, &QIODevice::readChannelFinished, this, &PipeJob::onInputFinished);
+    connect(input, &QIODevice::aboutToClose, this, &PipeJob::onInputFinished);
+}
+
+void PipeJob::start()
+{
+    process->start(program, arguments);
+}
+
+void PipeJob::abort()
+{
+    complete(false, "Cancelled");
+}
+
+bool PipeJob::inputAtEnd() const
+{
+    // Files (including a redirected stdin) block until data is available, so
+    // an empty read means end of file; other sequential devices must say so
+    if (!input->isSequential() || qobject_cast<QFileDevice *>(input)) {
+        return true;
+    }
+    return inputFinished || !input->isOpen();
+}
+
+void PipeJob::pumpInput()
+{
+    // Only a few chunks are queued for the tool, so a large input is never
+    // held in memory while the tool is busy
+    while (!done && !inputClosed && process->state() == QProcess::Running
+           && process->bytesToWrite() < MaxBufferedBytes) {
+        QByteArray chunk = input->read(ChunkSize);
+        if (chunk.isEmpty()) {
+            if (inputAtEnd()) {
+                process->closeWriteChannel();
+                inputClosed = true;
+            }
+            return;
+        }
+        process->write(chunk);
+    }
+}
+
+void PipeJob::onInputFinished()
+{
+    inputFinished = true;
+    pumpInput();
+}
+
+void PipeJob::onReadyReadOutput()
+{
+    QByteArray data = process->readAllStandardOutput();
+    if (!done && output->write(data) != data.size()) {
+        complete(false, "Could not write output: " + output->errorString());
+    }
+}
+
+void PipeJob::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    onReadyReadOutput();
+    if (QFileDevice *file = qobject_cast<QFileDevice *>(output)) {
+        file->flush();
+    }
+
+    if (exitStatus == QProcess::NormalExit && exitCode == 0) {
+        complete(true, QString());
+        return;
+    }
+
+    QString message = QString::fromLocal8Bit(process->readAllStandardError()).trimmed();
+    if (message.isEmpty()) {
+        message = exitStatus == QProcess::CrashExit
+                  ? "Process crashed"
+                  : QString("Process exited with code %1").arg(exitCode);
+    }
+    complete(false, message);
+}
+
+void PipeJob::onProcessError(QProcess::ProcessError error)
+{
+    // Crashes and write errors are followed by finished(); only a failed start is final
+    if (error == QProcess::FailedToStart) {
+        complete(false, "Could not start " + QFileInfo(program).fileName() + ": " + process->errorString());
+    }
+}
+
+void PipeJob::complete(bool ok, const QString &errorMessage)
+{
+    if (done) {
+        return;
+    }
+    done = true;
+    input->disconnect(this);
+    if (process->state() != QProcess::NotRunning) {
+        process->disconnect(this);
+        process->kill();
+    }
+    emit finished(ok, errorMessage);
+}
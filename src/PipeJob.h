@@ -0,0 +1,46 @@
+#ifndef PIPEJOB_H
+#define PIPEJOB_H
+
+#include <QObject>
+#include <QProcess>
+
+class QIODevice;
+
+// One conversion that streams input into a tool's stdin and its stdout into
+// an output device, so neither side touches a temporary file.
+class PipeJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    PipeJob(const QString &program, const QStringList &arguments,
+            QIODevice *input, QIODevice *output, QObject *parent = nullptr);
+
+    void start();
+    void abort();
+
+signals:
+    void finished(bool ok, const QString &errorMessage);
+
+private slots:
+    void pumpInput();
+    void onInputFinished();
+    void onReadyReadOutput();
+    void onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void onProcessError(QProcess::ProcessError error);
+
+private:
+    bool inputAtEnd() const;
+    void complete(bool ok, const QString &errorMessage);
+
+    QString program;
+    QStringList arguments;
+    QIODevice *input;
+    QIODevice *output;
+    QProcess *process;
+    bool inputFinished;     // The input device reported end of stream
+    bool inputClosed;       // stdin of the tool was closed
+    bool done;
+};
+
+#endif // PIPEJOB_H
@@ -0,0 +1,740 @@
+#include "PixelKernels.h"
+#include <atomic>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PIXELKERNELS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#if defined(_MSC_VER) && !defined(__clang__)
+#define PIXELKERNELS_TARGET_AVX2
+#else
+#define PIXELKERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define PIXELKERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// Scalar references; the vector paths below must match them byte for byte
+
+inline uchar blend(unsigned int color, unsigned int alpha, unsigned int background)
+{
+    // Exact round(v / 255) for v <= 255 * 255
+    unsigned int x = color * alpha + background * (255 - alpha) + 128;
+    return uchar((x + (x >> 8)) >> 8);
+}
+
+inline uchar reduceSample(unsigned int sample, int bits)
+{
+    // Exact round(v / 257); the vector paths add 128 with 16-bit saturation
+    unsigned int wide = ((sample << (16 - bits)) | (sample >> (2 * bits - 16))) & 0xFFFF;
+    unsigned int t = qMin(wide + 128, 0xFFFFu);
+    return uchar((t - (t >> 8)) >> 8);
+}
+
+void flattenAlphaScalar(const uchar *rgba, uchar *rgb, qsizetype from, qsizetype pixels, const uchar *background)
+{
+    for (qsizetype i = from; i < pixels; ++i) {
+        const uchar *in = rgba + i * 4;
+        uchar *out = rgb + i * 3;
+        unsigned int alpha = in[3];
+        out[0] = blend(in[0], alpha, background[0]);
+        out[1] = blend(in[1], alpha, background[1]);
+        out[2] = blend(in[2], alpha, background[2]);
+    }
+}
+
+// Swap: red and blue change places (RGBA to BGR, BGR to RGBA)
+template <bool Swap>
+void rgbaToRgbScalar(const uchar *rgba, uchar *rgb, qsizetype from, qsizetype pixels)
+{
+    for (qsizetype i = from; i < pixels; ++i) {
+        const uchar *in = rgba + i * 4;
+        uchar *out = rgb + i * 3;
+        // Read before writing: out may be in (in place, as HeifDecoder does)
+        uchar red = in[0], green = in[1], blue = in[2];
+        out[0] = Swap ? blue : red;
+        out[1] = green;
+        out[2] = Swap ? red : blue;
+    }
+}
+
+template <bool Swap>
+void rgbToRgbaScalar(const uchar *rgb, uchar *rgba, qsizetype from, qsizetype pixels)
+{
+    for (qsizetype i = from; i < pixels; ++i) {
+        const uchar *in = rgb + i * 3;
+        uchar *out = rgba + i * 4;
+        out[0] = in[Swap ? 2 : 0];
+        out[1] = in[1];
+        out[2] = in[Swap ? 0 : 2];
+        out[3] = 255;
+    }
+}
+
+void reduceTo8Scalar(const quint16 *samples, uchar *output, qsizetype from, qsizetype count, int bits)
+{
+    for (qsizetype i = from; i < count; ++i) {
+        output[i] = reduceSample(samples[i], bits);
+    }
+}
+
+bool isGrayscaleScalar(const uchar *rgb, qsizetype from, qsizetype pixels)
+{
+    for (qsizetype i = from; i < pixels; ++i) {
+        const uchar *p = rgb + i * 3;
+        if (p[0] != p[1] || p[1] != p[2]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool isOpaqueScalar(const uchar *rgba, qsizetype from, qsizetype pixels)
+{
+    for (qsizetype i = from; i < pixels; ++i) {
+        if (rgba[i * 4 + 3] != 255) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef PIXELKERNELS_X86
+
+// Byte j of a packed RGB block starting at offset 'start' must equal byte
+// j + 1 unless it is a blue byte
+constexpr unsigned int grayCompareMask(int start, int width)
+{
+    unsigned int mask = 0;
+    for (int j = 0; j < width; ++j) {
+        if ((start + j) % 3 != 2) {
+            mask |= 1u << j;
+        }
+    }
+    return mask;
+}
+
+// SSE2 is part of the x86-64 baseline
+
+inline __m128i blendSse2(__m128i color, __m128i background, __m128i full, __m128i half)
+{
+    // Lanes hold two RGBA pixels; spread each pixel's alpha over its lanes
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(color, _MM_SHUFFLE(3, 3, 3, 3)),
+                                        _MM_SHUFFLE(3, 3, 3, 3));
+    __m128i x = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(color, alpha),
+                                            _mm_mullo_epi16(background, _mm_sub_epi16(full, alpha))),
+                              half);
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+inline __m128i packRgbSse2(__m128i v)
+{
+    // Four RGBA pixels into the low 12 bytes, without SSSE3's byte shuffle
+    const __m128i keep0 = _mm_setr_epi8(-1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i keep1 = _mm_setr_epi8(0, 0, 0, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i keep2 = _mm_setr_epi8(0, 0, 0, 0, 0, 0, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i keep3 = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, -1, -1, -1, 0, 0, 0, 0);
+    return _mm_or_si128(_mm_or_si128(_mm_and_si128(v, keep0), _mm_and_si128(_mm_srli_si128(v, 1), keep1)),
+                        _mm_or_si128(_mm_and_si128(_mm_srli_si128(v, 2), keep2),
+                                     _mm_and_si128(_mm_srli_si128(v, 3), keep3)));
+}
+
+void flattenAlphaSse2(const uchar *rgba, uchar *rgb, qsizetype pixels, const uchar *background)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(255);
+    const __m128i half = _mm_set1_epi16(128);
+    const __m128i bg = _mm_setr_epi16(background[0], background[1], background[2], 0,
+                                      background[0], background[1], background[2], 0);
+
+    // Each store writes 16 bytes for 12 bytes of output; stay 4 bytes short of the end
+    qsizetype i = 0;
+    for (; i + 6 <= pixels; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rgba + i * 4));
+        __m128i low = blendSse2(_mm_unpacklo_epi8(v, zero), bg, full, half);
+        __m128i high = blendSse2(_mm_unpackhi_epi8(v, zero), bg, full, half);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(rgb + i * 3), packRgbSse2(_mm_packus_epi16(low, high)));
+    }
+    flattenAlphaScalar(rgba, rgb, i, pixels, background);
+}
+
+inline __m128i swapRedBlueSse2(__m128i v)
+{
+    // Per RGBA dword: keep G and A, exchange bytes 0 and 2
+    const __m128i greenAlpha = _mm_set1_epi32(int(0xFF00FF00u));
+    const __m128i low = _mm_set1_epi32(0x000000FF);
+    return _mm_or_si128(_mm_and_si128(v, greenAlpha),
+                        _mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, 16), low),
+                                     _mm_slli_epi32(_mm_and_si128(v, low), 16)));
+}
+
+inline __m128i unpackRgbSse2(__m128i v)
+{
+    // Low 12 bytes of RGB into four RGBA pixels with alpha 0; the inverse of packRgbSse2
+    const __m128i keep0 = _mm_setr_epi8(-1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i keep1 = _mm_setr_epi8(0, 0, 0, 0, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i keep2 = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, -1, -1, -1, 0, 0, 0, 0, 0);
+    const __m128i keep3 = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, -1, -1, -1, 0);
+    return _mm_or_si128(_mm_or_si128(_mm_and_si128(v, keep0), _mm_and_si128(_mm_slli_si128(v, 1), keep1)),
+                        _mm_or_si128(_mm_and_si128(_mm_slli_si128(v, 2), keep2),
+                                     _mm_and_si128(_mm_slli_si128(v, 3), keep3)));
+}
+
+template <bool Swap>
+void rgbaToRgbSse2(const uchar *rgba, uchar *rgb, qsizetype pixels)
+{
+    qsizetype i = 0;
+    for (; i + 6 <= pixels; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rgba + i * 4));
+        if (Swap) {
+            v = swapRedBlueSse2(v);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(rgb + i * 3), packRgbSse2(v));
+    }
+    rgbaToRgbScalar<Swap>(rgba, rgb, i, pixels);
+}
+
+template <bool Swap>
+void rgbToRgbaSse2(const uchar *rgb, uchar *rgba, qsizetype pixels)
+{
+    const __m128i alpha = _mm_set1_epi32(int(0xFF000000u));
+    // Each load reads 16 bytes for 12 bytes of input; stay 4 bytes short of the end
+    qsizetype i = 0;
+    for (; i + 6 <= pixels; i += 4) {
+        __m128i v = unpackRgbSse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(rgb + i * 3)));
+        if (Swap) {
+            v = swapRedBlueSse2(v);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(rgba + i * 4), _mm_or_si128(v, alpha));
+    }
+    rgbToRgbaScalar<Swap>(rgb, rgba, i, pixels);
+}
+
+inline __m128i reduceSse2(__m128i v, __m128i left, __m128i right, __m128i half)
+{
+    __m128i t = _mm_adds_epu16(_mm_or_si128(_mm_sll_epi16(v, left), _mm_srl_epi16(v, right)), half);
+    return _mm_srli_epi16(_mm_sub_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+void reduceTo8Sse2(const quint16 *samples, uchar *output, qsizetype count, int bits)
+{
+    const __m128i left = _mm_cvtsi32_si128(16 - bits);
+    const __m128i right = _mm_cvtsi32_si128(2 * bits - 16);
+    const __m128i half = _mm_set1_epi16(128);
+
+    qsizetype i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i + 8));
+        __m128i packed = _mm_packus_epi16(reduceSse2(a, left, right, half), reduceSse2(b, left, right, half));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output + i), packed);
+    }
+    reduceTo8Scalar(samples, output, i, count, bits);
+}
+
+bool isGrayscaleSse2(const uchar *rgb, qsizetype pixels)
+{
+    // 16 pixels per block; each byte is compared with the next one, so the
+    // block reads one byte past its end
+    static constexpr unsigned int masks[3] = {
+        grayCompareMask(0, 16), grayCompareMask(16, 16), grayCompareMask(32, 16)
+    };
+    const qsizetype bytes = pixels * 3;
+    qsizetype offset = 0;
+    for (; offset + 49 <= bytes; offset += 48) {
+        for (int k = 0; k < 3; ++k) {
+            const uchar *p = rgb + offset + k * 16;
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 1));
+            unsigned int equal = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)));
+            if (~equal & masks[k]) {
+                return false;
+            }
+        }
+    }
+    return isGrayscaleScalar(rgb, offset / 3, pixels);
+}
+
+bool isOpaqueSse2(const uchar *rgba, qsizetype pixels)
+{
+    const __m128i color = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i ones = _mm_set1_epi32(-1);
+    qsizetype i = 0;
+    for (; i + 4 <= pixels; i += 4) {
+        __m128i v = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(rgba + i * 4)), color);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, ones)) != 0xFFFF) {
+            return false;
+        }
+    }
+    return isOpaqueScalar(rgba, i, pixels);
+}
+
+// AVX2 is compiled per function and only called after the CPU check
+
+PIXELKERNELS_TARGET_AVX2 inline __m256i blendAvx2(__m256i color, __m256i background, __m256i full, __m256i half)
+{
+    __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(color, _MM_SHUFFLE(3, 3, 3, 3)),
+                                           _MM_SHUFFLE(3, 3, 3, 3));
+    __m256i x = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(color, alpha),
+                                                  _mm256_mullo_epi16(background, _mm256_sub_epi16(full, alpha))),
+                                 half);
+    return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+template <bool Swap = false>
+PIXELKERNELS_TARGET_AVX2 inline __m256i packRgbAvx2(__m256i v)
+{
+    // 12 bytes per 128-bit lane, then the two lanes' dwords moved together
+    const __m256i shuffle = Swap
+        ? _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                           2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)
+        : _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                           0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m256i order = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+    return _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, shuffle), order);
+}
+
+PIXELKERNELS_TARGET_AVX2 void flattenAlphaAvx2(const uchar *rgba, uchar *rgb, qsizetype pixels,
+                                               const uchar *background)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i full = _mm256_set1_epi16(255);
+    const __m256i half = _mm256_set1_epi16(128);
+    const __m256i bg = _mm256_setr_epi16(background[0], background[1], background[2], 0,
+                                         background[0], background[1], background[2], 0,
+                                         background[0], background[1], background[2], 0,
+                                         background[0], background[1], background[2], 0);
+
+    // 32-byte stores for 24 bytes of output
+    qsizetype i = 0;
+    for (; i + 11 <= pixels; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rgba + i * 4));
+        __m256i low = blendAvx2(_mm256_unpacklo_epi8(v, zero), bg, full, half);
+        __m256i high = blendAvx2(_mm256_unpackhi_epi8(v, zero), bg, full, half);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(rgb + i * 3), packRgbAvx2(_mm256_packus_epi16(low, high)));
+    }
+    flattenAlphaSse2(rgba + i * 4, rgb + i * 3, pixels - i, background);
+}
+
+template <bool Swap>
+PIXELKERNELS_TARGET_AVX2 void rgbaToRgbAvx2(const uchar *rgba, uchar *rgb, qsizetype pixels)
+{
+    qsizetype i = 0;
+    for (; i + 11 <= pixels; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rgba + i * 4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(rgb + i * 3), packRgbAvx2<Swap>(v));
+    }
+    rgbaToRgbSse2<Swap>(rgba + i * 4, rgb + i * 3, pixels - i);
+}
+
+template <bool Swap>
+PIXELKERNELS_TARGET_AVX2 void rgbToRgbaAvx2(const uchar *rgb, uchar *rgba, qsizetype pixels)
+{
+    // 24 bytes of input spread as 12 per 128-bit lane, then one RGBA pixel per dword
+    const __m256i order = _mm256_setr_epi32(0, 1, 2, 0, 3, 4, 5, 0);
+    const __m256i shuffle = Swap
+        ? _mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+                           2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1)
+        : _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                           0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m256i alpha = _mm256_set1_epi32(int(0xFF000000u));
+
+    // 32-byte loads for 24 bytes of input
+    qsizetype i = 0;
+    for (; i + 11 <= pixels; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rgb + i * 3));
+        v = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(v, order), shuffle);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(rgba + i * 4), _mm256_or_si256(v, alpha));
+    }
+    rgbToRgbaSse2<Swap>(rgb + i * 3, rgba + i * 4, pixels - i);
+}
+
+PIXELKERNELS_TARGET_AVX2 inline __m256i reduceAvx2(__m256i v, __m128i left, __m128i right, __m256i half)
+{
+    __m256i t = _mm256_adds_epu16(_mm256_or_si256(_mm256_sll_epi16(v, left), _mm256_srl_epi16(v, right)), half);
+    return _mm256_srli_epi16(_mm256_sub_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+PIXELKERNELS_TARGET_AVX2 void reduceTo8Avx2(const quint16 *samples, uchar *output, qsizetype count, int bits)
+{
+    const __m128i left = _mm_cvtsi32_si128(16 - bits);
+    const __m128i right = _mm_cvtsi32_si128(2 * bits - 16);
+    const __m256i half = _mm256_set1_epi16(128);
+
+    qsizetype i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(samples + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(samples + i + 16));
+        // packus works per lane; put the quadwords back in order
+        __m256i packed = _mm256_packus_epi16(reduceAvx2(a, left, right, half), reduceAvx2(b, left, right, half));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i),
+                            _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    reduceTo8Sse2(samples + i, output + i, count - i, bits);
+}
+
+PIXELKERNELS_TARGET_AVX2 bool isGrayscaleAvx2(const uchar *rgb, qsizetype pixels)
+{
+    static constexpr unsigned int masks[3] = {
+        grayCompareMask(0, 32), grayCompareMask(32, 32), grayCompareMask(64, 32)
+    };
+    const qsizetype bytes = pixels * 3;
+    qsizetype offset = 0;
+    for (; offset + 97 <= bytes; offset += 96) {
+        for (int k = 0; k < 3; ++k) {
+            const uchar *p = rgb + offset + k * 32;
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 1));
+            unsigned int equal = unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)));
+            if (~equal & masks[k]) {
+                return false;
+            }
+        }
+    }
+    return isGrayscaleSse2(rgb + offset, pixels - offset / 3);
+}
+
+PIXELKERNELS_TARGET_AVX2 bool isOpaqueAvx2(const uchar *rgba, qsizetype pixels)
+{
+    const __m256i color = _mm256_set1_epi32(0x00FFFFFF);
+    const __m256i ones = _mm256_set1_epi32(-1);
+    qsizetype i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        __m256i v = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(rgba + i * 4)), color);
+        if (unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, ones))) != 0xFFFFFFFFu) {
+            return false;
+        }
+    }
+    return isOpaqueSse2(rgba + i * 4, pixels - i);
+}
+
+bool cpuHasAvx2()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    // AVX plus OS support for the YMM state, then AVX2 itself
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // PIXELKERNELS_X86
+
+#ifdef PIXELKERNELS_NEON
+
+inline uint8x16_t blendNeon(uint8x16_t color, uint8x16_t alpha, uint8x16_t inverse, uint8x8_t background)
+{
+    const uint16x8_t half = vdupq_n_u16(128);
+    uint16x8_t low = vaddq_u16(vmlal_u8(vmull_u8(vget_low_u8(color), vget_low_u8(alpha)),
+                                        background, vget_low_u8(inverse)), half);
+    uint16x8_t high = vaddq_u16(vmlal_u8(vmull_u8(vget_high_u8(color), vget_high_u8(alpha)),
+                                         background, vget_high_u8(inverse)), half);
+    return vcombine_u8(vshrn_n_u16(vaddq_u16(low, vshrq_n_u16(low, 8)), 8),
+                       vshrn_n_u16(vaddq_u16(high, vshrq_n_u16(high, 8)), 8));
+}
+
+void flattenAlphaNeon(const uchar *rgba, uchar *rgb, qsizetype pixels, const uchar *background)
+{
+    const uint8x8_t red = vdup_n_u8(background[0]);
+    const uint8x8_t green = vdup_n_u8(background[1]);
+    const uint8x8_t blue = vdup_n_u8(background[2]);
+
+    qsizetype i = 0;
+    for (; i + 16 <= pixels; i += 16) {
+        uint8x16x4_t in = vld4q_u8(rgba + i * 4);
+        uint8x16_t inverse = vmvnq_u8(in.val[3]);
+        uint8x16x3_t out;
+        out.val[0] = blendNeon(in.val[0], in.val[3], inverse, red);
+        out.val[1] = blendNeon(in.val[1], in.val[3], inverse, green);
+        out.val[2] = blendNeon(in.val[2], in.val[3], inverse, blue);
+        vst3q_u8(rgb + i * 3, out);
+    }
+    flattenAlphaScalar(rgba, rgb, i, pixels, background);
+}
+
+template <bool Swap>
+void rgbaToRgbNeon(const uchar *rgba, uchar *rgb, qsizetype pixels)
+{
+    qsizetype i = 0;
+    for (; i + 16 <= pixels; i += 16) {
+        uint8x16x4_t in = vld4q_u8(rgba + i * 4);
+        uint8x16x3_t out;
+        out.val[0] = in.val[Swap ? 2 : 0];
+        out.val[1] = in.val[1];
+        out.val[2] = in.val[Swap ? 0 : 2];
+        vst3q_u8(rgb + i * 3, out);
+    }
+    rgbaToRgbScalar<Swap>(rgba, rgb, i, pixels);
+}
+
+template <bool Swap>
+void rgbToRgbaNeon(const uchar *rgb, uchar *rgba, qsizetype pixels)
+{
+    qsizetype i = 0;
+    for (; i + 16 <= pixels; i += 16) {
+        uint8x16x3_t in = vld3q_u8(rgb + i * 3);
+        uint8x16x4_t out;
+        out.val[0] = in.val[Swap ? 2 : 0];
+        out.val[1] = in.val[1];
+        out.val[2] = in.val[Swap ? 0 : 2];
+        out.val[3] = vdupq_n_u8(255);
+        vst4q_u8(rgba + i * 4, out);
+    }
+    rgbToRgbaScalar<Swap>(rgb, rgba, i, pixels);
+}
+
+inline uint8x8_t reduceNeon(uint16x8_t v, int16x8_t left, int16x8_t right)
+{
+    uint16x8_t t = vqaddq_u16(vorrq_u16(vshlq_u16(v, left), vshlq_u16(v, right)), vdupq_n_u16(128));
+    return vshrn_n_u16(vsubq_u16(t, vshrq_n_u16(t, 8)), 8);
+}
+
+void reduceTo8Neon(const quint16 *samples, uchar *output, qsizetype count, int bits)
+{
+    // Negative counts shift right; a shift by the full width gives zero
+    const int16x8_t left = vdupq_n_s16(int16_t(16 - bits));
+    const int16x8_t right = vdupq_n_s16(int16_t(16 - 2 * bits));
+
+    qsizetype i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x8_t low = reduceNeon(vld1q_u16(samples + i), left, right);
+        uint8x8_t high = reduceNeon(vld1q_u16(samples + i + 8), left, right);
+        vst1q_u8(output + i, vcombine_u8(low, high));
+    }
+    reduceTo8Scalar(samples, output, i, count, bits);
+}
+
+bool isGrayscaleNeon(const uchar *rgb, qsizetype pixels)
+{
+    qsizetype i = 0;
+    for (; i + 16 <= pixels; i += 16) {
+        uint8x16x3_t in = vld3q_u8(rgb + i * 3);
+        uint8x16_t equal = vandq_u8(vceqq_u8(in.val[0], in.val[1]), vceqq_u8(in.val[1], in.val[2]));
+        if (vminvq_u8(equal) != 0xFF) {
+            return false;
+        }
+    }
+    return isGrayscaleScalar(rgb, i, pixels);
+}
+
+bool isOpaqueNeon(const uchar *rgba, qsizetype pixels)
+{
+    qsizetype i = 0;
+    for (; i + 16 <= pixels; i += 16) {
+        uint8x16x4_t in = vld4q_u8(rgba + i * 4);
+        if (vminvq_u8(in.val[3]) != 0xFF) {
+            return false;
+        }
+    }
+    return isOpaqueScalar(rgba, i, pixels);
+}
+
+#endif // PIXELKERNELS_NEON
+
+PixelKernels::Isa detectIsa()
+{
+#if defined(PIXELKERNELS_X86)
+    return cpuHasAvx2() ? PixelKernels::Isa::AVX2 : PixelKernels::Isa::SSE2;
+#elif defined(PIXELKERNELS_NEON)
+    return PixelKernels::Isa::NEON;
+#else
+    return PixelKernels::Isa::Scalar;
+#endif
+}
+
+std::atomic<PixelKernels::Isa> &isaSetting()
+{
+    static std::atomic<PixelKernels::Isa> isa(PixelKernels::supportedIsa());
+    return isa;
+}
+
+}
+
+PixelKernels::Isa PixelKernels::supportedIsa()
+{
+    static const Isa isa = detectIsa();
+    return isa;
+}
+
+PixelKernels::Isa PixelKernels::activeIsa()
+{
+    return isaSetting().load(std::memory_order_relaxed);
+}
+
+void PixelKernels::setIsa(Isa isa)
+{
+    Isa supported = supportedIsa();
+    bool available = isa == Isa::Scalar || isa == supported
+                     || (isa == Isa::SSE2 && supported == Isa::AVX2);
+    isaSetting().store(available ? isa : supported, std::memory_order_relaxed);
+}
+
+void PixelKernels::flattenAlpha(const uchar *rgba, uchar *rgb, qsizetype pixels,
+                                uchar backgroundRed, uchar backgroundGreen, uchar backgroundBlue)
+{
+    const uchar background[3] = { backgroundRed, backgroundGreen, backgroundBlue };
+    switch (activeIsa()) {
+#ifdef PIXELKERNELS_X86
+        case Isa::AVX2:
+            flattenAlphaAvx2(rgba, rgb, pixels, background);
+            return;
+        case Isa::SSE2:
+            flattenAlphaSse2(rgba, rgb, pixels, background);
+            return;
+#endif
+#ifdef PIXELKERNELS_NEON
+        case Isa::NEON:
+            flattenAlphaNeon(rgba, rgb, pixels, background);
+            return;
+#endif
+        default:
+            flattenAlphaScalar(rgba, rgb, 0, pixels, background);
+            return;
+    }
+}
+
+namespace {
+
+template <bool Swap>
+void rgbaToRgbDispatch(const uchar *rgba, uchar *rgb, qsizetype pixels)
+{
+    switch (PixelKernels::activeIsa()) {
+#ifdef PIXELKERNELS_X86
+        case PixelKernels::Isa::AVX2:
+            rgbaToRgbAvx2<Swap>(rgba, rgb, pixels);
+            return;
+        case PixelKernels::Isa::SSE2:
+            rgbaToRgbSse2<Swap>(rgba, rgb, pixels);
+            return;
+#endif
+#ifdef PIXELKERNELS_NEON
+        case PixelKernels::Isa::NEON:
+            rgbaToRgbNeon<Swap>(rgba, rgb, pixels);
+            return;
+#endif
+        default:
+            rgbaToRgbScalar<Swap>(rgba, rgb, 0, pixels);
+            return;
+    }
+}
+
+template <bool Swap>
+void rgbToRgbaDispatch(const uchar *rgb, uchar *rgba, qsizetype pixels)
+{
+    switch (PixelKernels::activeIsa()) {
+#ifdef PIXELKERNELS_X86
+        case PixelKernels::Isa::AVX2:
+            rgbToRgbaAvx2<Swap>(rgb, rgba, pixels);
+            return;
+        case PixelKernels::Isa::SSE2:
+            rgbToRgbaSse2<Swap>(rgb, rgba, pixels);
+            return;
+#endif
+#ifdef PIXELKERNELS_NEON
+        case PixelKernels::Isa::NEON:
+            rgbToRgbaNeon<Swap>(rgb, rgba, pixels);
+            return;
+#endif
+        default:
+            rgbToRgbaScalar<Swap>(rgb, rgba, 0, pixels);
+            return;
+    }
+}
+
+}
+
+void PixelKernels::rgbaToRgb(const uchar *rgba, uchar *rgb, qsizetype pixels)
+{
+    rgbaToRgbDispatch<false>(rgba, rgb, pixels);
+}
+
+void PixelKernels::rgbaToBgr(const uchar *rgba, uchar *bgr, qsizetype pixels)
+{
+    rgbaToRgbDispatch<true>(rgba, bgr, pixels);
+}
+
+void PixelKernels::rgbToRgba(const uchar *rgb, uchar *rgba, qsizetype pixels)
+{
+    rgbToRgbaDispatch<false>(rgb, rgba, pixels);
+}
+
+void PixelKernels::bgrToRgba(const uchar *bgr, uchar *rgba, qsizetype pixels)
+{
+    rgbToRgbaDispatch<true>(bgr, rgba, pixels);
+}
+
+void PixelKernels::reduceTo8(const quint16 *samples, uchar *output, qsizetype count, int bits)
+{
+    bits = qBound(8, bits, 16);
+    switch (activeIsa()) {
+#ifdef PIXELKERNELS_X86
+        case Isa::AVX2:
+            reduceTo8Avx2(samples, output, count, bits);
+            return;
+        case Isa::SSE2:
+            reduceTo8Sse2(samples, output, count, bits);
+            return;
+#endif
+#ifdef PIXELKERNELS_NEON
+        case Isa::NEON:
+            reduceTo8Neon(samples, output, count, bits);
+            return;
+#endif
+        default:
+            reduceTo8Scalar(samples, output, 0, count, bits);
+            return;
+    }
+}
+
+bool PixelKernels::isGrayscale(const uchar *rgb, qsizetype pixels)
+{
+    switch (activeIsa()) {
+#ifdef PIXELKERNELS_X86
+        case Isa::AVX2:
+            return isGrayscaleAvx2(rgb, pixels);
+        case Isa::SSE2:
+            return isGrayscaleSse2(rgb, pixels);
+#endif
+#ifdef PIXELKERNELS_NEON
+        case Isa::NEON:
+            return isGrayscaleNeon(rgb, pixels);
+#endif
+        default:
+            return isGrayscaleScalar(rgb, 0, pixels);
+    }
+}
+
+bool PixelKernels::isOpaque(const uchar *rgba, qsizetype pixels)
+{
+    switch (activeIsa()) {
+#ifdef PIXELKERNELS_X86
+        case Isa::AVX2:
+            return isOpaqueAvx2(rgba, pixels);
+        case Isa::SSE2:
+            return isOpaqueSse2(rgba, pixels);
+#endif
+#ifdef PIXELKERNELS_NEON
+        case Isa::NEON:
+            return isOpaqueNeon(rgba, pixels);
+#endif
+        default:
+            return isOpaqueScalar(rgba, 0, pixels);
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef PIXELKERNELS_H
+#define PIXELKERNELS_H
+
+#include <QtGlobal>
+
+// Vectorized pixel loops for the in-process image path. The instruction set is
+// picked once at runtime (AVX2 or SSE2 on x86, NEON on ARM) and every kernel
+// produces exactly the same bytes as its scalar version.
+class PixelKernels
+{
+public:
+    enum class Isa {
+        Scalar,
+        SSE2,
+        AVX2,
+        NEON
+    };
+
+    // Composites RGBA over an opaque background and packs the result as RGB,
+    // rounding (c * a + bg * (255 - a)) / 255 to nearest.
+    // flattenAlpha, rgbaToRgb and rgbaToBgr may run in place (rgb == rgba):
+    // every path reads a pixel before writing over it. Other overlap is not
+    // supported.
+    static void flattenAlpha(const uchar *rgba, uchar *rgb, qsizetype pixels,
+                             uchar backgroundRed, uchar backgroundGreen, uchar backgroundBlue);
+
+    // Drops the alpha channel; the BGR variant also swaps red and blue
+    static void rgbaToRgb(const uchar *rgba, uchar *rgb, qsizetype pixels);
+    static void rgbaToBgr(const uchar *rgba, uchar *bgr, qsizetype pixels);
+    // Adds an opaque alpha channel; the BGR variant reads blue first
+    static void rgbToRgba(const uchar *rgb, uchar *rgba, qsizetype pixels);
+    static void bgrToRgba(const uchar *bgr, uchar *rgba, qsizetype pixels);
+
+    // Reduces samples of the given bit depth (9-16) to 8 bits; the sample is
+    // widened to 16 bits by bit replication and divided by 257 with rounding
+    static void reduceTo8(const quint16 *samples, uchar *output, qsizetype count, int bits);
+
+    // True when every RGB pixel has R == G == B
+    static bool isGrayscale(const uchar *rgb, qsizetype pixels);
+    // True when every RGBA pixel has alpha 255
+    static bool isOpaque(const uchar *rgba, qsizetype pixels);
+
+    // Best instruction set this CPU supports
+    static Isa supportedIsa();
+    static Isa activeIsa();
+    // Forces a level (clamped to what is supported), e.g. to compare against Scalar
+    static void setIsa(Isa isa);
+};
+
+#endif // PIXELKERNELS_H
@@ -0,0 +1,132 @@
+#include "Preflight.h"
+#include "ZipArchive.h"
+#include <QFile>
+#include <QThread>
+#include <QtEndian>
+
+namespace {
+// Read from each end of a PDF; trailers and the header sit well inside this
+constexpr qint64 ProbeSize = 64 * 1024;
+
+QString inspectPackage(QFile &file)
+{
+    // Password-protected Office files are an encrypted stream inside an OLE
+    // compound file rather than a ZIP
+    if (file.peek(4) == QByteArray("\xD0\xCF\x11\xE0", 4)) {
+        return "Document is password-protected";
+    }
+    ZipReader reader(file.fileName());
+    QString errorMessage;
+    if (!reader.open(&errorMessage)) {
+        return errorMessage;
+    }
+    for (const ZipReader::Entry &entry : reader.entries()) {
+        if (entry.name == "[Content_Types].xml") {
+            return QString();
+        }
+    }
+    return "Not an Office document (no [Content_Types].xml)";
+}
+
+QString inspectPdf(QFile &file, bool opensInLibreOffice)
+{
+    QByteArray head = file.read(ProbeSize);
+    if (!head.left(1024).contains("%PDF-")) {
+        return "Not a PDF (no %PDF header)";
+    }
+    qint64 tailSize = qMin(file.size(), ProbeSize);
+    file.seek(file.size() - tailSize);
+    QByteArray tail = file.read(tailSize);
+    if (!tail.contains("%%EOF")) {
+        return "PDF is truncated (no %%EOF)";
+    }
+    // The trailer (or a linearized file's first-page trailer) names the
+    // encryption dictionary. Poppler opens files that only restrict
+    // permissions; LibreOffice would sit on a password prompt instead.
+    if (opensInLibreOffice && (tail.contains("/Encrypt") || head.contains("/Encrypt"))) {
+        return "PDF is encrypted";
+    }
+    return QString();
+}
+
+QString inspectImage(QFile &file, Converter::FileFormat format)
+{
+    // Tools go by content, not by name, so any image header will do
+    Converter::FileFormat content = Converter::sniffFormat(&file);
+    if (content != Converter::FileFormat::JPG && content != Converter::FileFormat::PNG
+        && content != Converter::FileFormat::WEBP && content != Converter::FileFormat::HEIC) {
+        return "Not a " + Converter::formatToString(format) + " image (unknown header)";
+    }
+
+    QByteArray head = file.peek(24);
+    if (content == Converter::FileFormat::PNG) {
+        // IHDR is the first chunk and holds the size
+        if (head.size() < 24 || head.mid(12, 4) != "IHDR"
+            || qFromBigEndian<quint32>(head.constData() + 16) == 0
+            || qFromBigEndian<quint32>(head.constData() + 20) == 0) {
+            return "Damaged PNG header";
+        }
+    } else if (content == Converter::FileFormat::WEBP) {
+        if (qFromLittleEndian<quint32>(head.constData() + 4) + 8ULL > static_cast<quint64>(file.size())) {
+            return "WebP file is truncated";
+        }
+    }
+    return QString();
+}
+}
+
+Preflight::Preflight(QObject *parent)
+    : QObject(parent)
+{
+    // Checks wait on the disk, not the CPU; a few more than cores keeps a
+    // slow share busy
+    pool.setMaxThreadCount(QThread::idealThreadCount() * 2);
+}
+
+Preflight::~Preflight()
+{
+    pool.waitForDone();
+}
+
+void Preflight::check(const QString &inputPath, Converter::FileFormat sourceFormat,
+                      Converter::FileFormat targetFormat)
+{
+    pool.start([this, inputPath, sourceFormat, targetFormat]() {
+        QString reason = inspect(inputPath, sourceFormat, targetFormat);
+
+        // Report back on the thread that owns the checker
+        QMetaObject::invokeMethod(this, [this, inputPath, reason]() {
+            emit checked(inputPath, reason);
+        }, Qt::QueuedConnection);
+    });
+}
+
+QString Preflight::inspect(const QString &inputPath, Converter::FileFormat sourceFormat,
+                           Converter::FileFormat targetFormat)
+{
+    QFile file(inputPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return "Cannot open input: " + file.errorString();
+    }
+    // An empty CSV is an empty sheet
+    if (file.size() == 0 && sourceFormat != Converter::FileFormat::CSV) {
+        return "File is empty";
+    }
+
+    switch (sourceFormat) {
+        case Converter::FileFormat::DOCX:
+        case Converter::FileFormat::PPTX:
+        case Converter::FileFormat::XLSX:
+            return inspectPackage(file);
+        case Converter::FileFormat::PDF:
+            return inspectPdf(file, targetFormat == Converter::FileFormat::DOCX
+                                    || targetFormat == Converter::FileFormat::PPTX);
+        case Converter::FileFormat::JPG:
+        case Converter::FileFormat::PNG:
+        case Converter::FileFormat::WEBP:
+        case Converter::FileFormat::HEIC:
+            return inspectImage(file, sourceFormat);
+        default:
+            return QString();
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef PREFLIGHT_H
+#define PREFLIGHT_H
+
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include "Converter.h"
+
+// Rejects inputs that cannot convert before they take a conversion slot:
+// empty files, ZIP packages without an intact central directory, PDFs that
+// are truncated or need a password, and images whose header is not one.
+// Only the head and tail of a file are read (and a package's central
+// directory), on a pool of its own so queued files are checked side by side.
+class Preflight : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Preflight(QObject *parent = nullptr);
+    ~Preflight();
+
+    void check(const QString &inputPath, Converter::FileFormat sourceFormat, Converter::FileFormat targetFormat);
+
+    // Why the input cannot be converted, or an empty string
+    static QString inspect(const QString &inputPath, Converter::FileFormat sourceFormat,
+                           Converter::FileFormat targetFormat);
+
+signals:
+    // Empty reason when the input may be converted
+    void checked(const QString &inputPath, const QString &reason);
+
+private:
+    QThreadPool pool;
+};
+
+#endif // PREFLIGHT_H
@@ -0,0 +1,167 @@
+#include "RemoteJob.h"
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTimer>
+
+namespace {
+constexpr int ConnectTimeoutMs = 5000;
+}
+
+RemoteJob::RemoteJob(const WorkerEndpoint &endpoint, const QString &inputPath,
+                     const QString &targetExtension, const QString &resize, const QString &outputPath,
+                     QObject *parent)
+    : QObject(parent), endpoint(endpoint), inputPath(inputPath),
+      targetExtension(targetExtension), resize(resize), outputPath(outputPath),
+      inputSent(false), resultOk(false), done(false)
+{
+    socket = new QTcpSocket(this);
+    connect(socket, &QTcpSocket::connected, this, &RemoteJob::onConnected);
+    connect(socket, &QTcpSocket::readyRead, this, &RemoteJob::onReadyRead);
+    connect(socket, &QTcpSocket::bytesWritten, this, &RemoteJob::onBytesWritten);
+    connect(socket, &QTcpSocket::errorOccurred, this, &RemoteJob::onSocketError);
+    connect(socket, &QTcpSocket::disconnected, this, &RemoteJob::onDisconnected);
+
+    connectTimer = new QTimer(this);
+    connectTimer->setSingleShot(true);
+    connect(connectTimer, &QTimer::timeout, this, [this]() {
+        complete(false, true, "Timed out connecting to worker " + workerId());
+    });
+}
+
+QString RemoteJob::workerId() const
+{
+    return endpoint.id();
+}
+
+void RemoteJob::start()
+{
+    input.setFileName(inputPath);
+    if (!input.open(QIODevice::ReadOnly)) {
+        // Local problem, another worker would fail the same way
+        QMetaObject::invokeMethod(this, [this]() {
+            complete(false, false, "Could not read input: " + input.errorString());
+        }, Qt::QueuedConnection);
+        return;
+    }
+    connectTimer->start(ConnectTimeoutMs);
+    socket->connectToHost(endpoint.host, endpoint.port);
+}
+
+void RemoteJob::abort()
+{
+    complete(false, false, "Cancelled");
+}
+
+void RemoteJob::onConnected()
+{
+    connectTimer->stop();
+
+    QJsonObject submit;
+    submit["name"] = QFileInfo(inputPath).fileName();
+    submit["target"] = targetExtension;
+    if (!resize.isEmpty()) {
+        submit["resize"] = resize;
+    }
+    submit["size"] = input.size();
+    WorkerProtocol::writeFrame(socket, WorkerProtocol::Submit,
+                               QJsonDocument(submit).toJson(QJsonDocument::Compact));
+    pumpInput();
+}
+
+void RemoteJob::onBytesWritten()
+{
+    pumpInput();
+}
+
+void RemoteJob::pumpInput()
+{
+    // Keep only a few chunks in flight so large inputs are never fully buffered
+    while (!inputSent && !done && socket->bytesToWrite() < WorkerProtocol::MaxBufferedBytes) {
+        QByteArray chunk = input.read(WorkerProtocol::ChunkSize);
+        if (chunk.isEmpty()) {
+            input.close();
+            WorkerProtocol::writeFrame(socket, WorkerProtocol::EndOfInput);
+            inputSent = true;
+            break;
+        }
+        WorkerProtocol::writeFrame(socket, WorkerProtocol::Data, chunk);
+    }
+}
+
+void RemoteJob::onReadyRead()
+{
+    buffer.append(socket->readAll());
+
+    WorkerProtocol::FrameType type;
+    QByteArray payload;
+    bool error = false;
+    while (!done && WorkerProtocol::takeFrame(buffer, &type, &payload, &error)) {
+        handleFrame(type, payload);
+    }
+    if (error) {
+        complete(false, true, "Malformed response from worker " + workerId());
+    }
+}
+
+void RemoteJob::handleFrame(WorkerProtocol::FrameType type, const QByteArray &payload)
+{
+    switch (type) {
+        case WorkerProtocol::Result: {
+            QJsonObject result = QJsonDocument::fromJson(payload).object();
+            if (!result["ok"].toBool()) {
+                complete(false, result["retryable"].toBool(), result["error"].toString());
+                return;
+            }
+            output.setFileName(outputPath);
+            if (!output.open(QIODevice::WriteOnly)) {
+                complete(false, false, "Could not write output: " + output.errorString());
+                return;
+            }
+            resultOk = true;
+            break;
+        }
+        case WorkerProtocol::Data:
+            if (!resultOk || output.write(payload) != payload.size()) {
+                complete(false, false, "Could not write output: " + output.errorString());
+            }
+            break;
+        case WorkerProtocol::EndOfOutput:
+            if (resultOk) {
+                output.close();
+                complete(true, false, QString());
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void RemoteJob::onSocketError(QAbstractSocket::SocketError error)
+{
+    Q_UNUSED(error);
+    complete(false, true, QString("Worker %1: %2").arg(workerId(), socket->errorString()));
+}
+
+void RemoteJob::onDisconnected()
+{
+    complete(false, true, QString("Worker %1 closed the connection").arg(workerId()));
+}
+
+void RemoteJob::complete(bool ok, bool retryable, const QString &errorMessage)
+{
+    if (done) {
+        return;
+    }
+    done = true;
+    connectTimer->stop();
+    input.close();
+    if (output.isOpen()) {
+        output.close();
+    }
+    if (!ok) {
+        output.remove();
+    }
+    socket->abort();
+    emit finished(ok, retryable, errorMessage);
+}
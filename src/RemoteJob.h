@@ -0,0 +1,59 @@
+#ifndef REMOTEJOB_H
+#define REMOTEJOB_H
+
+#include <QObject>
+#include <QFile>
+#include <QTcpSocket>
+#include "WorkerProtocol.h"
+
+class QTimer;
+
+// One conversion running on a remote worker: streams the input over the
+// connection and writes the returned output to outputPath.
+class RemoteJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    // resize: Converter::ResizeOptions in its string form, empty for none
+    RemoteJob(const WorkerEndpoint &endpoint, const QString &inputPath,
+              const QString &targetExtension, const QString &resize, const QString &outputPath,
+              QObject *parent = nullptr);
+
+    void start();
+    void abort();
+    QString workerId() const;
+
+signals:
+    // retryable: the worker or connection failed, not the conversion itself
+    void finished(bool ok, bool retryable, const QString &errorMessage);
+
+private slots:
+    void onConnected();
+    void onReadyRead();
+    void onBytesWritten();
+    void onSocketError(QAbstractSocket::SocketError error);
+    void onDisconnected();
+
+private:
+    void pumpInput();
+    void handleFrame(WorkerProtocol::FrameType type, const QByteArray &payload);
+    void complete(bool ok, bool retryable, const QString &errorMessage);
+
+    WorkerEndpoint endpoint;
+    QString inputPath;
+    QString targetExtension;
+    QString resize;
+    QString outputPath;
+
+    QTcpSocket *socket;
+    QTimer *connectTimer;
+    QFile input;
+    QFile output;
+    QByteArray buffer;
+    bool inputSent;
+    bool resultOk;
+    bool done;
+};
+
+#endif // REMOTEJOB_H
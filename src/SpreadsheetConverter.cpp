@@ -0,0 +1,793 @@
+#include "SpreadsheetConverter.h"
+#include "ZipArchive.h"
+#include <QBuffer>
+#include <QDate>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QStringList>
+#include <QThread>
+#include <QXmlStreamReader>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+namespace {
+constexpr qint64 ReadChunkSize = 64 * 1024;
+constexpr qsizetype FlushSize = 1024 * 1024;
+// Excel's sheet size
+constexpr int MaxRows = 1048576;
+constexpr int MaxColumns = 16384;
+// Digits a double holds exactly; longer numbers (IDs, card numbers) stay text
+constexpr int MaxNumberDigits = 15;
+// Serial of 9999-12-31, the last day a sheet can show
+constexpr double MaxDateSerial = 2958465;
+
+const char *const DefaultSheetPath = "xl/worksheets/sheet1.xml";
+
+const char *const ContentTypesXml =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+    "<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">"
+    "<Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\"/>"
+    "<Default Extension=\"xml\" ContentType=\"application/xml\"/>"
+    "<Override PartName=\"/xl/workbook.xml\" "
+    "ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.sheet.main+xml\"/>"
+    "<Override PartName=\"/xl/worksheets/sheet1.xml\" "
+    "ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.worksheet+xml\"/>"
+    "</Types>";
+
+const char *const PackageRelationshipsXml =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+    "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+    "<Relationship Id=\"rId1\" "
+    "Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/officeDocument\" "
+    "Target=\"xl/workbook.xml\"/>"
+    "</Relationships>";
+
+// %1: sheet name
+const char *const WorkbookXml =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+    "<workbook xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\" "
+    "xmlns:r=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships\">"
+    "<sheets><sheet name=\"%1\" sheetId=\"1\" r:id=\"rId1\"/></sheets>"
+    "</workbook>";
+
+const char *const WorkbookRelationshipsXml =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+    "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+    "<Relationship Id=\"rId1\" "
+    "Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/worksheet\" "
+    "Target=\"worksheets/sheet1.xml\"/>"
+    "</Relationships>";
+
+const char *const SheetHeaderXml =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+    "<worksheet xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\"><sheetData>";
+
+const char *const SheetFooterXml = "</sheetData></worksheet>";
+
+const ZipReader::Entry *findEntry(const ZipReader &reader, const QString &name)
+{
+    for (const ZipReader::Entry &entry : reader.entries()) {
+        if (entry.name.compare(name, Qt::CaseInsensitive) == 0) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+// Streams a part through handler, called after every token; the handler may
+// read further itself or stop with raiseError(). A missing part is no error.
+bool readPart(const ZipReader &reader, const QString &name,
+              const std::function<void(QXmlStreamReader &)> &handler, QString *errorMessage)
+{
+    const ZipReader::Entry *entry = findEntry(reader, name);
+    if (!entry) {
+        return true;
+    }
+    ZipEntryDevice device(reader.path(), *entry);
+    if (!device.open(QIODevice::ReadOnly)) {
+        *errorMessage = "Cannot read " + name + ": " + device.errorString();
+        return false;
+    }
+    QXmlStreamReader xml(&device);
+    while (!xml.atEnd()) {
+        xml.readNext();
+        handler(xml);
+    }
+    if (xml.hasError()) {
+        *errorMessage = "Cannot read " + name + ": " + xml.errorString();
+        return false;
+    }
+    return true;
+}
+
+// Text of an <si> or <is> element: its <t>, or the <t> of each run, without
+// phonetic hints (<rPh>)
+QString readRichText(QXmlStreamReader &xml)
+{
+    QString text;
+    while (xml.readNextStartElement()) {
+        if (xml.name() == QLatin1String("t")) {
+            text += xml.readElementText();
+        } else if (xml.name() == QLatin1String("r")) {
+            text += readRichText(xml);
+        } else {
+            xml.skipCurrentElement();
+        }
+    }
+    return text;
+}
+
+// "AB12" -> column 27 (zero-based) and row 12; -1 for a part that is missing
+void parseCellReference(QStringView reference, int *column, int *row)
+{
+    int letters = 0;
+    int number = 0;
+    while (letters < reference.size() && reference[letters].isLetter() && number <= MaxColumns) {
+        number = number * 26 + (reference[letters].toUpper().unicode() - 'A' + 1);
+        letters++;
+    }
+    *column = letters > 0 ? number - 1 : -1;
+    bool ok = false;
+    *row = reference.mid(letters).toInt(&ok);
+    if (!ok) {
+        *row = -1;
+    }
+}
+
+QByteArray columnName(int column)
+{
+    QByteArray name;
+    for (int number = column + 1; number > 0; number = (number - 1) / 26) {
+        name.prepend(static_cast<char>('A' + (number - 1) % 26));
+    }
+    return name;
+}
+
+// Whether a number format shows a date or time: a built-in date format, or a
+// code with date or time parts outside quotes, escapes and [brackets]
+bool isDateFormat(int id, const QString &code)
+{
+    if ((id >= 14 && id <= 22) || (id >= 45 && id <= 47)) {
+        return true;
+    }
+    bool quoted = false;
+    bool bracketed = false;
+    for (qsizetype i = 0; i < code.size(); ++i) {
+        QChar c = code[i];
+        if (quoted) {
+            quoted = c != '"';
+        } else if (bracketed) {
+            bracketed = c != ']';
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == '[') {
+            bracketed = true;
+        } else if (c == '\\' || c == '_' || c == '*') {
+            ++i;    // Escaped, spacing or fill character
+        } else if (QStringLiteral("yYmMdDhHsS").contains(c)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// A date serial as ISO 8601 text: 2024-03-01, 13:30:00 or both. The 1900
+// system counts a 29 February 1900 that never was, so serials before it
+// are counted from one day later.
+QString serialToDateText(const QString &value, bool date1904)
+{
+    bool ok = false;
+    double serial = value.toDouble(&ok);
+    if (!ok || serial < 0 || serial > MaxDateSerial) {
+        return value;
+    }
+    qint64 seconds = qRound64(serial * 86400.0);
+    QDate base = date1904 ? QDate(1904, 1, 1) : QDate(1899, 12, serial < 60 ? 31 : 30);
+    QDate date = base.addDays(seconds / 86400);
+    QTime time = QTime(0, 0).addSecs(static_cast<int>(seconds % 86400));
+    if (serial < 1) {
+        return time.toString("HH:mm:ss");
+    }
+    if (seconds % 86400 == 0) {
+        return date.toString("yyyy-MM-dd");
+    }
+    return date.toString("yyyy-MM-dd") + " " + time.toString("HH:mm:ss");
+}
+
+void appendCsvField(QByteArray &out, const QString &value)
+{
+    QByteArray bytes = value.toUtf8();
+    // Quoted when it holds a delimiter, quote or line break, or has spaces
+    // at either end that a reader might trim
+    bool quote = !bytes.isEmpty() && (bytes.front() == ' ' || bytes.back() == ' ');
+    for (char c : bytes) {
+        if (c == ',' || c == '"' || c == '\n' || c == '\r') {
+            quote = true;
+            break;
+        }
+    }
+    if (!quote) {
+        out += bytes;
+        return;
+    }
+    out += '"';
+    out += bytes.replace("\"", "\"\"");
+    out += '"';
+}
+
+// Escapes text for an XML element. Control characters XML 1.0 cannot hold
+// are dropped and bytes that are not UTF-8 become U+FFFD.
+void appendXmlText(QByteArray &out, const QByteArray &text)
+{
+    bool ascii = true;
+    for (char c : text) {
+        if (static_cast<uchar>(c) >= 0x80) {
+            ascii = false;
+            break;
+        }
+    }
+    const QByteArray utf8 = ascii ? text : QString::fromUtf8(text).toUtf8();
+
+    qsizetype start = 0;
+    for (qsizetype i = 0; i < utf8.size(); ++i) {
+        uchar c = static_cast<uchar>(utf8[i]);
+        const char *escape = nullptr;
+        if (c == '&') {
+            escape = "&amp;";
+        } else if (c == '<') {
+            escape = "&lt;";
+        } else if (c == '>') {
+            escape = "&gt;";
+        } else if (c < 0x20 && c != '\t' && c != '\n' && c != '\r') {
+            escape = "";
+        } else {
+            continue;
+        }
+        out.append(utf8.constData() + start, i - start);
+        out += escape;
+        start = i + 1;
+    }
+    out.append(utf8.constData() + start, utf8.size() - start);
+}
+
+// Numbers a spreadsheet reads back unchanged: an optional minus, no leading
+// zeros (ZIP codes, IDs), at most 15 digits and an optional exponent
+bool isPlainNumber(const QByteArray &field)
+{
+    auto digitsFrom = [&field](qsizetype i) {
+        qsizetype end = i;
+        while (end < field.size() && field[end] >= '0' && field[end] <= '9') {
+            end++;
+        }
+        return end - i;
+    };
+
+    qsizetype i = field.startsWith('-') ? 1 : 0;
+    qsizetype integerDigits = digitsFrom(i);
+    if (integerDigits == 0 || (integerDigits > 1 && field[i] == '0')) {
+        return false;
+    }
+    qsizetype digits = integerDigits;
+    i += integerDigits;
+    if (i < field.size() && field[i] == '.') {
+        qsizetype fractionDigits = digitsFrom(++i);
+        if (fractionDigits == 0) {
+            return false;
+        }
+        digits += fractionDigits;
+        i += fractionDigits;
+    }
+    if (i < field.size() && (field[i] == 'e' || field[i] == 'E')) {
+        if (++i < field.size() && (field[i] == '+' || field[i] == '-')) {
+            i++;
+        }
+        qsizetype exponentDigits = digitsFrom(i);
+        if (exponentDigits == 0) {
+            return false;
+        }
+        i += exponentDigits;
+    }
+    if (i != field.size() || digits > MaxNumberDigits) {
+        return false;
+    }
+    bool ok = false;
+    return std::isfinite(field.toDouble(&ok)) && ok;
+}
+
+// The delimiter is whichever of , ; and tab the first line uses most outside
+// quotes, or a comma if it uses none
+char sniffDelimiter(const QByteArray &head)
+{
+    int commas = 0;
+    int semicolons = 0;
+    int tabs = 0;
+    bool quoted = false;
+    for (char c : head) {
+        if (c == '"') {
+            quoted = !quoted;
+        } else if (quoted) {
+            continue;
+        } else if (c == '\n' || c == '\r') {
+            break;
+        } else if (c == ',') {
+            commas++;
+        } else if (c == ';') {
+            semicolons++;
+        } else if (c == '\t') {
+            tabs++;
+        }
+    }
+    if (semicolons > commas && semicolons >= tabs) {
+        return ';';
+    }
+    return tabs > commas ? '\t' : ',';
+}
+
+// Sheet names have at most 31 characters, none of []:*?/\ and no
+// apostrophe at either end
+QString sheetName(const QString &inputPath)
+{
+    QString name = QFileInfo(inputPath).completeBaseName();
+    for (QChar c : QStringLiteral("[]:*?/\\")) {
+        name.remove(c);
+    }
+    name = name.left(31).trimmed();
+    while (name.startsWith('\'')) {
+        name.remove(0, 1);
+    }
+    while (name.endsWith('\'')) {
+        name.chop(1);
+    }
+    return name.isEmpty() ? QString("Sheet1") : name;
+}
+
+// Reads RFC 4180 records a block at a time. Quoted fields may hold
+// delimiters, doubled quotes and line breaks; a UTF-8 BOM is skipped.
+class CsvReader
+{
+public:
+    CsvReader(QIODevice *device, char delimiter)
+        : device(device), delimiter(delimiter), pos(0), atStart(true)
+    {
+    }
+
+    // False at the end of the input
+    bool readRecord(QList<QByteArray> *fields)
+    {
+        fields->clear();
+        if (pos >= buffer.size() && !fill()) {
+            return false;
+        }
+
+        QByteArray field;
+        bool inQuotes = false;
+        while (true) {
+            if (pos >= buffer.size() && !fill()) {
+                *fields << field;
+                return true;
+            }
+            if (inQuotes) {
+                qsizetype quote = buffer.indexOf('"', pos);
+                qsizetype end = quote == -1 ? buffer.size() : quote;
+                field.append(buffer.constData() + pos, end - pos);
+                pos = end;
+                if (quote == -1) {
+                    continue;
+                }
+                // A doubled quote is a literal one, a single one closes the field
+                pos++;
+                if ((pos < buffer.size() || fill()) && buffer[pos] == '"') {
+                    field += '"';
+                    pos++;
+                } else {
+                    inQuotes = false;
+                }
+                continue;
+            }
+
+            char c = buffer[pos++];
+            if (c == delimiter) {
+                *fields << field;
+                field.clear();
+            } else if (c == '\n') {
+                *fields << field;
+                return true;
+            } else if (c == '\r') {
+                if ((pos < buffer.size() || fill()) && buffer[pos] == '\n') {
+                    pos++;
+                }
+                *fields << field;
+                return true;
+            } else if (c == '"' && field.isEmpty()) {
+                inQuotes = true;
+            } else {
+                field += c;
+            }
+        }
+    }
+
+private:
+    bool fill()
+    {
+        buffer = device->read(ReadChunkSize);
+        pos = 0;
+        if (atStart && buffer.startsWith("\xEF\xBB\xBF")) {
+            pos = 3;
+        }
+        atStart = false;
+        return pos < buffer.size() || (pos > 0 && fill());
+    }
+
+    QIODevice *device;
+    char delimiter;
+    QByteArray buffer;
+    qsizetype pos;
+    bool atStart;
+};
+
+// Sheet XML generated from CSV records as ZipWriter reads it. Strings are
+// written inline, so no table of them builds up.
+class CsvSheetDevice : public QIODevice
+{
+public:
+    CsvSheetDevice(QIODevice *csv, char delimiter)
+        : reader(csv, delimiter), pending(SheetHeaderXml), pendingPos(0), rows(0), ended(false)
+    {
+    }
+
+    bool isSequential() const override { return true; }
+    // Set when the CSV does not fit in a sheet; the XML stops there
+    QString errorMessage() const { return error; }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override
+    {
+        if (!error.isEmpty()) {
+            return -1;
+        }
+        pending.remove(0, pendingPos);
+        pendingPos = 0;
+        while (pending.size() < maxSize && !ended) {
+            if (!reader.readRecord(&fields)) {
+                pending += SheetFooterXml;
+                ended = true;
+            } else if (!appendRow()) {
+                return -1;
+            }
+        }
+        qint64 count = qMin<qint64>(maxSize, pending.size());
+        if (count == 0) {
+            return -1;
+        }
+        std::memcpy(data, pending.constData(), count);
+        pendingPos = count;
+        return count;
+    }
+
+    qint64 writeData(const char *, qint64) override { return -1; }
+
+private:
+    bool appendRow()
+    {
+        if (++rows > MaxRows) {
+            error = QString("CSV has more than %1 rows, the most a sheet holds").arg(MaxRows);
+            return false;
+        }
+        if (fields.size() > MaxColumns) {
+            error = QString("Row %1 has more than %2 fields, the most a sheet holds").arg(rows).arg(MaxColumns);
+            return false;
+        }
+
+        QByteArray row = QByteArray::number(rows);
+        pending += "<row r=\"" + row + "\">";
+        for (int i = 0; i < fields.size(); ++i) {
+            const QByteArray &field = fields[i];
+            if (field.isEmpty()) {
+                continue;
+            }
+            pending += "<c r=\"" + columnName(i) + row;
+            if (isPlainNumber(field)) {
+                pending += "\"><v>" + field + "</v></c>";
+            } else {
+                pending += "\" t=\"inlineStr\"><is><t xml:space=\"preserve\">";
+                appendXmlText(pending, field);
+                pending += "</t></is></c>";
+            }
+        }
+        pending += "</row>";
+        return true;
+    }
+
+    CsvReader reader;
+    QList<QByteArray> fields;
+    QByteArray pending;
+    qsizetype pendingPos;
+    int rows;
+    bool ended;
+    QString error;
+};
+
+// Path of the first worksheet and the workbook's date system
+bool readWorkbook(const ZipReader &reader, QString *sheetPath, bool *date1904, QString *errorMessage)
+{
+    QString relationshipId;
+    bool ok = readPart(reader, "xl/workbook.xml", [&](QXmlStreamReader &xml) {
+        if (!xml.isStartElement()) {
+            return;
+        }
+        if (xml.name() == QLatin1String("workbookPr")) {
+            QString value = xml.attributes().value("date1904").toString();
+            *date1904 = value == "1" || value == "true";
+        } else if (xml.name() == QLatin1String("sheet") && relationshipId.isEmpty()) {
+            // r:id, whichever namespace the r prefix stands for
+            const QXmlStreamAttributes attributes = xml.attributes();
+            for (const QXmlStreamAttribute &attribute : attributes) {
+                if (attribute.name() == QLatin1String("id")) {
+                    relationshipId = attribute.value().toString();
+                }
+            }
+        }
+    }, errorMessage);
+
+    QString target;
+    ok = ok && readPart(reader, "xl/_rels/workbook.xml.rels", [&](QXmlStreamReader &xml) {
+        if (xml.isStartElement() && xml.name() == QLatin1String("Relationship")
+            && xml.attributes().value("Id") == relationshipId) {
+            target = xml.attributes().value("Target").toString();
+        }
+    }, errorMessage);
+    if (!ok) {
+        return false;
+    }
+
+    // Targets are relative to xl/ unless they start at the package root
+    if (target.isEmpty()) {
+        *sheetPath = DefaultSheetPath;
+    } else if (target.startsWith('/')) {
+        *sheetPath = target.mid(1);
+    } else {
+        *sheetPath = QDir::cleanPath("xl/" + target);
+    }
+    return true;
+}
+
+bool readSharedStrings(const ZipReader &reader, QStringList *strings, QString *errorMessage)
+{
+    return readPart(reader, "xl/sharedStrings.xml", [strings](QXmlStreamReader &xml) {
+        if (xml.isStartElement() && xml.name() == QLatin1String("si")) {
+            *strings << readRichText(xml);
+        }
+    }, errorMessage);
+}
+
+// For each cell format (the s attribute of a cell), whether it shows a date
+bool readDateStyles(const ZipReader &reader, QList<bool> *dateStyles, QString *errorMessage)
+{
+    QHash<int, QString> customFormats;
+    bool inCellFormats = false;
+    return readPart(reader, "xl/styles.xml", [&](QXmlStreamReader &xml) {
+        if (xml.isEndElement() && xml.name() == QLatin1String("cellXfs")) {
+            inCellFormats = false;
+        }
+        if (!xml.isStartElement()) {
+            return;
+        }
+        if (xml.name() == QLatin1String("numFmt")) {
+            customFormats[xml.attributes().value("numFmtId").toInt()]
+                = xml.attributes().value("formatCode").toString();
+        } else if (xml.name() == QLatin1String("cellXfs")) {
+            inCellFormats = true;
+        } else if (xml.name() == QLatin1String("xf") && inCellFormats) {
+            int id = xml.attributes().value("numFmtId").toInt();
+            *dateStyles << isDateFormat(id, customFormats.value(id));
+        }
+    }, errorMessage);
+}
+}
+
+SpreadsheetConverter::SpreadsheetConverter(QObject *parent)
+    : QObject(parent)
+{
+    // Each job holds one thread; the converter's slots limit how many run
+    pool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+SpreadsheetConverter::~SpreadsheetConverter()
+{
+    pool.waitForDone();
+}
+
+void SpreadsheetConverter::convert(const QString &jobId, const QString &inputPath, const QString &outputPath,
+                                   Converter::FileFormat targetFormat)
+{
+    pool.start([this, jobId, inputPath, outputPath, targetFormat]() {
+        QString errorMessage = targetFormat == Converter::FileFormat::CSV ? xlsxToCsv(inputPath, outputPath)
+                                                                          : csvToXlsx(inputPath, outputPath);
+
+        // Report back on the thread that owns the converter
+        QMetaObject::invokeMethod(this, [this, jobId, errorMessage]() {
+            emit converted(jobId, errorMessage);
+        }, Qt::QueuedConnection);
+    });
+}
+
+QString SpreadsheetConverter::xlsxToCsv(const QString &inputPath, const QString &outputPath)
+{
+    ZipReader reader(inputPath);
+    QString errorMessage;
+    if (!reader.open(&errorMessage)) {
+        return errorMessage;
+    }
+
+    QString sheetPath;
+    bool date1904 = false;
+    QStringList sharedStrings;
+    QList<bool> dateStyles;
+    if (!readWorkbook(reader, &sheetPath, &date1904, &errorMessage)
+        || !readSharedStrings(reader, &sharedStrings, &errorMessage)
+        || !readDateStyles(reader, &dateStyles, &errorMessage)) {
+        return errorMessage;
+    }
+    if (!findEntry(reader, sheetPath)) {
+        return "Workbook has no worksheet " + sheetPath;
+    }
+
+    QFile file(outputPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return "Cannot create output: " + file.errorString();
+    }
+
+    // Cells are placed by their references, so gaps in the sheet stay gaps
+    // in the CSV; every record has as many fields as <dimension> says
+    QByteArray buffer;
+    QString writeError;
+    int width = 0;
+    int row = 0;        // Last row written
+    int column = 0;     // Fields written in the current row
+    auto padTo = [&](int columns) {
+        for (; column < columns; ++column) {
+            if (column > 0) {
+                buffer += ',';
+            }
+        }
+    };
+    auto endRecord = [&](QXmlStreamReader &xml) {
+        padTo(width);
+        buffer += "\r\n";
+        column = 0;
+        if (buffer.size() >= FlushSize) {
+            if (file.write(buffer) != buffer.size()) {
+                writeError = "Cannot write output: " + file.errorString();
+                xml.raiseError(writeError);
+            }
+            buffer.clear();
+        }
+    };
+
+    bool ok = readPart(reader, sheetPath, [&](QXmlStreamReader &xml) {
+        if (xml.isEndElement() && xml.name() == QLatin1String("row")) {
+            endRecord(xml);
+            return;
+        }
+        if (!xml.isStartElement()) {
+            return;
+        }
+
+        if (xml.name() == QLatin1String("dimension")) {
+            QString reference = xml.attributes().value("ref").toString();
+            int last = -1;
+            int unused = -1;
+            parseCellReference(QStringView(reference).mid(reference.indexOf(':') + 1), &last, &unused);
+            width = qBound(0, last + 1, MaxColumns);
+        } else if (xml.name() == QLatin1String("row")) {
+            int number = xml.attributes().value("r").toInt();
+            if (number <= row) {
+                number = row + 1;
+            }
+            while (row + 1 < number) {
+                ++row;
+                endRecord(xml);
+            }
+            row = number;
+        } else if (xml.name() == QLatin1String("c")) {
+            int index = -1;
+            int unused = -1;
+            parseCellReference(xml.attributes().value("r"), &index, &unused);
+            QString type = xml.attributes().value("t").toString();
+            int style = xml.attributes().value("s").toInt();
+
+            QString value;
+            while (xml.readNextStartElement()) {
+                if (xml.name() == QLatin1String("v")) {
+                    value = xml.readElementText();
+                } else if (xml.name() == QLatin1String("is")) {
+                    value = readRichText(xml);
+                } else {
+                    xml.skipCurrentElement();   // Formulas and extensions
+                }
+            }
+
+            if (type == "s") {
+                bool indexOk = false;
+                int stringIndex = value.toInt(&indexOk);
+                if (!indexOk || stringIndex < 0 || stringIndex >= sharedStrings.size()) {
+                    xml.raiseError("Shared string " + value + " does not exist");
+                    return;
+                }
+                value = sharedStrings[stringIndex];
+            } else if (type == "b") {
+                value = value == "1" ? "TRUE" : "FALSE";
+            } else if ((type.isEmpty() || type == "n") && style >= 0 && style < dateStyles.size()
+                       && dateStyles[style] && !value.isEmpty()) {
+                value = serialToDateText(value, date1904);
+            }
+
+            // Cells without a reference, or out of order, follow the previous one
+            padTo(qMax(index, column));
+            if (column > 0) {
+                buffer += ',';
+            }
+            appendCsvField(buffer, value);
+            column++;
+        }
+    }, &errorMessage);
+    if (!writeError.isEmpty()) {
+        return writeError;
+    }
+    if (!ok) {
+        return errorMessage;
+    }
+    if (file.write(buffer) != buffer.size() || !file.flush()) {
+        return "Cannot write output: " + file.errorString();
+    }
+    return QString();
+}
+
+QString SpreadsheetConverter::csvToXlsx(const QString &inputPath, const QString &outputPath)
+{
+    QFile input(inputPath);
+    if (!input.open(QIODevice::ReadOnly)) {
+        return "Cannot open input: " + input.errorString();
+    }
+    QFile file(outputPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return "Cannot create output: " + file.errorString();
+    }
+
+    // The smallest package Excel and LibreOffice open: one sheet, no styles
+    const QList<QPair<QString, QByteArray>> parts = {
+        {"[Content_Types].xml", ContentTypesXml},
+        {"_rels/.rels", PackageRelationshipsXml},
+        {"xl/workbook.xml", QString(WorkbookXml).arg(sheetName(inputPath).toHtmlEscaped()).toUtf8()},
+        {"xl/_rels/workbook.xml.rels", WorkbookRelationshipsXml},
+    };
+    ZipWriter writer(&file);
+    QString errorMessage;
+    for (const auto &part : parts) {
+        QBuffer buffer;
+        buffer.setData(part.second);
+        buffer.open(QIODevice::ReadOnly);
+        if (!writer.addEntry(part.first, &buffer, &errorMessage, true)) {
+            return errorMessage;
+        }
+    }
+
+    CsvSheetDevice sheet(&input, sniffDelimiter(input.peek(ReadChunkSize)));
+    sheet.open(QIODevice::ReadOnly);
+    if (!writer.addEntry(DefaultSheetPath, &sheet, &errorMessage, true)) {
+        return errorMessage;
+    }
+    if (!sheet.errorMessage().isEmpty()) {
+        return sheet.errorMessage();
+    }
+    if (!writer.finish(&errorMessage)) {
+        return errorMessage;
+    }
+    if (!file.flush()) {
+        return "Cannot write output: " + file.errorString();
+    }
+    return QString();
+}
@@ -0,0 +1,37 @@
+#ifndef SPREADSHEETCONVERTER_H
+#define SPREADSHEETCONVERTER_H
+
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include "Converter.h"
+
+// XLSX <-> CSV without LibreOffice, on a worker thread. The sheet XML is
+// parsed or generated as it streams through the ZIP entry, one row at a
+// time, so the size of the sheet does not matter. Only the first worksheet
+// of a workbook is converted; its shared strings are the one part held in
+// memory.
+class SpreadsheetConverter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SpreadsheetConverter(QObject *parent = nullptr);
+    ~SpreadsheetConverter();
+
+    // targetFormat is CSV for an XLSX input and XLSX for a CSV input
+    void convert(const QString &jobId, const QString &inputPath, const QString &outputPath,
+                 Converter::FileFormat targetFormat);
+
+signals:
+    // Empty errorMessage on success
+    void converted(const QString &jobId, const QString &errorMessage);
+
+private:
+    static QString xlsxToCsv(const QString &inputPath, const QString &outputPath);
+    static QString csvToXlsx(const QString &inputPath, const QString &outputPath);
+
+    QThreadPool pool;
+};
+
+#endif // SPREADSHEETCONVERTER_H
@@ -0,0 +1,78 @@
+#include "ThroughputStats.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+ThroughputStats::ThroughputStats(const QString &path)
+    : statsPath(path), dirty(false)
+{
+}
+
+bool ThroughputStats::load()
+{
+    models.clear();
+    dirty = false;
+
+    QFile file(statsPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    // One model per line: key, then its fitted sums
+    while (!file.atEnd()) {
+        QList<QByteArray> fields = file.readLine().trimmed().split('\t');
+        if (fields.size() != 2) {
+            continue;
+        }
+        bool ok = false;
+        CostModel model = CostModel::fromString(QString::fromLatin1(fields[1]), &ok);
+        if (ok) {
+            models.insert(QString::fromLatin1(fields[0]), model);
+        }
+    }
+    return true;
+}
+
+bool ThroughputStats::save()
+{
+    if (!dirty || statsPath.isEmpty()) {
+        return true;
+    }
+
+    QDir().mkpath(QFileInfo(statsPath).absolutePath());
+    QSaveFile file(statsPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    for (auto it = models.constBegin(); it != models.constEnd(); ++it) {
+        file.write(it.key().toLatin1() + '\t' + it.value().toString().toLatin1() + '\n');
+    }
+
+    if (!file.commit()) {
+        return false;
+    }
+    dirty = false;
+    return true;
+}
+
+bool ThroughputStats::isDirty() const
+{
+    return dirty;
+}
+
+CostModel ThroughputStats::model(const QString &key, const CostModel &seed) const
+{
+    return models.value(key, seed);
+}
+
+void ThroughputStats::record(const QString &key, const CostModel &seed, qint64 inputBytes, qint64 elapsedMs)
+{
+    auto it = models.find(key);
+    if (it == models.end()) {
+        it = models.insert(key, seed);
+    }
+    it.value().record(inputBytes, elapsedMs);
+    dirty = true;
+}
@@ -0,0 +1,30 @@
+#ifndef THROUGHPUTSTATS_H
+#define THROUGHPUTSTATS_H
+
+#include <QString>
+#include <QHash>
+#include "CostModel.h"
+
+// Run time against input size per backend and format pair, kept across runs
+// so routing, job estimates and the ETA start from what this machine did
+// before rather than from seed figures.
+class ThroughputStats
+{
+public:
+    explicit ThroughputStats(const QString &path = QString());
+
+    bool load();
+    bool save();
+    bool isDirty() const;
+
+    // The model recorded under key, or seed when nothing was yet
+    CostModel model(const QString &key, const CostModel &seed) const;
+    void record(const QString &key, const CostModel &seed, qint64 inputBytes, qint64 elapsedMs);
+
+private:
+    QString statsPath;
+    QHash<QString, CostModel> models;
+    bool dirty;
+};
+
+#endif // THROUGHPUTSTATS_H
@@ -0,0 +1,220 @@
+#include "TraceRecorder.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+
+namespace {
+constexpr int BufferEvents = 1024;
+// About 100 MB of events; a longer run keeps its beginning
+constexpr qint64 MaxEvents = 1 << 20;
+constexpr int ThreadLaneBase = 1000;
+constexpr qint64 WriteChunkSize = 1024 * 1024;
+
+std::atomic<quint64> recorderSerial(0);
+
+// Per thread: the buffer it appends to for the recorder it last used
+struct ThreadCache {
+    quint64 recorder = 0;
+    void *buffer = nullptr;
+    int lane = 0;
+};
+thread_local ThreadCache threadCache;
+
+void appendJsonString(QByteArray &out, const QString &text)
+{
+    QString escaped;
+    escaped.reserve(text.size() + 2);
+    escaped += '"';
+    for (QChar c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c.unicode() < 0x20) {
+            escaped += QString::asprintf("\\u%04x", c.unicode());
+        } else {
+            escaped += c;
+        }
+    }
+    escaped += '"';
+    out += escaped.toUtf8();
+}
+
+QString laneName(int lane)
+{
+    if (lane == TraceRecorder::SchedulerLane) {
+        return "Scheduler";
+    }
+    if (lane >= ThreadLaneBase) {
+        return QString("Thread %1").arg(lane - ThreadLaneBase + 1);
+    }
+    return QString("Slot %1").arg(lane);
+}
+}
+
+// Written only by its thread; count is published after each event, so a
+// reader sees complete events only
+struct TraceRecorder::Buffer {
+    Buffer *next;
+    std::atomic<int> count;
+    Event events[BufferEvents];
+};
+
+TraceRecorder::TraceRecorder()
+    : serial(++recorderSerial), origin(std::chrono::steady_clock::now()), buffers(nullptr),
+      threadLanes(0), nextId(1), recorded(0), droppedEvents(0)
+{
+}
+
+TraceRecorder::~TraceRecorder()
+{
+    // Recording threads must be done by now (the publisher's pool is)
+    Buffer *buffer = buffers.load(std::memory_order_acquire);
+    while (buffer) {
+        Buffer *next = buffer->next;
+        delete buffer;
+        buffer = next;
+    }
+}
+
+qint64 TraceRecorder::nowUs() const
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+void TraceRecorder::span(const char *name, const char *category, int lane, qint64 startUs, qint64 endUs,
+                         const QString &detail)
+{
+    append('X', name, category, lane, startUs, qMax<qint64>(0, endUs - startUs), 0, detail);
+}
+
+void TraceRecorder::asyncSpan(const char *name, const char *category, qint64 startUs, qint64 endUs,
+                              const QString &detail)
+{
+    quint64 id = nextId.fetch_add(1, std::memory_order_relaxed);
+    append('b', name, category, SchedulerLane, startUs, 0, id, detail);
+    append('e', name, category, SchedulerLane, qMax(startUs, endUs), 0, id, QString());
+}
+
+void TraceRecorder::instant(const char *name, const char *category, int lane, const QString &detail)
+{
+    append('i', name, category, lane, nowUs(), 0, 0, detail);
+}
+
+qint64 TraceRecorder::dropped() const
+{
+    return droppedEvents.load(std::memory_order_relaxed);
+}
+
+void TraceRecorder::append(char phase, const char *name, const char *category, int lane,
+                           qint64 timestampUs, qint64 durationUs, quint64 id, const QString &detail)
+{
+    if (recorded.fetch_add(1, std::memory_order_relaxed) >= MaxEvents) {
+        droppedEvents.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Buffer *buffer = threadBuffer();
+    int count = buffer->count.load(std::memory_order_relaxed);
+    Event &event = buffer->events[count];
+    event.name = name;
+    event.category = category;
+    event.phase = phase;
+    event.lane = lane == CurrentThread ? threadCache.lane : lane;
+    event.timestampUs = timestampUs;
+    event.durationUs = durationUs;
+    event.id = id;
+    event.detail = detail;
+    buffer->count.store(count + 1, std::memory_order_release);
+}
+
+TraceRecorder::Buffer *TraceRecorder::threadBuffer()
+{
+    ThreadCache &cache = threadCache;
+    if (cache.recorder == serial) {
+        Buffer *buffer = static_cast<Buffer *>(cache.buffer);
+        if (buffer->count.load(std::memory_order_relaxed) < BufferEvents) {
+            return buffer;
+        }
+    } else {
+        cache.recorder = serial;
+        cache.lane = ThreadLaneBase + threadLanes.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // A fresh buffer for this thread, pushed onto the shared list
+    Buffer *buffer = new Buffer;
+    buffer->count.store(0, std::memory_order_relaxed);
+    buffer->next = buffers.load(std::memory_order_relaxed);
+    while (!buffers.compare_exchange_weak(buffer->next, buffer, std::memory_order_release,
+                                          std::memory_order_relaxed)) {
+    }
+    cache.buffer = buffer;
+    return buffer;
+}
+
+bool TraceRecorder::write(const QString &path, QString *errorMessage) const
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (errorMessage) {
+            *errorMessage = "Cannot write trace: " + file.errorString();
+        }
+        return false;
+    }
+
+    QByteArray out = "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":"
+                     + QByteArray::number(dropped()) + "},\"traceEvents\":[\n"
+                     "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"FileConverter\"}}";
+    QSet<int> lanes;
+    for (Buffer *buffer = buffers.load(std::memory_order_acquire); buffer; buffer = buffer->next) {
+        int count = buffer->count.load(std::memory_order_acquire);
+        for (int i = 0; i < count; ++i) {
+            const Event &event = buffer->events[i];
+            lanes.insert(event.lane);
+            out += ",\n{\"name\":\"";
+            out += event.name;
+            out += "\",\"cat\":\"";
+            out += event.category;
+            out += "\",\"ph\":\"";
+            out += event.phase;
+            out += "\",\"ts\":" + QByteArray::number(event.timestampUs);
+            if (event.phase == 'X') {
+                out += ",\"dur\":" + QByteArray::number(event.durationUs);
+            } else if (event.phase == 'i') {
+                out += ",\"s\":\"t\"";
+            } else {
+                out += ",\"id\":" + QByteArray::number(event.id);
+            }
+            out += ",\"pid\":1,\"tid\":" + QByteArray::number(event.lane);
+            if (!event.detail.isEmpty()) {
+                out += ",\"args\":{\"detail\":";
+                appendJsonString(out, event.detail);
+                out += '}';
+            }
+            out += '}';
+            if (out.size() >= WriteChunkSize) {
+                file.write(out);
+                out.clear();
+            }
+        }
+    }
+
+    // Lane names, scheduler first, slots in order, threads last
+    for (int lane : lanes) {
+        out += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + QByteArray::number(lane)
+               + ",\"args\":{\"name\":";
+        appendJsonString(out, laneName(lane));
+        out += "}},\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":" + QByteArray::number(lane)
+               + ",\"args\":{\"sort_index\":" + QByteArray::number(lane) + "}}";
+    }
+    out += "\n]}\n";
+    file.write(out);
+
+    if (!file.commit()) {
+        if (errorMessage) {
+            *errorMessage = "Cannot write trace: " + file.errorString();
+        }
+        return false;
+    }
+    return true;
+}
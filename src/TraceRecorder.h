@@ -0,0 +1,71 @@
+#ifndef TRACERECORDER_H
+#define TRACERECORDER_H
+
+#include <QString>
+#include <atomic>
+#include <chrono>
+
+// Timeline of a batch in Chrome Trace Event format, for chrome://tracing or
+// ui.perfetto.dev. Each thread appends to buffers of its own, so recording
+// takes no lock and never waits for the writer; buffers are linked into a
+// list with a compare-and-swap and read while threads keep appending.
+//
+// Events go to a lane (a track in the viewer): the scheduler, a conversion
+// slot, or the recording thread's own lane for work such as write-behind
+// copies. Names and categories must be string literals.
+class TraceRecorder
+{
+public:
+    static constexpr int SchedulerLane = 0;
+    static constexpr int CurrentThread = -1;
+
+    TraceRecorder();
+    ~TraceRecorder();
+
+    TraceRecorder(const TraceRecorder &) = delete;
+    TraceRecorder &operator=(const TraceRecorder &) = delete;
+
+    // Microseconds since the recorder was created
+    qint64 nowUs() const;
+    // Lane of conversion slot n (0-based)
+    static int slotLane(int slot) { return slot + 1; }
+
+    // A span that ran from startUs to endUs on one lane
+    void span(const char *name, const char *category, int lane, qint64 startUs, qint64 endUs,
+              const QString &detail = QString());
+    // A span with a track of its own, for spans that overlap (queued jobs)
+    void asyncSpan(const char *name, const char *category, qint64 startUs, qint64 endUs,
+                   const QString &detail = QString());
+    void instant(const char *name, const char *category, int lane, const QString &detail = QString());
+
+    // Events dropped because the recorder was full
+    qint64 dropped() const;
+    bool write(const QString &path, QString *errorMessage = nullptr) const;
+
+private:
+    struct Event {
+        const char *name;
+        const char *category;
+        char phase;
+        int lane;
+        qint64 timestampUs;
+        qint64 durationUs;
+        quint64 id;
+        QString detail;
+    };
+    struct Buffer;
+
+    void append(char phase, const char *name, const char *category, int lane,
+                qint64 timestampUs, qint64 durationUs, quint64 id, const QString &detail);
+    Buffer *threadBuffer();
+
+    const quint64 serial;       // Tells recorders apart in the per-thread cache
+    const std::chrono::steady_clock::time_point origin;
+    std::atomic<Buffer *> buffers;
+    std::atomic<int> threadLanes;
+    std::atomic<quint64> nextId;
+    std::atomic<qint64> recorded;
+    std::atomic<qint64> droppedEvents;
+};
+
+#endif // TRACERECORDER_H
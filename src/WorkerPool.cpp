@@ -0,0 +1,149 @@
+#include "WorkerPool.h"
+#include <QTcpSocket>
+#include <QTimer>
+
+namespace {
+constexpr int HealthCheckIntervalMs = 5000;
+constexpr int ProbeTimeoutMs = 3000;
+}
+
+WorkerPool::WorkerPool(QObject *parent)
+    : QObject(parent)
+{
+    healthTimer = new QTimer(this);
+    connect(healthTimer, &QTimer::timeout, this, &WorkerPool::checkHealth);
+}
+
+void WorkerPool::setEndpoints(const QList<WorkerEndpoint> &endpoints)
+{
+    for (Worker &worker : workers) {
+        if (worker.probe) {
+            worker.probe->deleteLater();
+        }
+    }
+    workers.clear();
+
+    for (const WorkerEndpoint &endpoint : endpoints) {
+        Worker worker;
+        worker.endpoint = endpoint;
+        worker.healthy = true; // Optimistic until a probe or a job says otherwise
+        worker.busy = 0;
+        worker.probe = nullptr;
+        workers.append(worker);
+    }
+
+    if (workers.isEmpty()) {
+        healthTimer->stop();
+    } else {
+        healthTimer->start(HealthCheckIntervalMs);
+        checkHealth();
+    }
+}
+
+bool WorkerPool::isEmpty() const
+{
+    return workers.isEmpty();
+}
+
+int WorkerPool::capacity() const
+{
+    int slots = 0;
+    for (const Worker &worker : workers) {
+        slots += worker.endpoint.slotCount;
+    }
+    return slots;
+}
+
+int WorkerPool::acquire(const QSet<QString> &exclude)
+{
+    int best = -1;
+    double bestLoad = 1.0;
+    for (int i = 0; i < workers.size(); ++i) {
+        const Worker &worker = workers[i];
+        if (!worker.healthy || worker.busy >= worker.endpoint.slotCount
+            || exclude.contains(worker.endpoint.id())) {
+            continue;
+        }
+        double load = static_cast<double>(worker.busy) / worker.endpoint.slotCount;
+        if (best == -1 || load < bestLoad) {
+            best = i;
+            bestLoad = load;
+        }
+    }
+    if (best != -1) {
+        workers[best].busy++;
+    }
+    return best;
+}
+
+void WorkerPool::release(int index, bool failed)
+{
+    if (index < 0 || index >= workers.size()) {
+        return;
+    }
+    workers[index].busy = qMax(0, workers[index].busy - 1);
+    if (failed) {
+        workers[index].healthy = false;
+    }
+}
+
+WorkerEndpoint WorkerPool::endpoint(int index) const
+{
+    return workers.value(index).endpoint;
+}
+
+void WorkerPool::checkHealth()
+{
+    for (int i = 0; i < workers.size(); ++i) {
+        if (!workers[i].probe) {
+            probe(i);
+        }
+    }
+}
+
+void WorkerPool::probe(int index)
+{
+    QTcpSocket *socket = new QTcpSocket(this);
+    workers[index].probe = socket;
+
+    connect(socket, &QTcpSocket::connected, this, [socket]() {
+        WorkerProtocol::writeFrame(socket, WorkerProtocol::Ping);
+    });
+    connect(socket, &QTcpSocket::readyRead, this, [this, socket, index]() {
+        QByteArray buffer = socket->peek(socket->bytesAvailable());
+        WorkerProtocol::FrameType type;
+        QByteArray payload;
+        bool error = false;
+        if (WorkerProtocol::takeFrame(buffer, &type, &payload, &error)) {
+            finishProbe(index, socket, type == WorkerProtocol::Pong);
+        } else if (error) {
+            finishProbe(index, socket, false);
+        }
+    });
+    connect(socket, &QTcpSocket::errorOccurred, this, [this, socket, index]() {
+        finishProbe(index, socket, false);
+    });
+    QTimer::singleShot(ProbeTimeoutMs, socket, [this, socket, index]() {
+        finishProbe(index, socket, false);
+    });
+
+    socket->connectToHost(workers[index].endpoint.host, workers[index].endpoint.port);
+}
+
+void WorkerPool::finishProbe(int index, QTcpSocket *socket, bool healthy)
+{
+    // Ignore late signals from a probe that was already settled or replaced
+    if (index >= workers.size() || workers[index].probe != socket) {
+        return;
+    }
+    workers[index].probe = nullptr;
+    socket->disconnect(this);
+    socket->abort();
+    socket->deleteLater();
+
+    bool recovered = healthy && !workers[index].healthy;
+    workers[index].healthy = healthy;
+    if (recovered) {
+        emit workerAvailable();
+    }
+}
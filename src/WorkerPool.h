@@ -0,0 +1,55 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <QObject>
+#include <QList>
+#include <QSet>
+#include "WorkerProtocol.h"
+
+class QTimer;
+class QTcpSocket;
+
+// Remote "--worker" endpoints with per-worker slot accounting and periodic
+// health checks. A worker that fails a job or a probe gets no new jobs until
+// a later probe succeeds.
+class WorkerPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit WorkerPool(QObject *parent = nullptr);
+
+    void setEndpoints(const QList<WorkerEndpoint> &endpoints);
+    bool isEmpty() const;
+    // Slots over all workers, healthy or not
+    int capacity() const;
+
+    // Reserves a slot on the least loaded healthy worker not in exclude;
+    // returns -1 if none is free
+    int acquire(const QSet<QString> &exclude);
+    void release(int index, bool failed);
+    WorkerEndpoint endpoint(int index) const;
+
+signals:
+    // An unhealthy worker passed a health check again
+    void workerAvailable();
+
+private slots:
+    void checkHealth();
+
+private:
+    struct Worker {
+        WorkerEndpoint endpoint;
+        bool healthy;
+        int busy;
+        QTcpSocket *probe;
+    };
+
+    void probe(int index);
+    void finishProbe(int index, QTcpSocket *socket, bool healthy);
+
+    QList<Worker> workers;
+    QTimer *healthTimer;
+};
+
+#endif // WORKERPOOL_H
@@ -0,0 +1,58 @@
+#include "WorkerProtocol.h"
+#include <QIODevice>
+#include <QtEndian>
+#include <QStringList>
+
+void WorkerProtocol::writeFrame(QIODevice *device, FrameType type, const QByteArray &payload)
+{
+    uchar header[5];
+    qToBigEndian<quint32>(static_cast<quint32>(payload.size() + 1), header);
+    header[4] = type;
+    device->write(reinterpret_cast<const char *>(header), sizeof(header));
+    if (!payload.isEmpty()) {
+        device->write(payload);
+    }
+}
+
+bool WorkerProtocol::takeFrame(QByteArray &buffer, FrameType *type, QByteArray *payload, bool *error)
+{
+    *error = false;
+    if (buffer.size() < 5) {
+        return false;
+    }
+
+    quint32 length = qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(buffer.constData()));
+    if (length == 0 || length > MaxFrameSize) {
+        *error = true;
+        return false;
+    }
+    if (static_cast<quint64>(buffer.size()) < 4 + static_cast<quint64>(length)) {
+        return false;
+    }
+
+    *type = static_cast<FrameType>(static_cast<quint8>(buffer.at(4)));
+    *payload = buffer.mid(5, length - 1);
+    buffer.remove(0, 4 + length);
+    return true;
+}
+
+QList<WorkerEndpoint> WorkerProtocol::parseEndpoints(const QString &spec)
+{
+    QList<WorkerEndpoint> endpoints;
+    const QStringList entries = spec.split(',', Qt::SkipEmptyParts);
+    for (const QString &entry : entries) {
+        QStringList parts = entry.trimmed().split(':');
+        if (parts.size() < 2 || parts.size() > 3) {
+            continue;
+        }
+        bool ok = false;
+        WorkerEndpoint endpoint;
+        endpoint.host = parts[0];
+        endpoint.port = parts[1].toUShort(&ok);
+        endpoint.slotCount = parts.size() == 3 ? qMax(1, parts[2].toInt()) : 1;
+        if (ok && !endpoint.host.isEmpty()) {
+            endpoints << endpoint;
+        }
+    }
+    return endpoints;
+}
@@ -0,0 +1,53 @@
+#ifndef WORKERPROTOCOL_H
+#define WORKERPROTOCOL_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+class QIODevice;
+
+struct WorkerEndpoint {
+    QString host;
+    quint16 port;
+    int slotCount;
+
+    QString id() const { return host + ":" + QString::number(port); }
+};
+
+// Wire format shared by the coordinator and "--worker" processes.
+// Every frame is a big-endian quint32 length, a type byte and a payload.
+// One connection carries one job:
+//   client: Submit, Data..., EndOfInput
+//   worker: Result, Data..., EndOfOutput   (Data only when Result is ok)
+// Ping/Pong is used by the coordinator's health checks.
+class WorkerProtocol
+{
+public:
+    enum FrameType : quint8 {
+        Ping = 1,
+        Pong,
+        Submit,         // JSON: name, target, size, resize (optional)
+        Data,
+        EndOfInput,
+        Result,         // JSON: ok, error, retryable, name, size
+        EndOfOutput
+    };
+
+    static constexpr quint16 DefaultPort = 7878;
+    static constexpr qint64 ChunkSize = 1024 * 1024;
+    // Stop feeding the socket while this much is still unsent
+    static constexpr qint64 MaxBufferedBytes = 4 * ChunkSize;
+    static constexpr quint32 MaxFrameSize = 16 * 1024 * 1024;
+
+    static void writeFrame(QIODevice *device, FrameType type, const QByteArray &payload = QByteArray());
+
+    // Removes one complete frame from the front of buffer. Returns false if
+    // the frame is incomplete; sets *error on a malformed stream.
+    static bool takeFrame(QByteArray &buffer, FrameType *type, QByteArray *payload, bool *error);
+
+    // Parses "host:port[:slots],..." (slots default to 1)
+    static QList<WorkerEndpoint> parseEndpoints(const QString &spec);
+};
+
+#endif // WORKERPROTOCOL_H
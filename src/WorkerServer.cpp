@@ -0,0 +1,236 @@
+#include "WorkerServer.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+
+WorkerServer::WorkerServer(Converter *converter, int slotCount, QObject *parent)
+    : QObject(parent), converter(converter), slotCount(qMax(1, slotCount))
+{
+    converter->setMaxParallelConversions(this->slotCount);
+    converter->setWriteBehindMode(Converter::WriteBehindMode::Off);
+
+    connect(&server, &QTcpServer::newConnection, this, &WorkerServer::onNewConnection);
+    connect(converter, &Converter::conversionFinished, this, &WorkerServer::onConversionFinished);
+    connect(converter, &Converter::conversionError, this, &WorkerServer::onConversionError);
+}
+
+WorkerServer::~WorkerServer()
+{
+    const QList<Session *> sessions = sessionsByInput.values();
+    for (Session *session : sessions) {
+        closeSession(session);
+    }
+}
+
+bool WorkerServer::listen(const QHostAddress &address, quint16 port)
+{
+    return server.listen(address, port);
+}
+
+QString WorkerServer::errorString() const
+{
+    return server.errorString();
+}
+
+void WorkerServer::onNewConnection()
+{
+    while (QTcpSocket *socket = server.nextPendingConnection()) {
+        Session *session = new Session;
+        session->socket = socket;
+        session->directory = nullptr;
+        session->input = nullptr;
+        session->output = nullptr;
+        session->converting = false;
+
+        connect(socket, &QTcpSocket::readyRead, this, [this, session]() { onReadyRead(session); });
+        connect(socket, &QTcpSocket::bytesWritten, this, [this, session]() { pumpOutput(session); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, session]() {
+            if (session->converting) {
+                // Coordinator gave up; stop the tool and drop the session when it exits
+                session->socket->disconnect(this);
+                session->socket->deleteLater();
+                session->socket = nullptr;
+                converter->cancelConversion(session->inputPath);
+            } else {
+                closeSession(session);
+            }
+        });
+    }
+}
+
+void WorkerServer::onReadyRead(Session *session)
+{
+    session->buffer.append(session->socket->readAll());
+
+    WorkerProtocol::FrameType type;
+    QByteArray payload;
+    bool error = false;
+    while (session->socket && WorkerProtocol::takeFrame(session->buffer, &type, &payload, &error)) {
+        handleFrame(session, type, payload);
+    }
+    if (error && session->socket) {
+        session->socket->abort();
+    }
+}
+
+void WorkerServer::handleFrame(Session *session, WorkerProtocol::FrameType type, const QByteArray &payload)
+{
+    switch (type) {
+        case WorkerProtocol::Ping: {
+            QJsonObject pong;
+            pong["slots"] = slotCount;
+            pong["busy"] = converter->activeConversions();
+            WorkerProtocol::writeFrame(session->socket, WorkerProtocol::Pong,
+                                       QJsonDocument(pong).toJson(QJsonDocument::Compact));
+            break;
+        }
+        case WorkerProtocol::Submit: {
+            QJsonObject submit = QJsonDocument::fromJson(payload).object();
+            // Only the file name is used, never a path from the wire
+            QString name = QFileInfo(submit["name"].toString()).fileName();
+            session->targetExtension = submit["target"].toString();
+            session->resize = submit["resize"].toString();
+            session->directory = new QTemporaryDir();
+            if (name.isEmpty() || !session->directory->isValid()) {
+                sendFailure(session, "Worker could not accept the job");
+                return;
+            }
+            QDir(session->directory->path()).mkpath("in");
+            session->inputPath = session->directory->path() + "/in/" + name;
+            session->input = new QFile(session->inputPath);
+            if (!session->input->open(QIODevice::WriteOnly)) {
+                sendFailure(session, "Worker could not store the input: " + session->input->errorString(), true);
+            }
+            break;
+        }
+        case WorkerProtocol::Data:
+            if (session->input && session->input->isOpen()
+                && session->input->write(payload) != payload.size()) {
+                // A full disk here would otherwise convert a truncated input
+                QString error = session->input->errorString();
+                session->input->close();
+                sendFailure(session, "Worker could not store the input: " + error, true);
+            }
+            break;
+        case WorkerProtocol::EndOfInput: {
+            if (!session->input || !session->input->isOpen()) {
+                return;
+            }
+            session->input->close();
+            QString outDir = session->directory->path() + "/out";
+            QDir().mkpath(outDir);
+
+            session->converting = true;
+            sessionsByInput[session->inputPath] = session;
+            // Per job: other sessions are converting into their own directories
+            Converter::OutputSpec output;
+            output.format = Converter::detectFormat("target." + session->targetExtension);
+            output.resize = Converter::ResizeOptions::fromString(session->resize);
+            converter->convertFile(session->inputPath, QList<Converter::OutputSpec>() << output, outDir);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void WorkerServer::onConversionFinished(const QString &filePath, Converter::ConversionStatus status, const QString &outputPath)
+{
+    Session *session = sessionsByInput.take(filePath);
+    if (!session) {
+        return;
+    }
+    session->converting = false;
+    if (!session->socket) {
+        closeSession(session);
+    } else if (status == Converter::ConversionStatus::Success) {
+        sendOutput(session, outputPath);
+    } else if (status == Converter::ConversionStatus::Unsupported) {
+        sendFailure(session, "Unsupported conversion");
+    } else {
+        sendFailure(session, "Conversion did not complete on worker");
+    }
+}
+
+void WorkerServer::onConversionError(const QString &filePath, const QString &errorMessage)
+{
+    Session *session = sessionsByInput.take(filePath);
+    if (!session) {
+        return;
+    }
+    session->converting = false;
+    if (!session->socket) {
+        closeSession(session);
+    } else {
+        sendFailure(session, errorMessage);
+    }
+}
+
+void WorkerServer::sendFailure(Session *session, const QString &errorMessage, bool retryable)
+{
+    QJsonObject result;
+    result["ok"] = false;
+    result["error"] = errorMessage;
+    result["retryable"] = retryable;
+    WorkerProtocol::writeFrame(session->socket, WorkerProtocol::Result,
+                               QJsonDocument(result).toJson(QJsonDocument::Compact));
+    disconnectLater(session->socket);
+}
+
+void WorkerServer::sendOutput(Session *session, const QString &outputPath)
+{
+    session->output = new QFile(outputPath);
+    if (!session->output->open(QIODevice::ReadOnly)) {
+        sendFailure(session, "Worker could not read the output: " + session->output->errorString());
+        return;
+    }
+
+    QJsonObject result;
+    result["ok"] = true;
+    result["name"] = QFileInfo(outputPath).fileName();
+    result["size"] = session->output->size();
+    WorkerProtocol::writeFrame(session->socket, WorkerProtocol::Result,
+                               QJsonDocument(result).toJson(QJsonDocument::Compact));
+    pumpOutput(session);
+}
+
+void WorkerServer::pumpOutput(Session *session)
+{
+    if (!session->socket || !session->output || !session->output->isOpen()) {
+        return;
+    }
+    while (session->socket->bytesToWrite() < WorkerProtocol::MaxBufferedBytes) {
+        QByteArray chunk = session->output->read(WorkerProtocol::ChunkSize);
+        if (chunk.isEmpty()) {
+            session->output->close();
+            WorkerProtocol::writeFrame(session->socket, WorkerProtocol::EndOfOutput);
+            disconnectLater(session->socket);
+            return;
+        }
+        WorkerProtocol::writeFrame(session->socket, WorkerProtocol::Data, chunk);
+    }
+}
+
+void WorkerServer::disconnectLater(QTcpSocket *socket)
+{
+    // Deferred so the session is not torn down while a frame is being handled;
+    // disconnectFromHost() itself waits for queued data to be written
+    QMetaObject::invokeMethod(socket, [socket]() { socket->disconnectFromHost(); }, Qt::QueuedConnection);
+}
+
+void WorkerServer::closeSession(Session *session)
+{
+    if (session->socket) {
+        session->socket->disconnect(this);
+        session->socket->deleteLater();
+    }
+    sessionsByInput.remove(session->inputPath);
+    delete session->input;
+    delete session->output;
+    delete session->directory; // Removes the received input and produced output
+    delete session;
+}
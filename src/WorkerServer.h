@@ -0,0 +1,60 @@
+#ifndef WORKERSERVER_H
+#define WORKERSERVER_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QMap>
+#include "Converter.h"
+#include "WorkerProtocol.h"
+
+class QTcpSocket;
+class QTemporaryDir;
+class QFile;
+
+// "--worker" mode: accepts jobs from a coordinator over TCP, converts them
+// with a local Converter and streams the result back.
+class WorkerServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    WorkerServer(Converter *converter, int slotCount, QObject *parent = nullptr);
+    ~WorkerServer();
+
+    bool listen(const QHostAddress &address, quint16 port);
+    QString errorString() const;
+
+private slots:
+    void onNewConnection();
+    void onConversionFinished(const QString &filePath, Converter::ConversionStatus status, const QString &outputPath);
+    void onConversionError(const QString &filePath, const QString &errorMessage);
+
+private:
+    struct Session {
+        QTcpSocket *socket;
+        QByteArray buffer;
+        QTemporaryDir *directory;
+        QFile *input;
+        QFile *output;
+        QString inputPath;
+        QString targetExtension;
+        QString resize;
+        bool converting;
+    };
+
+    void onReadyRead(Session *session);
+    void handleFrame(Session *session, WorkerProtocol::FrameType type, const QByteArray &payload);
+    // retryable: the fault is this worker's, another one may well succeed
+    void sendFailure(Session *session, const QString &errorMessage, bool retryable = false);
+    void sendOutput(Session *session, const QString &outputPath);
+    void pumpOutput(Session *session);
+    void closeSession(Session *session);
+    static void disconnectLater(QTcpSocket *socket);
+
+    QTcpServer server;
+    Converter *converter;
+    int slotCount;
+    QMap<QString, Session *> sessionsByInput;
+};
+
+#endif // WORKERSERVER_H
@@ -0,0 +1,526 @@
+#include "ZipArchive.h"
+#include <QDateTime>
+#include <QtEndian>
+#include <zlib.h>
+
+namespace {
+constexpr quint32 LocalHeaderSignature = 0x04034b50;
+constexpr quint32 CentralHeaderSignature = 0x02014b50;
+constexpr quint32 EndOfCentralDirectorySignature = 0x06054b50;
+constexpr quint32 Zip64EndOfCentralDirectorySignature = 0x06064b50;
+constexpr quint32 Zip64LocatorSignature = 0x07064b50;
+constexpr quint32 DataDescriptorSignature = 0x08074b50;
+constexpr int EndOfCentralDirectorySize = 22;
+constexpr int MaxCommentSize = 0xFFFF;
+constexpr qint64 InputChunkSize = 64 * 1024;
+constexpr qint64 CopyChunkSize = 1024 * 1024;
+
+quint16 u16(const char *p) { return qFromLittleEndian<quint16>(p); }
+quint32 u32(const char *p) { return qFromLittleEndian<quint32>(p); }
+quint64 u64(const char *p) { return qFromLittleEndian<quint64>(p); }
+
+void put16(QByteArray &out, quint16 value)
+{
+    char buffer[2];
+    qToLittleEndian(value, buffer);
+    out.append(buffer, 2);
+}
+
+void put32(QByteArray &out, quint32 value)
+{
+    char buffer[4];
+    qToLittleEndian(value, buffer);
+    out.append(buffer, 4);
+}
+}
+
+ZipReader::ZipReader(const QString &path)
+    : archivePath(path)
+{
+}
+
+QString ZipReader::path() const
+{
+    return archivePath;
+}
+
+const QList<ZipReader::Entry> &ZipReader::entries() const
+{
+    return entryList;
+}
+
+bool ZipReader::open(QString *errorMessage)
+{
+    QFile file(archivePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *errorMessage = "Cannot open archive: " + file.errorString();
+        return false;
+    }
+
+    // The end record sits within the last 64 KB (its comment) of the file
+    qint64 tailSize = qMin<qint64>(file.size(), EndOfCentralDirectorySize + MaxCommentSize);
+    file.seek(file.size() - tailSize);
+    QByteArray tail = file.read(tailSize);
+    int end = -1;
+    for (int i = tail.size() - EndOfCentralDirectorySize; i >= 0; --i) {
+        if (u32(tail.constData() + i) == EndOfCentralDirectorySignature) {
+            end = i;
+            break;
+        }
+    }
+    if (end < 0) {
+        *errorMessage = "Not a ZIP archive (no central directory)";
+        return false;
+    }
+
+    const char *record = tail.constData() + end;
+    qint64 count = u16(record + 10);
+    qint64 size = u32(record + 12);
+    qint64 offset = u32(record + 16);
+
+    if (count == 0xFFFF || size == 0xFFFFFFFF || offset == 0xFFFFFFFF) {
+        // ZIP64: the locator right before the end record points to the real one
+        qint64 endOffset = file.size() - tailSize + end;
+        QByteArray locator;
+        if (endOffset >= 20 && file.seek(endOffset - 20)) {
+            locator = file.read(20);
+        }
+        if (locator.size() != 20 || u32(locator.constData()) != Zip64LocatorSignature) {
+            *errorMessage = "Damaged ZIP64 archive";
+            return false;
+        }
+        file.seek(static_cast<qint64>(u64(locator.constData() + 8)));
+        QByteArray zip64 = file.read(56);
+        if (zip64.size() != 56 || u32(zip64.constData()) != Zip64EndOfCentralDirectorySignature) {
+            *errorMessage = "Damaged ZIP64 archive";
+            return false;
+        }
+        count = static_cast<qint64>(u64(zip64.constData() + 32));
+        size = static_cast<qint64>(u64(zip64.constData() + 40));
+        offset = static_cast<qint64>(u64(zip64.constData() + 48));
+    }
+
+    return readCentralDirectory(file, offset, size, count, errorMessage);
+}
+
+bool ZipReader::readCentralDirectory(QFile &file, qint64 offset, qint64 size, qint64 count, QString *errorMessage)
+{
+    if (offset + size > file.size() || !file.seek(offset)) {
+        *errorMessage = "Damaged ZIP archive (central directory out of range)";
+        return false;
+    }
+    QByteArray directory = file.read(size);
+    if (directory.size() != size) {
+        *errorMessage = "Damaged ZIP archive (short central directory)";
+        return false;
+    }
+
+    entryList.clear();
+    entryList.reserve(static_cast<int>(qMin<qint64>(count, 1 << 20)));
+    int pos = 0;
+    for (qint64 i = 0; i < count; ++i) {
+        if (pos + 46 > directory.size() || u32(directory.constData() + pos) != CentralHeaderSignature) {
+            *errorMessage = "Damaged ZIP archive (bad central directory entry)";
+            return false;
+        }
+        const char *header = directory.constData() + pos;
+        int nameLength = u16(header + 28);
+        int extraLength = u16(header + 30);
+        int commentLength = u16(header + 32);
+        if (pos + 46 + nameLength + extraLength + commentLength > directory.size()) {
+            *errorMessage = "Damaged ZIP archive (truncated entry)";
+            return false;
+        }
+
+        Entry entry;
+        entry.flags = u16(header + 8);
+        entry.method = u16(header + 10);
+        entry.crc = u32(header + 16);
+        entry.compressedSize = u32(header + 20);
+        entry.uncompressedSize = u32(header + 24);
+        entry.localHeaderOffset = u32(header + 42);
+        QByteArray name(header + 46, nameLength);
+        // Bit 11 marks UTF-8 names; older archives use the OEM code page
+        entry.name = (entry.flags & 0x800) ? QString::fromUtf8(name) : QString::fromLatin1(name);
+
+        // ZIP64 extra field: only the fields saturated in the header are present
+        const char *extra = header + 46 + nameLength;
+        int extraPos = 0;
+        while (extraPos + 4 <= extraLength) {
+            quint16 id = u16(extra + extraPos);
+            quint16 length = u16(extra + extraPos + 2);
+            if (extraPos + 4 + length > extraLength) {
+                break;
+            }
+            if (id == 0x0001) {
+                const char *field = extra + extraPos + 4;
+                int fieldPos = 0;
+                if (entry.uncompressedSize == 0xFFFFFFFF && fieldPos + 8 <= length) {
+                    entry.uncompressedSize = static_cast<qint64>(u64(field + fieldPos));
+                    fieldPos += 8;
+                }
+                if (entry.compressedSize == 0xFFFFFFFF && fieldPos + 8 <= length) {
+                    entry.compressedSize = static_cast<qint64>(u64(field + fieldPos));
+                    fieldPos += 8;
+                }
+                if (entry.localHeaderOffset == 0xFFFFFFFF && fieldPos + 8 <= length) {
+                    entry.localHeaderOffset = static_cast<qint64>(u64(field + fieldPos));
+                }
+            }
+            extraPos += 4 + length;
+        }
+
+        entryList.append(entry);
+        pos += 46 + nameLength + extraLength + commentLength;
+    }
+    return true;
+}
+
+ZipEntryDevice::ZipEntryDevice(const QString &archivePath, const ZipReader::Entry &entry, QObject *parent)
+    : QIODevice(parent), entry(entry), archive(archivePath), stream(nullptr),
+      dataOffset(-1), compressedRemaining(0), produced(0), crc(0), ended(false)
+{
+}
+
+ZipEntryDevice::~ZipEntryDevice()
+{
+    close();
+}
+
+bool ZipEntryDevice::open(OpenMode mode)
+{
+    if ((mode & QIODevice::WriteOnly) || !entry.isSupported()) {
+        setErrorString("Unsupported ZIP entry");
+        return false;
+    }
+    if (!archive.open(QIODevice::ReadOnly)) {
+        setErrorString(archive.errorString());
+        return false;
+    }
+
+    // The data follows the local header, whose extra field may differ from
+    // the central directory's
+    QByteArray header;
+    if (archive.seek(entry.localHeaderOffset)) {
+        header = archive.read(30);
+    }
+    if (header.size() != 30 || u32(header.constData()) != LocalHeaderSignature) {
+        setErrorString("Damaged ZIP entry");
+        archive.close();
+        return false;
+    }
+    dataOffset = entry.localHeaderOffset + 30 + u16(header.constData() + 26) + u16(header.constData() + 28);
+
+    if (!rewind()) {
+        archive.close();
+        return false;
+    }
+    return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+void ZipEntryDevice::close()
+{
+    if (stream) {
+        inflateEnd(stream);
+        delete stream;
+        stream = nullptr;
+    }
+    archive.close();
+    if (isOpen()) {
+        QIODevice::close();
+    }
+}
+
+qint64 ZipEntryDevice::size() const
+{
+    return entry.uncompressedSize;
+}
+
+bool ZipEntryDevice::rewind()
+{
+    if (!archive.seek(dataOffset)) {
+        setErrorString(archive.errorString());
+        return false;
+    }
+    compressedRemaining = entry.compressedSize;
+    produced = 0;
+    crc = crc32(0L, Z_NULL, 0);
+    ended = false;
+
+    if (entry.method == 8) {
+        if (stream) {
+            inflateEnd(stream);
+        } else {
+            stream = new z_stream;
+        }
+        *stream = z_stream();
+        // Negative window bits: raw deflate data without a zlib header
+        if (inflateInit2(stream, -MAX_WBITS) != Z_OK) {
+            setErrorString("Cannot initialize decompression");
+            delete stream;
+            stream = nullptr;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ZipEntryDevice::seek(qint64 pos)
+{
+    if (pos < 0 || pos > entry.uncompressedSize) {
+        return false;
+    }
+    if (pos < produced && !rewind()) {
+        return false;
+    }
+    // Forward seeks decompress and discard
+    char scratch[16 * 1024];
+    while (produced < pos) {
+        qint64 count = readData(scratch, qMin<qint64>(sizeof(scratch), pos - produced));
+        if (count <= 0) {
+            return false;
+        }
+    }
+    return QIODevice::seek(pos);
+}
+
+qint64 ZipEntryDevice::readData(char *data, qint64 maxSize)
+{
+    if (ended || maxSize <= 0) {
+        return 0;
+    }
+
+    qint64 count = 0;
+    if (entry.method == 0) {
+        count = archive.read(data, qMin(maxSize, compressedRemaining));
+        if (count < 0) {
+            setErrorString(archive.errorString());
+            return -1;
+        }
+        compressedRemaining -= count;
+        ended = compressedRemaining == 0;
+    } else {
+        // Room for one byte past the declared size at most, so an entry that
+        // inflates beyond it (a ZIP bomb) fails here instead of filling the disk
+        qint64 room = qMin(maxSize, entry.uncompressedSize - produced + 1);
+        if (room <= 0) {
+            setErrorString("Corrupt ZIP entry");
+            return -1;
+        }
+        stream->next_out = reinterpret_cast<Bytef *>(data);
+        stream->avail_out = static_cast<uInt>(qMin<qint64>(room, 0x7FFFFFFF));
+        while (stream->avail_out > 0) {
+            if (stream->avail_in == 0 && compressedRemaining > 0) {
+                inputBuffer = archive.read(qMin(InputChunkSize, compressedRemaining));
+                if (inputBuffer.isEmpty()) {
+                    setErrorString("Truncated ZIP entry");
+                    return -1;
+                }
+                compressedRemaining -= inputBuffer.size();
+                stream->next_in = reinterpret_cast<Bytef *>(inputBuffer.data());
+                stream->avail_in = static_cast<uInt>(inputBuffer.size());
+            }
+            int result = inflate(stream, Z_NO_FLUSH);
+            if (result == Z_STREAM_END) {
+                ended = true;
+                break;
+            }
+            if (result == Z_BUF_ERROR && stream->avail_in == 0 && compressedRemaining == 0) {
+                setErrorString("Truncated ZIP entry");
+                return -1;
+            }
+            if (result != Z_OK && result != Z_BUF_ERROR) {
+                setErrorString("Corrupt ZIP entry");
+                return -1;
+            }
+        }
+        count = static_cast<qint64>(reinterpret_cast<char *>(stream->next_out) - data);
+        if (produced + count > entry.uncompressedSize) {
+            setErrorString("ZIP entry is larger than its declared size");
+            return -1;
+        }
+    }
+
+    crc = crc32(crc, reinterpret_cast<const Bytef *>(data), static_cast<uInt>(count));
+    produced += count;
+    if (ended && (crc != entry.crc || produced != entry.uncompressedSize)) {
+        setErrorString("ZIP entry failed its CRC check");
+        return -1;
+    }
+    return count;
+}
+
+qint64 ZipEntryDevice::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
+
+ZipWriter::ZipWriter(QIODevice *device)
+    : device(device), offset(0)
+{
+    QDateTime now = QDateTime::currentDateTime();
+    dosTime = static_cast<quint16>((now.time().hour() << 11) | (now.time().minute() << 5) | (now.time().second() / 2));
+    dosDate = static_cast<quint16>(((qMax(now.date().year(), 1980) - 1980) << 9)
+                                   | (now.date().month() << 5) | now.date().day());
+}
+
+int ZipWriter::entryCount() const
+{
+    return entries.size();
+}
+
+bool ZipWriter::write(const QByteArray &bytes, QString *errorMessage)
+{
+    if (device->write(bytes) != bytes.size()) {
+        *errorMessage = "Cannot write archive: " + device->errorString();
+        return false;
+    }
+    offset += bytes.size();
+    return true;
+}
+
+bool ZipWriter::addEntry(const QString &name, QIODevice *data, QString *errorMessage, bool compress)
+{
+    // Converted outputs are PDFs, images and OOXML, all compressed already;
+    // only generated XML is deflated
+    if (entries.size() >= 0xFFFF || offset >= 0xFFFFFFFF) {
+        *errorMessage = "Output archive exceeds ZIP limits (65535 entries / 4 GB)";
+        return false;
+    }
+
+    CentralEntry entry;
+    entry.name = name.toUtf8();
+    entry.offset = static_cast<quint32>(offset);
+    bool seekable = !device->isSequential();
+    entry.flags = 0x800 | (seekable ? 0 : 0x8);     // UTF-8 name, data descriptor if streaming
+    entry.method = compress ? 8 : 0;
+
+    QByteArray header;
+    put32(header, LocalHeaderSignature);
+    put16(header, compress ? 20 : 10);  // Version needed
+    put16(header, entry.flags);
+    put16(header, entry.method);
+    put16(header, dosTime);
+    put16(header, dosDate);
+    put32(header, 0);                   // CRC and sizes, filled in below
+    put32(header, 0);
+    put32(header, 0);
+    put16(header, static_cast<quint16>(entry.name.size()));
+    put16(header, 0);
+    header += entry.name;
+    if (!write(header, errorMessage)) {
+        return false;
+    }
+
+    // Raw deflate (no zlib header); the fastest level still shrinks XML
+    // several times over
+    z_stream stream = {};
+    if (compress && deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        *errorMessage = "Cannot initialize compression";
+        return false;
+    }
+    QByteArray compressed(compress ? CopyChunkSize : 0, Qt::Uninitialized);
+
+    quint32 crc = crc32(0L, Z_NULL, 0);
+    qint64 size = 0;
+    qint64 dataStart = offset;
+    bool ok = true;
+    bool end = false;
+    while (ok && !end) {
+        QByteArray chunk = data->read(CopyChunkSize);
+        end = chunk.isEmpty();
+        crc = crc32(crc, reinterpret_cast<const Bytef *>(chunk.constData()), static_cast<uInt>(chunk.size()));
+        size += chunk.size();
+        if (size >= 0xFFFFFFFF || offset + chunk.size() >= 0xFFFFFFFF) {
+            *errorMessage = "Output archive exceeds ZIP limits (65535 entries / 4 GB)";
+            ok = false;
+        } else if (!compress) {
+            ok = write(chunk, errorMessage);
+        } else {
+            stream.next_in = reinterpret_cast<Bytef *>(chunk.data());
+            stream.avail_in = static_cast<uInt>(chunk.size());
+            int result = Z_OK;
+            do {
+                stream.next_out = reinterpret_cast<Bytef *>(compressed.data());
+                stream.avail_out = static_cast<uInt>(compressed.size());
+                result = deflate(&stream, end ? Z_FINISH : Z_NO_FLUSH);
+                qsizetype produced = compressed.size() - stream.avail_out;
+                ok = produced == 0 || write(compressed.left(produced), errorMessage);
+            } while (ok && (stream.avail_out == 0 || (end && result == Z_OK)));
+        }
+    }
+    if (compress) {
+        deflateEnd(&stream);
+    }
+    if (!ok) {
+        return false;
+    }
+    entry.crc = crc;
+    entry.size = static_cast<quint32>(size);
+    entry.compressedSize = static_cast<quint32>(offset - dataStart);
+
+    QByteArray sizes;
+    put32(sizes, entry.crc);
+    put32(sizes, entry.compressedSize);
+    put32(sizes, entry.size);
+    if (seekable) {
+        qint64 end = device->pos();
+        if (!device->seek(entry.offset + 14) || device->write(sizes) != sizes.size() || !device->seek(end)) {
+            *errorMessage = "Cannot write archive: " + device->errorString();
+            return false;
+        }
+    } else {
+        QByteArray descriptor;
+        put32(descriptor, DataDescriptorSignature);
+        descriptor += sizes;
+        if (!write(descriptor, errorMessage)) {
+            return false;
+        }
+    }
+
+    entries.append(entry);
+    return true;
+}
+
+bool ZipWriter::finish(QString *errorMessage)
+{
+    qint64 directoryOffset = offset;
+    QByteArray directory;
+    for (const CentralEntry &entry : entries) {
+        put32(directory, CentralHeaderSignature);
+        put16(directory, 20);           // Version made by
+        put16(directory, entry.method == 8 ? 20 : 10);  // Version needed
+        put16(directory, entry.flags);
+        put16(directory, entry.method);
+        put16(directory, dosTime);
+        put16(directory, dosDate);
+        put32(directory, entry.crc);
+        put32(directory, entry.compressedSize);
+        put32(directory, entry.size);
+        put16(directory, static_cast<quint16>(entry.name.size()));
+        put16(directory, 0);            // Extra
+        put16(directory, 0);            // Comment
+        put16(directory, 0);            // Disk
+        put16(directory, 0);            // Internal attributes
+        put32(directory, 0);            // External attributes
+        put32(directory, entry.offset);
+        directory += entry.name;
+    }
+    qint64 directorySize = directory.size();
+    if (directoryOffset + directorySize >= 0xFFFFFFFF) {
+        *errorMessage = "Output archive exceeds ZIP limits (65535 entries / 4 GB)";
+        return false;
+    }
+
+    put32(directory, EndOfCentralDirectorySignature);
+    put16(directory, 0);
+    put16(directory, 0);
+    put16(directory, static_cast<quint16>(entries.size()));
+    put16(directory, static_cast<quint16>(entries.size()));
+    put32(directory, static_cast<quint32>(directorySize));
+    put32(directory, static_cast<quint32>(directoryOffset));
+    put16(directory, 0);
+    return write(directory, errorMessage);
+}
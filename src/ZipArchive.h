@@ -0,0 +1,110 @@
+#ifndef ZIPARCHIVE_H
+#define ZIPARCHIVE_H
+
+#include <QIODevice>
+#include <QFile>
+#include <QList>
+#include <QString>
+
+struct z_stream_s;
+
+// Minimal ZIP support for archive batches and OOXML packages: reading
+// through the central directory (including ZIP64), entries inflated on the
+// fly, and a streaming writer for stored or deflated entries.
+class ZipReader
+{
+public:
+    struct Entry {
+        QString name;
+        quint16 method;             // 0 = stored, 8 = deflate
+        quint16 flags;
+        quint32 crc;
+        qint64 compressedSize;
+        qint64 uncompressedSize;
+        qint64 localHeaderOffset;
+
+        bool isDirectory() const { return name.endsWith('/'); }
+        bool isSupported() const { return (method == 0 || method == 8) && !(flags & 0x1); }
+    };
+
+    explicit ZipReader(const QString &path);
+
+    bool open(QString *errorMessage);
+    QString path() const;
+    const QList<Entry> &entries() const;
+
+private:
+    bool readCentralDirectory(QFile &file, qint64 offset, qint64 size, qint64 count, QString *errorMessage);
+
+    QString archivePath;
+    QList<Entry> entryList;
+};
+
+// Read-only device for one entry; inflates with a private handle on the
+// archive so several entries can be read at once. Opened unbuffered, with
+// backward seeks restarting decompression.
+class ZipEntryDevice : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    ZipEntryDevice(const QString &archivePath, const ZipReader::Entry &entry, QObject *parent = nullptr);
+    ~ZipEntryDevice();
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    qint64 size() const override;
+    bool seek(qint64 pos) override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    bool rewind();
+
+    ZipReader::Entry entry;
+    QFile archive;
+    z_stream_s *stream;
+    QByteArray inputBuffer;
+    qint64 dataOffset;
+    qint64 compressedRemaining;
+    qint64 produced;
+    quint32 crc;
+    bool ended;
+};
+
+// Appends entries to a device in one pass, stored or deflated on the fly. On
+// seekable devices the sizes are patched into the local header; otherwise a
+// data descriptor follows.
+class ZipWriter
+{
+public:
+    explicit ZipWriter(QIODevice *device);
+
+    // data is read to its end; compress for text such as XML
+    bool addEntry(const QString &name, QIODevice *data, QString *errorMessage, bool compress = false);
+    bool finish(QString *errorMessage);
+    int entryCount() const;
+
+private:
+    struct CentralEntry {
+        QByteArray name;
+        quint16 flags;
+        quint16 method;         // 0 = stored, 8 = deflate
+        quint32 crc;
+        quint32 compressedSize;
+        quint32 size;
+        quint32 offset;
+    };
+
+    bool write(const QByteArray &bytes, QString *errorMessage);
+
+    QIODevice *device;
+    qint64 offset;
+    quint16 dosTime;
+    quint16 dosDate;
+    QList<CentralEntry> entries;
+};
+
+#endif // ZIPARCHIVE_H
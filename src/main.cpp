@@ -1,15 +1,55 @@
 #include "MainWindow.h"
+#include "BatchRunner.h"
+#include "WorkerServer.h"
+#include "HttpService.h"
+#include "PdfRasterJob.h"
 
 #include <QApplication>
 #include <QLocale>
 #include <QTranslator>
 #include <QSettings>
 #include <QCommandLineParser>
+#include <QFile>
 #include <QFileInfo>
+#include <QDir>
+#include <QScopedPointer>
+#include <QStandardPaths>
+#include <cstring>
+#include <cstdio>
+#ifdef Q_OS_WIN
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <unistd.h>
+#endif
+
+// -c/--convert, --worker and --serve run without a GUI, so they must not need a display
+static bool isHeadless(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-c") == 0 || std::strncmp(argv[i], "--convert", 9) == 0
+            || std::strcmp(argv[i], "--worker") == 0 || std::strcmp(argv[i], "--serve") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// "-c png < in.heic > out.png": convert stdin when no input files are given
+static bool stdinIsTerminal()
+{
+#ifdef Q_OS_WIN
+    return _isatty(_fileno(stdin));
+#else
+    return isatty(fileno(stdin));
+#endif
+}
 
 int main(int argc, char *argv[])
 {
-    QApplication a(argc, argv);
+    QScopedPointer<QCoreApplication> app(isHeadless(argc, argv)
+                                         ? new QCoreApplication(argc, argv)
+                                         : new QApplication(argc, argv));
     
     // Set application metadata for QSettings
     QCoreApplication::setOrganizationName("FileConverter");
@@ -26,16 +66,260 @@ int main(int argc, char *argv[])
                                      "format");
     parser.addOption(convertOption);
     
-    parser.addPositionalArgument("file", "File to convert (from context menu)");
+    QCommandLineOption outputOption(QStringList() << "o" << "output",
+                                    "Output directory for --convert (default: next to each input)",
+                                    "directory");
+    parser.addOption(outputOption);
+    
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs",
+                                  "Number of parallel conversions for --convert",
+                                  "count", "1");
+    parser.addOption(jobsOption);
+    
+    QCommandLineOption resizeOption("resize",
+                                    "Scale image outputs down to fit a box: N (square) or WxH",
+                                    "size");
+    parser.addOption(resizeOption);
+    
+    QCommandLineOption fillOption("fill",
+                                  "With --resize, cover the box and crop to it instead of fitting inside");
+    parser.addOption(fillOption);
+    
+    QCommandLineOption alsoOption("also",
+                                  "Further outputs from the same decode or document load: "
+                                  "format[@size],... e.g. webp,jpg@800 or pdfa,png",
+                                  "outputs");
+    parser.addOption(alsoOption);
+    
+    QCommandLineOption dpiOption("dpi",
+                                 "Resolution of PDF pages rendered to images",
+                                 "dpi", "150");
+    parser.addOption(dpiOption);
+    
+    QCommandLineOption pagesOption("pages",
+                                   "PDF pages to render to images, e.g. 1-3,7,10- (default: all)",
+                                   "ranges");
+    parser.addOption(pagesOption);
+    
+    QCommandLineOption mergeOption("merge",
+                                   "With -c pdf, write every image input as a page of this one PDF",
+                                   "file");
+    parser.addOption(mergeOption);
+    
+    QCommandLineOption incrementalOption("incremental",
+                                         "Skip inputs whose output is newer than the input");
+    parser.addOption(incrementalOption);
+    
+    QCommandLineOption indexOption("index",
+                                   "Incremental index file (default: in the application data directory)",
+                                   "file");
+    parser.addOption(indexOption);
+    
+    QCommandLineOption planOption("plan",
+                                  "With --convert, print the expected run time of the batch (per input with -v) "
+                                  "and convert nothing");
+    parser.addOption(planOption);
+    
+    QCommandLineOption manifestOption("manifest",
+                                      "With --convert, read inputs from this file: one path per line or "
+                                      "NUL-separated; path<TAB>format overrides the target",
+                                      "file");
+    parser.addOption(manifestOption);
+    
+    QCommandLineOption traceOption("trace",
+                                   "With --convert, write the conversion timeline to this file "
+                                   "(Chrome trace JSON, for ui.perfetto.dev)",
+                                   "file");
+    parser.addOption(traceOption);
+    
+    QCommandLineOption verboseOption(QStringList() << "v" << "verbose",
+                                     "Print one line per converted file");
+    parser.addOption(verboseOption);
+    
+    QCommandLineOption workersOption("workers",
+                                     "Dispatch jobs to remote workers: host:port[:slots],...",
+                                     "endpoints");
+    parser.addOption(workersOption);
+    
+    QCommandLineOption workerOption("worker",
+                                    "Run as a headless conversion worker for other FileConverter instances");
+    parser.addOption(workerOption);
+    
+    QCommandLineOption serveOption("serve",
+                                   "Run as a headless HTTP conversion service (POST /convert?target=pdf&name=file.docx)");
+    parser.addOption(serveOption);
+    
+    QCommandLineOption listenOption("listen",
+                                    QString("Port for --worker (default %1) or --serve (default %2)")
+                                        .arg(WorkerProtocol::DefaultPort).arg(HttpService::DefaultPort),
+                                    "port");
+    parser.addOption(listenOption);
+    
+    QCommandLineOption bindOption("bind",
+                                  "Address for --worker or --serve to listen on (default: localhost only; "
+                                  "there is no authentication, so use others on trusted networks only)",
+                                  "address");
+    parser.addOption(bindOption);
+    
+    QCommandLineOption maxPendingOption("max-pending",
+                                        "Requests --serve accepts before answering 503",
+                                        "count", "16");
+    parser.addOption(maxPendingOption);
+    
+    parser.addPositionalArgument("file", "File to convert (from context menu), or files and folders with --convert");
     
-    parser.process(a);
+    parser.process(*app);
+
+    // Neither protocol authenticates, so other machines get in only when asked for
+    QHostAddress bindAddress = parser.isSet(bindOption) ? QHostAddress(parser.value(bindOption))
+                                                        : QHostAddress(QHostAddress::LocalHost);
+
+    if (parser.isSet(workerOption)) {
+        Converter converter;
+        WorkerServer server(&converter, parser.value(jobsOption).toInt());
+        quint16 port = parser.isSet(listenOption) ? parser.value(listenOption).toUShort()
+                                                  : WorkerProtocol::DefaultPort;
+        if (!server.listen(bindAddress, port)) {
+            qCritical("Cannot listen on port %u: %s", port, qPrintable(server.errorString()));
+            return 2;
+        }
+        return app->exec();
+    }
+
+    if (parser.isSet(serveOption)) {
+        Converter converter;
+        converter.setMaxParallelConversions(parser.value(jobsOption).toInt());
+        if (parser.isSet(workersOption)) {
+            converter.setWorkerEndpoints(WorkerProtocol::parseEndpoints(parser.value(workersOption)));
+        }
+        HttpService service(&converter);
+        service.setMaxPending(parser.value(maxPendingOption).toInt());
+        quint16 port = parser.isSet(listenOption) ? parser.value(listenOption).toUShort()
+                                                  : HttpService::DefaultPort;
+        if (!service.listen(bindAddress, port)) {
+            qCritical("Cannot listen on port %u: %s", port, qPrintable(service.errorString()));
+            return 2;
+        }
+        return app->exec();
+    }
+
+    if (parser.isSet(convertOption)) {
+        Converter::FileFormat targetFormat = Converter::detectFormat("target." + parser.value(convertOption));
+        if (targetFormat == Converter::FileFormat::Unknown) {
+            qCritical("Unknown target format: %s", qPrintable(parser.value(convertOption)));
+            return 2;
+        }
+        
+        Converter::ResizeOptions resize;
+        if (parser.isSet(resizeOption)) {
+            bool ok = false;
+            resize = Converter::ResizeOptions::fromString(parser.value(resizeOption), &ok);
+            if (!ok || resize.isNull()) {
+                qCritical("Invalid --resize size: %s", qPrintable(parser.value(resizeOption)));
+                return 2;
+            }
+            if (parser.isSet(fillOption)) {
+                resize.mode = Converter::ResizeOptions::Mode::Fill;
+            }
+        }
+        
+        QList<Converter::OutputSpec> extraOutputs;
+        const QStringList alsoSpecs = parser.value(alsoOption).split(',', Qt::SkipEmptyParts);
+        for (const QString &spec : alsoSpecs) {
+            bool ok = false;
+            extraOutputs << Converter::OutputSpec::fromString(spec, &ok);
+            if (!ok) {
+                qCritical("Invalid --also output: %s", qPrintable(spec));
+                return 2;
+            }
+        }
+        
+        bool dpiOk = false;
+        int dpi = parser.value(dpiOption).toInt(&dpiOk);
+        if (!dpiOk || dpi < 36 || dpi > 1200) {
+            qCritical("Invalid --dpi (36 to 1200): %s", qPrintable(parser.value(dpiOption)));
+            return 2;
+        }
+        if (!PdfRasterJob::isValidPageRanges(parser.value(pagesOption))) {
+            qCritical("Invalid --pages ranges: %s", qPrintable(parser.value(pagesOption)));
+            return 2;
+        }
+        
+        Converter converter;
+        converter.setMaxParallelConversions(parser.value(jobsOption).toInt());
+        converter.setRasterDpi(dpi);
+        converter.setRasterPages(parser.value(pagesOption));
+        if (parser.isSet(workersOption)) {
+            converter.setWorkerEndpoints(WorkerProtocol::parseEndpoints(parser.value(workersOption)));
+        }
+        if (parser.isSet(outputOption)) {
+            QDir().mkpath(parser.value(outputOption));
+            converter.setOutputDirectory(QFileInfo(parser.value(outputOption)).absoluteFilePath());
+        }
+        converter.setThroughputStatsPath(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+                                         + "/throughput.stats");
+        if (parser.isSet(traceOption)) {
+            converter.setTracePath(QFileInfo(parser.value(traceOption)).absoluteFilePath());
+        }
+        if (parser.isSet(incrementalOption)) {
+            converter.setIncremental(true);
+            converter.setIncrementalIndexPath(parser.isSet(indexOption)
+                ? parser.value(indexOption)
+                : QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/incremental.idx");
+        }
+        
+        BatchRunner runner(&converter);
+        runner.setVerbose(parser.isSet(verboseOption));
+        runner.setResize(resize);
+        runner.setExtraOutputs(extraOutputs);
+        
+        if (parser.isSet(manifestOption)) {
+            if (parser.isSet(mergeOption) || parser.isSet(planOption)) {
+                qCritical("--manifest cannot be combined with --merge or --plan");
+                return 2;
+            }
+            runner.runManifest(parser.value(manifestOption), targetFormat);
+            return app->exec();
+        }
+        
+        const QStringList inputs = parser.positionalArguments();
+        if (inputs == QStringList{"-"} || (inputs.isEmpty() && !stdinIsTerminal())) {
+#ifdef Q_OS_WIN
+            _setmode(_fileno(stdin), _O_BINARY);
+            _setmode(_fileno(stdout), _O_BINARY);
+#endif
+            QFile input;
+            QFile output;
+            input.open(stdin, QIODevice::ReadOnly);
+            output.open(stdout, QIODevice::WriteOnly);
+            runner.runStream(&input, &output, targetFormat);
+            return app->exec();
+        }
+        
+        if (parser.isSet(mergeOption)) {
+            if (targetFormat != Converter::FileFormat::PDF) {
+                qCritical("--merge needs -c pdf");
+                return 2;
+            }
+            QString mergePath = QFileInfo(parser.value(mergeOption)).absoluteFilePath();
+            QDir().mkpath(QFileInfo(mergePath).absolutePath());
+            runner.runMerge(BatchRunner::collectInputs(inputs), mergePath);
+            return app->exec();
+        }
+        
+        if (parser.isSet(planOption)) {
+            return runner.plan(BatchRunner::collectInputs(inputs), targetFormat);
+        }
+        runner.run(BatchRunner::collectInputs(inputs), targetFormat);
+        return app->exec();
+    }
 
     QTranslator translator;
     const QStringList uiLanguages = QLocale::system().uiLanguages();
     for (const QString &locale : uiLanguages) {
         const QString baseName = "FileConverter_" + QLocale(locale).name();
         if (translator.load(":/i18n/" + baseName)) {
-            a.installTranslator(&translator);
+            app->installTranslator(&translator);
             break;
         }
     }
@@ -58,5 +342,5 @@ int main(int argc, char *argv[])
     }
     
     w.show();
-    return a.exec();
+    return app->exec();
 }
@@ -0,0 +1,143 @@
+#include "MpscQueueTest.h"
+#include "MpscQueue.h"
+#include <QSemaphore>
+#include <QtTest>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr int Producers = 16;
+constexpr int ItemsPerProducer = 50000;
+constexpr int BatchSize = 7;
+// A lost wake-up shows as the consumer waiting this long for nothing
+constexpr int WakeTimeoutMs = 5000;
+
+struct Item {
+    int producer = -1;
+    int sequence = -1;
+};
+
+// Odd producers mix in batches, so single and batch appends interleave
+void produce(MpscQueue<Item> &queue, int producer, const std::function<void()> &wake)
+{
+    int sequence = 0;
+    while (sequence < ItemsPerProducer) {
+        bool woken;
+        if (producer % 2 && sequence + BatchSize <= ItemsPerProducer) {
+            std::vector<Item> batch;
+            for (int i = 0; i < BatchSize; ++i) {
+                batch.push_back({producer, sequence++});
+            }
+            woken = queue.pushBatch(batch.begin(), batch.end());
+        } else {
+            woken = queue.push({producer, sequence++});
+        }
+        if (woken) {
+            wake();
+        }
+    }
+}
+}
+
+void MpscQueueTest::wakeOnce()
+{
+    MpscQueue<int> queue;
+    QVERIFY(queue.push(1));
+    QVERIFY(!queue.push(2));
+    const std::vector<int> batch = {3, 4, 5};
+    QVERIFY(!queue.pushBatch(batch.begin(), batch.end()));
+
+    // Nothing to append takes no wake-up either
+    queue.rearm();
+    QVERIFY(!queue.pushBatch(batch.end(), batch.end()));
+    QVERIFY(queue.pushBatch(batch.begin(), batch.end()));
+    QVERIFY(!queue.push(6));
+
+    QList<int> popped;
+    int value;
+    while (queue.pop(&value)) {
+        popped << value;
+    }
+    QCOMPARE(popped, QList<int>({1, 2, 3, 4, 5, 3, 4, 5, 6}));
+    QVERIFY(!queue.pop(&value));
+}
+
+void MpscQueueTest::multiProducerFifo()
+{
+    MpscQueue<Item> queue;
+    std::vector<std::thread> producers;
+    for (int p = 0; p < Producers; ++p) {
+        producers.emplace_back([&queue, p] { produce(queue, p, [] {}); });
+    }
+
+    // Drained while the producers run
+    std::vector<int> next(Producers, 0);
+    qint64 total = 0;
+    bool ordered = true;
+    while (total < qint64(Producers) * ItemsPerProducer) {
+        Item item;
+        if (!queue.pop(&item)) {
+            std::this_thread::yield();
+            continue;
+        }
+        ordered = ordered && item.sequence == next[item.producer];
+        next[item.producer] = item.sequence + 1;
+        total++;
+    }
+    for (std::thread &producer : producers) {
+        producer.join();
+    }
+
+    QVERIFY(ordered);
+    QCOMPARE(total, qint64(Producers) * ItemsPerProducer);
+    Item item;
+    QVERIFY(!queue.pop(&item));
+}
+
+void MpscQueueTest::noLostWakeUps()
+{
+    // The consumer only looks when woken, as the converter does
+    MpscQueue<Item> queue;
+    QSemaphore wakeUps;
+    std::atomic<int> woken(0);
+    std::vector<std::thread> producers;
+    for (int p = 0; p < Producers; ++p) {
+        producers.emplace_back([&, p] {
+            produce(queue, p, [&] {
+                woken++;
+                wakeUps.release();
+            });
+        });
+    }
+
+    std::vector<int> next(Producers, 0);
+    qint64 total = 0;
+    int rearms = 0;
+    bool ordered = true;
+    bool timedOut = false;
+    while (total < qint64(Producers) * ItemsPerProducer) {
+        if (!wakeUps.tryAcquire(1, WakeTimeoutMs)) {
+            timedOut = true;
+            break;
+        }
+        queue.rearm();
+        rearms++;
+        Item item;
+        while (queue.pop(&item)) {
+            ordered = ordered && item.sequence == next[item.producer];
+            next[item.producer] = item.sequence + 1;
+            total++;
+        }
+    }
+    for (std::thread &producer : producers) {
+        producer.join();
+    }
+
+    QVERIFY2(!timedOut, "Jobs were left in the queue with no wake-up pending");
+    QVERIFY(ordered);
+    QCOMPARE(total, qint64(Producers) * ItemsPerProducer);
+    // One wake-up for the initial arming and at most one per rearm
+    QVERIFY(woken.load() <= rearms + 1);
+}
@@ -0,0 +1,18 @@
+#ifndef MPSCQUEUETEST_H
+#define MPSCQUEUETEST_H
+
+#include <QObject>
+
+// Many producer threads against the one consumer: nothing lost, each
+// producer's jobs in order, and the consumer woken once per rearm
+class MpscQueueTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void wakeOnce();
+    void multiProducerFifo();
+    void noLostWakeUps();
+};
+
+#endif // MPSCQUEUETEST_H
@@ -0,0 +1,214 @@
+#include "PixelKernelsTest.h"
+#include "PixelKernels.h"
+#include <QRandomGenerator>
+#include <QtTest>
+#include <functional>
+
+namespace {
+constexpr int Rounds = 500;
+constexpr int MaxPixels = 300;
+// Written past the end of every output; a kernel must leave it alone
+constexpr uchar Guard = 0x5A;
+constexpr int GuardBytes = 32;
+
+using Isa = PixelKernels::Isa;
+
+QList<Isa> vectorIsas()
+{
+    QList<Isa> isas;
+    for (Isa isa : {Isa::SSE2, Isa::AVX2, Isa::NEON}) {
+        PixelKernels::setIsa(isa);
+        if (PixelKernels::activeIsa() == isa) {
+            isas << isa;
+        }
+    }
+    return isas;
+}
+
+QByteArray randomBytes(QRandomGenerator &random, qsizetype size)
+{
+    QByteArray bytes(size, Qt::Uninitialized);
+    for (char &byte : bytes) {
+        byte = char(random.bounded(256));
+    }
+    return bytes;
+}
+
+// Output of kernel under isa, with the guard bytes behind it
+QByteArray run(Isa isa, qsizetype outputSize, const std::function<void(uchar *)> &kernel)
+{
+    PixelKernels::setIsa(isa);
+    QByteArray output(outputSize + GuardBytes, char(Guard));
+    kernel(reinterpret_cast<uchar *>(output.data()));
+    return output;
+}
+
+void compare(qsizetype outputSize, const std::function<void(uchar *)> &kernel)
+{
+    const QByteArray expected = run(Isa::Scalar, outputSize, kernel);
+    for (Isa isa : vectorIsas()) {
+        QCOMPARE(run(isa, outputSize, kernel), expected);
+    }
+}
+
+const uchar *bytes(const QByteArray &data)
+{
+    return reinterpret_cast<const uchar *>(data.constData());
+}
+
+// The kernel run in place under every ISA, Scalar included, against the
+// scalar run into a buffer of its own
+void compareInPlace(const QByteArray &input, qsizetype outputSize,
+                    const std::function<void(const uchar *, uchar *)> &kernel)
+{
+    PixelKernels::setIsa(Isa::Scalar);
+    QByteArray expected(outputSize, Qt::Uninitialized);
+    kernel(bytes(input), reinterpret_cast<uchar *>(expected.data()));
+    for (Isa isa : QList<Isa>{Isa::Scalar} + vectorIsas()) {
+        PixelKernels::setIsa(isa);
+        QByteArray buffer = input;
+        uchar *data = reinterpret_cast<uchar *>(buffer.data());
+        kernel(data, data);
+        QCOMPARE(buffer.left(outputSize), expected);
+    }
+}
+}
+
+void PixelKernelsTest::cleanup()
+{
+    PixelKernels::setIsa(PixelKernels::supportedIsa());
+}
+
+void PixelKernelsTest::flattenAlpha()
+{
+    if (vectorIsas().isEmpty()) {
+        QSKIP("No vector instruction set on this CPU");
+    }
+    QRandomGenerator random(1);
+    for (int round = 0; round < Rounds; ++round) {
+        qsizetype pixels = random.bounded(MaxPixels);
+        const QByteArray rgba = randomBytes(random, pixels * 4);
+        const QByteArray background = randomBytes(random, 3);
+        compare(pixels * 3, [&](uchar *rgb) {
+            PixelKernels::flattenAlpha(bytes(rgba), rgb, pixels,
+                                       bytes(background)[0], bytes(background)[1], bytes(background)[2]);
+        });
+        // HeifDecoder flattens rows in place
+        compareInPlace(rgba, pixels * 3, [&](const uchar *in, uchar *out) {
+            PixelKernels::flattenAlpha(in, out, pixels,
+                                       bytes(background)[0], bytes(background)[1], bytes(background)[2]);
+        });
+    }
+}
+
+void PixelKernelsTest::swizzle()
+{
+    if (vectorIsas().isEmpty()) {
+        QSKIP("No vector instruction set on this CPU");
+    }
+    QRandomGenerator random(2);
+    for (int round = 0; round < Rounds; ++round) {
+        qsizetype pixels = random.bounded(MaxPixels);
+        const QByteArray rgba = randomBytes(random, pixels * 4);
+        const QByteArray rgb = randomBytes(random, pixels * 3);
+        compare(pixels * 3, [&](uchar *out) { PixelKernels::rgbaToRgb(bytes(rgba), out, pixels); });
+        compare(pixels * 3, [&](uchar *out) { PixelKernels::rgbaToBgr(bytes(rgba), out, pixels); });
+        compare(pixels * 4, [&](uchar *out) { PixelKernels::rgbToRgba(bytes(rgb), out, pixels); });
+        compare(pixels * 4, [&](uchar *out) { PixelKernels::bgrToRgba(bytes(rgb), out, pixels); });
+        compareInPlace(rgba, pixels * 3, [&](const uchar *in, uchar *out) {
+            PixelKernels::rgbaToRgb(in, out, pixels);
+        });
+        compareInPlace(rgba, pixels * 3, [&](const uchar *in, uchar *out) {
+            PixelKernels::rgbaToBgr(in, out, pixels);
+        });
+    }
+
+    // And the scalar reference itself
+    PixelKernels::setIsa(Isa::Scalar);
+    const uchar pixel[4] = {1, 2, 3, 4};
+    uchar out[4] = {};
+    PixelKernels::rgbaToBgr(pixel, out, 1);
+    QCOMPARE(QByteArray(reinterpret_cast<char *>(out), 3), QByteArray("\x03\x02\x01", 3));
+    PixelKernels::bgrToRgba(pixel, out, 1);
+    QCOMPARE(QByteArray(reinterpret_cast<char *>(out), 4), QByteArray("\x03\x02\x01\xff", 4));
+}
+
+void PixelKernelsTest::reduceTo8()
+{
+    if (vectorIsas().isEmpty()) {
+        QSKIP("No vector instruction set on this CPU");
+    }
+    QRandomGenerator random(3);
+    for (int bits = 9; bits <= 16; ++bits) {
+        for (int round = 0; round < Rounds; ++round) {
+            qsizetype count = random.bounded(MaxPixels);
+            QList<quint16> samples(count);
+            for (quint16 &sample : samples) {
+                sample = quint16(random.bounded(1 << bits));
+            }
+            // The extremes round differently; make sure they are present
+            if (count >= 2) {
+                samples[0] = 0;
+                samples[1] = quint16((1 << bits) - 1);
+            }
+            compare(count, [&](uchar *out) {
+                PixelKernels::reduceTo8(samples.constData(), out, count, bits);
+            });
+        }
+    }
+}
+
+void PixelKernelsTest::isGrayscale()
+{
+    const QList<Isa> isas = vectorIsas();
+    if (isas.isEmpty()) {
+        QSKIP("No vector instruction set on this CPU");
+    }
+    QRandomGenerator random(4);
+    for (int round = 0; round < Rounds; ++round) {
+        qsizetype pixels = random.bounded(MaxPixels);
+        QByteArray rgb(pixels * 3, Qt::Uninitialized);
+        for (qsizetype i = 0; i < pixels; ++i) {
+            char level = char(random.bounded(256));
+            rgb[i * 3] = level;
+            rgb[i * 3 + 1] = level;
+            rgb[i * 3 + 2] = level;
+        }
+        // Half the rounds get one channel off somewhere
+        if (pixels > 0 && round % 2) {
+            qsizetype at = random.bounded(pixels * 3);
+            rgb[at] = char(rgb[at] + 1);
+        }
+        PixelKernels::setIsa(Isa::Scalar);
+        bool expected = PixelKernels::isGrayscale(bytes(rgb), pixels);
+        for (Isa isa : isas) {
+            PixelKernels::setIsa(isa);
+            QCOMPARE(PixelKernels::isGrayscale(bytes(rgb), pixels), expected);
+        }
+    }
+}
+
+void PixelKernelsTest::isOpaque()
+{
+    const QList<Isa> isas = vectorIsas();
+    if (isas.isEmpty()) {
+        QSKIP("No vector instruction set on this CPU");
+    }
+    QRandomGenerator random(5);
+    for (int round = 0; round < Rounds; ++round) {
+        qsizetype pixels = random.bounded(MaxPixels);
+        QByteArray rgba = randomBytes(random, pixels * 4);
+        for (qsizetype i = 0; i < pixels; ++i) {
+            rgba[i * 4 + 3] = char(255);
+        }
+        if (pixels > 0 && round % 2) {
+            rgba[random.bounded(pixels) * 4 + 3] = char(random.bounded(255));
+        }
+        PixelKernels::setIsa(Isa::Scalar);
+        bool expected = PixelKernels::isOpaque(bytes(rgba), pixels);
+        for (Isa isa : isas) {
+            PixelKernels::setIsa(isa);
+            QCOMPARE(PixelKernels::isOpaque(bytes(rgba), pixels), expected);
+        }
+    }
+}
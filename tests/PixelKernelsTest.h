@@ -0,0 +1,21 @@
+#ifndef PIXELKERNELSTEST_H
+#define PIXELKERNELSTEST_H
+
+#include <QObject>
+
+// Every vector path the CPU supports against the scalar reference, byte
+// for byte, over random lengths so each kernel's tail handling is covered
+class PixelKernelsTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cleanup();
+    void flattenAlpha();
+    void swizzle();
+    void reduceTo8();
+    void isGrayscale();
+    void isOpaque();
+};
+
+#endif // PIXELKERNELSTEST_H
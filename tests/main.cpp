@@ -0,0 +1,17 @@
+#include <QtTest>
+#include "MpscQueueTest.h"
+#include "PixelKernelsTest.h"
+
+int main(int argc, char *argv[])
+{
+    int status = 0;
+    {
+        PixelKernelsTest test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        MpscQueueTest test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    return status;
+}